@@ -0,0 +1,179 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import com.intel.diceros.crypto.engines.AESGCMBatchEngine;
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+import java.security.Key;
+import java.security.Security;
+import java.util.Random;
+
+import javax.crypto.Cipher;
+import javax.crypto.spec.GCMParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+public class AESGCMBatchTest extends BaseBlockCipherTest {
+  private static final int NONCE_LENGTH = 12;
+  private static final int TAG_LENGTH = 16;
+  private static final int RECORDS = 150;
+
+  public AESGCMBatchTest() {
+    super("AES");
+  }
+
+  public void testAESGCMBatch() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new AESGCMBatchTest());
+  }
+
+  public static void main(String[] args) {
+    new AESGCMBatchTest().testAESGCMBatch();
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    batchTest(16);
+    batchTest(32);
+  }
+
+  private void batchTest(int keyLength) throws Exception {
+    Random rnd = new Random(keyLength);
+    byte[] keyBytes = new byte[keyLength];
+    rnd.nextBytes(keyBytes);
+    Key key = new SecretKeySpec(keyBytes, "AES");
+
+    byte[][] nonces = new byte[RECORDS][NONCE_LENGTH];
+    byte[][] aads = new byte[RECORDS][];
+    byte[][] plainTexts = new byte[RECORDS][];
+    int[] sealed = new int[RECORDS * AESGCMBatchEngine.DESCRIPTOR_SIZE];
+    int[] opened = new int[RECORDS * AESGCMBatchEngine.DESCRIPTOR_SIZE];
+    int size = 0;
+    for (int i = 0; i < RECORDS; i++) {
+      rnd.nextBytes(nonces[i]);
+      aads[i] = new byte[rnd.nextInt(20)];
+      rnd.nextBytes(aads[i]);
+      plainTexts[i] = new byte[rnd.nextInt(300)];
+      rnd.nextBytes(plainTexts[i]);
+      int nonceOff = size;
+      int aadOff = nonceOff + NONCE_LENGTH;
+      int inOff = aadOff + aads[i].length;
+      int sealOff = inOff + plainTexts[i].length;
+      int openOff = sealOff + plainTexts[i].length + TAG_LENGTH;
+      size = openOff + plainTexts[i].length;
+      AESGCMBatchEngine.setRecord(sealed, i, nonceOff, NONCE_LENGTH, aadOff,
+          aads[i].length, inOff, plainTexts[i].length, sealOff);
+      AESGCMBatchEngine.setRecord(opened, i, nonceOff, NONCE_LENGTH, aadOff,
+          aads[i].length, sealOff, plainTexts[i].length + TAG_LENGTH, openOff);
+    }
+
+    ByteBuffer records = ByteBuffer.allocateDirect(size);
+    for (int i = 0; i < RECORDS; i++) {
+      int base = i * AESGCMBatchEngine.DESCRIPTOR_SIZE;
+      put(records, sealed[base + AESGCMBatchEngine.DESC_NONCE_OFFSET], nonces[i]);
+      put(records, sealed[base + AESGCMBatchEngine.DESC_AAD_OFFSET], aads[i]);
+      put(records, sealed[base + AESGCMBatchEngine.DESC_INPUT_OFFSET],
+          plainTexts[i]);
+    }
+
+    AESGCMBatchEngine engine = new AESGCMBatchEngine(keyBytes, TAG_LENGTH);
+    int[] results = new int[RECORDS];
+    engine.seal(records, sealed, RECORDS, results);
+
+    //
+    // every sealed record must match the single record cipher
+    //
+    Cipher enc = Cipher.getInstance("AES/GCM/NoPadding", "DC");
+    for (int i = 0; i < RECORDS; i++) {
+      enc.init(Cipher.ENCRYPT_MODE, key,
+          new GCMParameterSpec(TAG_LENGTH * 8, nonces[i]));
+      enc.updateAAD(aads[i]);
+      byte[] expected = enc.doFinal(plainTexts[i]);
+      if (results[i] != expected.length) {
+        fail("AES/GCM batch seal returned a wrong length");
+      }
+      byte[] actual = get(records,
+          sealed[i * AESGCMBatchEngine.DESCRIPTOR_SIZE
+              + AESGCMBatchEngine.DESC_OUTPUT_OFFSET], expected.length);
+      if (!Arrays.areEqual(expected, actual)) {
+        fail("AES/GCM batch seal failed for record " + i);
+      }
+    }
+
+    //
+    // open the batch with one modified tag
+    //
+    int bad = RECORDS / 2;
+    int tagEnd = sealed[bad * AESGCMBatchEngine.DESCRIPTOR_SIZE
+        + AESGCMBatchEngine.DESC_OUTPUT_OFFSET] + plainTexts[bad].length
+        + TAG_LENGTH - 1;
+    records.put(tagEnd, (byte) (records.get(tagEnd) ^ 1));
+    if (engine.open(records, opened, RECORDS, results) != 1) {
+      fail("AES/GCM batch open failed to count the modified tag");
+    }
+    for (int i = 0; i < RECORDS; i++) {
+      int outOff = opened[i * AESGCMBatchEngine.DESCRIPTOR_SIZE
+          + AESGCMBatchEngine.DESC_OUTPUT_OFFSET];
+      if (i == bad) {
+        if (results[i] != AESGCMBatchEngine.AUTHENTICATION_FAILED) {
+          fail("AES/GCM batch open accepted a modified tag");
+        }
+        if (!Arrays.areEqual(new byte[plainTexts[i].length],
+            get(records, outOff, plainTexts[i].length))) {
+          fail("AES/GCM batch open leaked an unauthenticated record");
+        }
+      } else if (results[i] != plainTexts[i].length
+          || !Arrays.areEqual(plainTexts[i], get(records, outOff, results[i]))) {
+        fail("AES/GCM batch open failed for record " + i);
+      }
+    }
+
+    try {
+      engine.seal(records.asReadOnlyBuffer(), sealed, RECORDS, results);
+      fail("AES/GCM batch sealed into a read only buffer");
+    } catch (ReadOnlyBufferException e) {
+      // expected
+    }
+    try {
+      engine.seal(records, sealed, Integer.MAX_VALUE / 2, results);
+      fail("AES/GCM batch accepted a record count beyond the descriptors");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+    engine.close();
+  }
+
+  private static void put(ByteBuffer buffer, int offset, byte[] data) {
+    ByteBuffer dup = buffer.duplicate();
+    dup.position(offset);
+    dup.put(data);
+  }
+
+  private static byte[] get(ByteBuffer buffer, int offset, int length) {
+    byte[] data = new byte[length];
+    ByteBuffer dup = buffer.duplicate();
+    dup.position(offset);
+    dup.get(data);
+    return data;
+  }
+}
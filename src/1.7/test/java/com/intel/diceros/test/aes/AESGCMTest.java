@@ -19,6 +19,7 @@
 package com.intel.diceros.test.aes;
 
 import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
 import com.intel.diceros.test.BaseBlockCipherTest;
 import com.intel.diceros.test.util.Hex;
 
@@ -77,6 +78,32 @@ public class AESGCMTest extends BaseBlockCipherTest {
           Hex.decode(cipherGCMTests[i + 3]), Hex.decode(cipherGCMTests[i + 4]),
           Hex.decode(cipherGCMTests[i + 5]), Hex.decode(cipherGCMTests[i + 6]));
     }
+    generatedIvTest();
+  }
+
+  /**
+   * Encryption without parameters takes a unique 96 bit IV from the nonce
+   * generator.
+   */
+  private void generatedIvTest() throws Exception {
+    Key key = new SecretKeySpec(Hex.decode("00112233445566778899aabbccddeeff"),
+        "AES");
+    byte[] plainText = Hex.decode("000102030405060708090a0b0c0d0e0f1011");
+    Cipher enc = Cipher.getInstance(this.cipherName, this.providerName);
+    Cipher dec = Cipher.getInstance(this.cipherName, this.providerName);
+
+    enc.init(Cipher.ENCRYPT_MODE, key);
+    byte[] iv = enc.getIV();
+    byte[] cipherText = enc.doFinal(plainText);
+    enc.init(Cipher.ENCRYPT_MODE, key);
+    if (iv.length != 12 || Arrays.areEqual(iv, enc.getIV())) {
+      fail("AES/GCM generated IV is not a unique 96 bit nonce");
+    }
+
+    dec.init(Cipher.DECRYPT_MODE, key, new GCMParameterSpec(128, iv));
+    if (!Arrays.areEqual(plainText, dec.doFinal(cipherText))) {
+      fail("AES/GCM failed with a generated IV");
+    }
   }
 
   private void byteArrayTest(int strength, byte[] keyBytes, byte[] ivBytes,
@@ -138,5 +165,60 @@ public class AESGCMTest extends BaseBlockCipherTest {
         fail("AES/GCM failed decryption");
       }
     }
+
+    //
+    // decryption in updates shorter than the tag, the tag is withheld natively
+    //
+    decResult = new byte[plainText.length];
+    dec.init(Cipher.DECRYPT_MODE, key, spec);
+    dec.updateAAD(aad);
+    int decLen = 0;
+    for (int off = 0; off < encResult.length; off += 3) {
+      decLen += dec.update(encResult, off, Math.min(3, encResult.length - off),
+          decResult, decLen);
+    }
+    decLen += dec.doFinal(decResult, decLen);
+    if (decLen != plainText.length) {
+      fail("AES/GCM failed decryption in short updates");
+    }
+    for (int i=0; i<plainText.length; i++) {
+      if (plainText[i] != decResult[i]) {
+        fail("AES/GCM failed decryption in short updates");
+      }
+    }
+
+    //
+    // in place decryption in updates longer than the tag, every update
+    // writes the withheld bytes of the previous one over its own input
+    //
+    byte[] inPlace = encResult.clone();
+    decResult = new byte[plainText.length];
+    dec.init(Cipher.DECRYPT_MODE, key, spec);
+    dec.updateAAD(aad);
+    decLen = 0;
+    for (int off = 0; off < inPlace.length; off += 40) {
+      int len = dec.update(inPlace, off, Math.min(40, inPlace.length - off),
+          inPlace, off);
+      System.arraycopy(inPlace, off, decResult, decLen, len);
+      decLen += len;
+    }
+    decLen += dec.doFinal(decResult, decLen);
+    if (decLen != plainText.length || !Arrays.areEqual(plainText, decResult)) {
+      fail("AES/GCM failed in place decryption");
+    }
+
+    //
+    // a modified tag must be rejected
+    //
+    encResult[encResult.length - 1] ^= 1;
+    dec.init(Cipher.DECRYPT_MODE, key, spec);
+    dec.updateAAD(aad);
+    try {
+      int len = dec.update(encResult, 0, encResult.length, decResult, 0);
+      dec.doFinal(decResult, len);
+      fail("AES/GCM accepted a modified tag");
+    } catch (Exception e) {
+      // expected
+    }
   }
 }
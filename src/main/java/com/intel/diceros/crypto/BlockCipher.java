@@ -138,6 +138,25 @@ public interface BlockCipher {
   public void getTag(byte[] out, int outOff, int tLen);
   public int getTagLen();
 
+  /**
+   * GCM only: let the cipher handle a tag of <code>tLen</code> bytes itself.
+   * On encryption the tag is appended by the final call, on decryption the
+   * last <code>tLen</code> bytes of the input are withheld as the tag and
+   * verified by the final call.
+   *
+   * @param tLen the tag length in bytes
+   */
+  public void setTagLen(int tLen);
+
   public void updateAAD(byte[] src, int offset, int len);
   public void updateAAD(ByteBuffer src);
+
+  /**
+   * Move the cipher to an absolute byte position of the stream started by the
+   * last init, so that the next processed byte is the one at
+   * <code>position</code>. Only supported by stream modes like CTR.
+   *
+   * @param position the byte offset from the start of the stream
+   */
+  public void seek(long position);
 }
@@ -0,0 +1,207 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.digests;
+
+import java.nio.ByteBuffer;
+
+/**
+ * SHA-1 and SHA-256 hashed by the native library. The compression uses the
+ * SHA extensions when the CPU has them, {@link #batchSHA256} hashes many
+ * small messages in one call and uses the eight lane AVX2 kernel on CPUs
+ * without them.
+ * <p>
+ * An instance is not thread safe.
+ */
+public class SHADigest {
+  // keep in sync with sha.h
+  public static final int SHA1 = 1;
+  public static final int SHA256 = 2;
+
+  public static final int SHA1_LENGTH = 20;
+  public static final int SHA256_LENGTH = 32;
+
+  private final int algorithm;
+  private final byte[] single = new byte[1];
+  private long context = 0;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  /**
+   * @param algorithm {@link #SHA1} or {@link #SHA256}
+   */
+  public SHADigest(int algorithm) {
+    this.algorithm = algorithm;
+    this.context = create(algorithm);
+  }
+
+  private SHADigest(SHADigest other) {
+    this.algorithm = other.algorithm;
+    this.context = copy(other.context);
+  }
+
+  public int getDigestLength() {
+    return algorithm == SHA1 ? SHA1_LENGTH : SHA256_LENGTH;
+  }
+
+  public String getAlgorithmName() {
+    return algorithm == SHA1 ? "SHA-1" : "SHA-256";
+  }
+
+  public void update(byte in) {
+    single[0] = in;
+    update(single, 0, 1);
+  }
+
+  public void update(byte[] in, int inOff, int len) {
+    checkContext();
+    if (inOff < 0 || len < 0 || inOff > in.length - len) {
+      throw new IllegalArgumentException("Input out of the array bounds");
+    }
+    if (len > 0) {
+      updateArray(context, in, inOff, len);
+    }
+  }
+
+  /**
+   * Hash the remaining bytes of <code>input</code> and move its position to
+   * the limit. Direct buffers are read in place.
+   */
+  public void update(ByteBuffer input) {
+    checkContext();
+    int len = input.remaining();
+    if (len == 0) {
+      return;
+    }
+    if (input.isDirect()) {
+      updateDirect(context, input, input.position(), len);
+      input.position(input.limit());
+    } else if (input.hasArray()) {
+      update(input.array(), input.arrayOffset() + input.position(), len);
+      input.position(input.limit());
+    } else {
+      byte[] data = new byte[len];
+      input.get(data);
+      update(data, 0, len);
+    }
+  }
+
+  /**
+   * Write the digest to <code>out</code> and reset for the next message.
+   *
+   * @return the digest length
+   */
+  public int doFinal(byte[] out, int outOff) {
+    checkContext();
+    int len = getDigestLength();
+    if (outOff < 0 || outOff > out.length - len) {
+      throw new IllegalArgumentException("Output buffer too short");
+    }
+    doFinal(context, out, outOff);
+    return len;
+  }
+
+  public void reset() {
+    checkContext();
+    reset(context);
+  }
+
+  /**
+   * @return an independent digest in the same state
+   */
+  public SHADigest copy() {
+    checkContext();
+    return new SHADigest(this);
+  }
+
+  public synchronized void close() {
+    if (context != 0) {
+      destroy(context);
+      context = 0;
+    }
+  }
+
+  @Override
+  protected void finalize() throws Throwable {
+    try {
+      close();
+    } finally {
+      super.finalize();
+    }
+  }
+
+  /**
+   * Hash <code>count</code> independent messages with SHA-256. Message i is
+   * <code>lengths[i]</code> bytes at <code>offsets[i]</code> of
+   * <code>messages</code>, its digest is written to the
+   * {@link #SHA256_LENGTH} bytes at <code>position + 32 * i</code> of
+   * <code>digests</code>. Both buffers must be direct, the position of
+   * <code>digests</code> is moved past the digests.
+   */
+  public static void batchSHA256(ByteBuffer messages, int[] offsets,
+      int[] lengths, int count, ByteBuffer digests) {
+    if (!messages.isDirect() || !digests.isDirect()) {
+      throw new IllegalArgumentException(
+          "Messages and digests must be in direct buffers");
+    }
+    if (count < 0 || offsets.length < count || lengths.length < count) {
+      throw new IllegalArgumentException("Invalid message count: " + count);
+    }
+    if (digests.remaining() / SHA256_LENGTH < count) {
+      throw new IllegalArgumentException("Digest buffer too short");
+    }
+    if (count > 0) {
+      batch(messages, offsets, lengths, count, digests, digests.position());
+      digests.position(digests.position() + count * SHA256_LENGTH);
+    }
+  }
+
+  private void checkContext() {
+    if (context == 0) {
+      throw new IllegalStateException("Digest is closed");
+    }
+  }
+
+  private static native long create(int algorithm);
+
+  private static native long copy(long context);
+
+  private static native void destroy(long context);
+
+  private static native void reset(long context);
+
+  private static native void updateArray(long context, byte[] in, int inOff,
+      int inLen);
+
+  private static native void updateDirect(long context,
+      ByteBuffer inputDirectBuffer, int start, int inputLength);
+
+  private static native void doFinal(long context, byte[] out, int outOff);
+
+  /**
+   * @return the name of the native compression kernel used for
+   *         <code>algorithm</code>
+   */
+  public static native String getKernelName(int algorithm);
+
+  private static native void batch(ByteBuffer messages, int[] offsets,
+      int[] lengths, int count, ByteBuffer digests, int begin);
+}
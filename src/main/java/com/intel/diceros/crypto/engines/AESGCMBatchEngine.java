@@ -0,0 +1,154 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+
+/**
+ * Seals and opens many AES-GCM records with one key in a single native call.
+ * The key schedule is expanded once, every record only reloads its nonce.
+ * <p>
+ * The records live in one direct buffer and are described by
+ * {@link #DESCRIPTOR_SIZE} ints each, see the <code>DESC_*</code> offsets.
+ * A sealed record is the ciphertext followed by the tag, so the output of a
+ * seal needs <code>inputLength + tagLength</code> bytes and the input of an
+ * open includes the tag.
+ * <p>
+ * An instance is not thread safe.
+ */
+public class AESGCMBatchEngine {
+  public static final int DESC_NONCE_OFFSET = 0;
+  public static final int DESC_NONCE_LENGTH = 1;
+  public static final int DESC_AAD_OFFSET = 2;
+  public static final int DESC_AAD_LENGTH = 3;
+  public static final int DESC_INPUT_OFFSET = 4;
+  public static final int DESC_INPUT_LENGTH = 5;
+  public static final int DESC_OUTPUT_OFFSET = 6;
+  public static final int DESCRIPTOR_SIZE = 7;
+
+  /** result of a record which failed authentication */
+  public static final int AUTHENTICATION_FAILED = -1;
+
+  private final int tagLength;
+  private long context = 0;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  /**
+   * @param key the AES key shared by all records
+   * @param tagLength the tag length in bytes, 12 to 16
+   */
+  public AESGCMBatchEngine(byte[] key, int tagLength) {
+    if (tagLength < 12 || tagLength > 16) {
+      throw new IllegalArgumentException("Invalid tag length: " + tagLength);
+    }
+    this.tagLength = tagLength;
+    this.context = create(key, tagLength);
+  }
+
+  /**
+   * Fill the descriptor of record <code>index</code>, all offsets are
+   * absolute positions in the record buffer.
+   */
+  public static void setRecord(int[] descriptors, int index, int nonceOffset,
+      int nonceLength, int aadOffset, int aadLength, int inputOffset,
+      int inputLength, int outputOffset) {
+    int base = index * DESCRIPTOR_SIZE;
+    descriptors[base + DESC_NONCE_OFFSET] = nonceOffset;
+    descriptors[base + DESC_NONCE_LENGTH] = nonceLength;
+    descriptors[base + DESC_AAD_OFFSET] = aadOffset;
+    descriptors[base + DESC_AAD_LENGTH] = aadLength;
+    descriptors[base + DESC_INPUT_OFFSET] = inputOffset;
+    descriptors[base + DESC_INPUT_LENGTH] = inputLength;
+    descriptors[base + DESC_OUTPUT_OFFSET] = outputOffset;
+  }
+
+  /**
+   * Encrypt <code>count</code> records and append their tags.
+   *
+   * @param records the direct buffer holding nonces, AAD, input and output
+   * @param results receives the output length of every record
+   */
+  public void seal(ByteBuffer records, int[] descriptors, int count,
+      int[] results) {
+    checkBatch(records, descriptors, count, results);
+    process(context, true, records, descriptors, count, results);
+  }
+
+  /**
+   * Verify and decrypt <code>count</code> records. The result of a record is
+   * its plaintext length or {@link #AUTHENTICATION_FAILED}, the output of a
+   * failed record is zeroed.
+   *
+   * @return the number of records which failed authentication
+   */
+  public int open(ByteBuffer records, int[] descriptors, int count,
+      int[] results) {
+    checkBatch(records, descriptors, count, results);
+    return process(context, false, records, descriptors, count, results);
+  }
+
+  public int getTagLength() {
+    return tagLength;
+  }
+
+  public synchronized void close() {
+    if (context != 0) {
+      destroy(context);
+      context = 0;
+    }
+  }
+
+  @Override
+  protected void finalize() throws Throwable {
+    try {
+      close();
+    } finally {
+      super.finalize();
+    }
+  }
+
+  private void checkBatch(ByteBuffer records, int[] descriptors, int count,
+      int[] results) {
+    if (context == 0) {
+      throw new IllegalStateException("Batch engine is closed");
+    }
+    if (!records.isDirect()) {
+      throw new IllegalArgumentException("Records must be in a direct buffer");
+    }
+    if (records.isReadOnly()) {
+      throw new ReadOnlyBufferException();
+    }
+    if (count < 0 || descriptors.length < (long) count * DESCRIPTOR_SIZE
+        || results.length < count) {
+      throw new IllegalArgumentException("Invalid record count: " + count);
+    }
+  }
+
+  private static native long create(byte[] key, int tagLength);
+
+  private static native void destroy(long context);
+
+  private static native int process(long context, boolean seal,
+      ByteBuffer records, int[] descriptors, int count, int[] results);
+}
@@ -0,0 +1,233 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+/**
+ * Multi-buffer AES-CBC in a chunked, self-describing container.
+ * <p>
+ * A container starts with a {@link #HEADER_LENGTH} byte header recording the
+ * format version, the lane count, the chunk size and the plaintext length.
+ * Every chunk is encrypted on its own and keeps its plaintext offset (plus
+ * the header) in the container, so any byte range can be decrypted from the
+ * chunks it touches, and chunks can be decrypted in parallel by one instance
+ * per thread. The container is zero padded to a whole block and carries no
+ * padding bytes.
+ * <p>
+ * {@link #open(byte[], int, int)} also reads messages written by the
+ * <code>AES/MBCBC/PKCS5Padding</code> cipher with the same key and IV.
+ * <p>
+ * An instance is not thread safe.
+ */
+public class AESMultiBufferContainer {
+  public static final int HEADER_LENGTH = 16;
+  public static final int VERSION = 1;
+  public static final int DEFAULT_CHUNK_SIZE = 64 * 1024;
+  public static final int MAX_CHUNK_SIZE = 1024 * 1024;
+
+  private static final int MARKER = 0x40;
+  private static final int BLOCK_SIZE = 16;
+
+  private final byte[] key;
+  private final byte[] iv;
+  private long sealContext = 0;
+  private long openContext = 0;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  /**
+   * @param key the AES key, 16, 24 or 32 bytes
+   * @param iv the 16 byte IV the lane IVs of all chunks are derived from
+   */
+  public AESMultiBufferContainer(byte[] key, byte[] iv) {
+    if (key.length != 16 && key.length != 24 && key.length != 32) {
+      throw new IllegalArgumentException("Invalid AES key length: "
+          + key.length + " bytes");
+    }
+    if (iv.length != BLOCK_SIZE) {
+      throw new IllegalArgumentException("Invalid IV length: " + iv.length);
+    }
+    this.key = key.clone();
+    this.iv = iv.clone();
+  }
+
+  /**
+   * @return true if the input starts with a container header of any version
+   */
+  public static boolean isContainer(byte[] in, int inOff, int inLen) {
+    return inLen >= HEADER_LENGTH && (in[inOff] & 0xc0) == MARKER;
+  }
+
+  /**
+   * @return the plaintext length recorded in the container header
+   */
+  public static long getPlainTextLength(byte[] in, int inOff, int inLen) {
+    checkHeader(in, inOff, inLen);
+    long length = 0;
+    for (int i = 4; i < 12; i++) {
+      length = (length << 8) | (in[inOff + i] & 0xff);
+    }
+    return length;
+  }
+
+  /**
+   * @return the chunk size recorded in the container header
+   */
+  public static int getChunkSize(byte[] in, int inOff, int inLen) {
+    checkHeader(in, inOff, inLen);
+    return (((in[inOff + 2] & 0xff) << 8) | (in[inOff + 3] & 0xff)) * 1024;
+  }
+
+  /**
+   * @return the container length of <code>plainTextLength</code> bytes
+   */
+  public static long getSealedLength(long plainTextLength) {
+    return HEADER_LENGTH
+        + (plainTextLength + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+  }
+
+  public byte[] seal(byte[] in, int inOff, int inLen) {
+    byte[] out = new byte[(int) getSealedLength(inLen)];
+    seal(in, inOff, inLen, DEFAULT_CHUNK_SIZE, out, 0);
+    return out;
+  }
+
+  /**
+   * @param chunkSize the plaintext bytes per chunk, a multiple of 1024 up to
+   *          {@link #MAX_CHUNK_SIZE}
+   * @return the container length
+   */
+  public int seal(byte[] in, int inOff, int inLen, int chunkSize, byte[] out,
+      int outOff) {
+    checkRange(in, inOff, inLen);
+    if (chunkSize <= 0 || chunkSize % 1024 != 0 || chunkSize > MAX_CHUNK_SIZE) {
+      throw new IllegalArgumentException("Invalid chunk size: " + chunkSize);
+    }
+    if (inLen > Integer.MAX_VALUE - HEADER_LENGTH - BLOCK_SIZE) {
+      throw new IllegalArgumentException("Input too long: " + inLen);
+    }
+    checkRange(out, outOff, (int) getSealedLength(inLen));
+    if (sealContext == 0) {
+      sealContext = create(true, key, iv);
+    }
+    return seal(sealContext, in, inOff, inLen, chunkSize, out, outOff);
+  }
+
+  /**
+   * Decrypt a whole message, either a container or a message of the
+   * <code>AES/MBCBC/PKCS5Padding</code> cipher.
+   */
+  public byte[] open(byte[] in, int inOff, int inLen) {
+    checkRange(in, inOff, inLen);
+    if (isContainer(in, inOff, inLen)) {
+      long length = getPlainTextLength(in, inOff, inLen);
+      if (length > Integer.MAX_VALUE) {
+        throw new IllegalArgumentException("Container too large: " + length);
+      }
+      byte[] out = new byte[(int) length];
+      open(in, inOff, inLen, 0, out, 0, out.length);
+      return out;
+    }
+    byte[] out = new byte[inLen];
+    int length = openMessage(getOpenContext(), in, inOff, inLen, out, 0);
+    byte[] tmp = new byte[length];
+    System.arraycopy(out, 0, tmp, 0, length);
+    return tmp;
+  }
+
+  /**
+   * Decrypt <code>length</code> plaintext bytes from <code>position</code> on.
+   * <code>in</code> needs to hold the container up to the end of the range
+   * only.
+   *
+   * @return the number of bytes written to <code>out</code>
+   */
+  public int open(byte[] in, int inOff, int inLen, long position, byte[] out,
+      int outOff, int length) {
+    checkRange(in, inOff, inLen);
+    checkRange(out, outOff, length);
+    checkHeader(in, inOff, inLen);
+    if (position < 0) {
+      throw new IllegalArgumentException("Invalid position: " + position);
+    }
+    return open(getOpenContext(), in, inOff, inLen, position, length, out,
+        outOff);
+  }
+
+  public synchronized void close() {
+    if (sealContext != 0) {
+      destroy(sealContext);
+      sealContext = 0;
+    }
+    if (openContext != 0) {
+      destroy(openContext);
+      openContext = 0;
+    }
+  }
+
+  @Override
+  protected void finalize() throws Throwable {
+    try {
+      close();
+    } finally {
+      super.finalize();
+    }
+  }
+
+  private long getOpenContext() {
+    if (openContext == 0) {
+      openContext = create(false, key, iv);
+    }
+    return openContext;
+  }
+
+  private static void checkHeader(byte[] in, int inOff, int inLen) {
+    if (!isContainer(in, inOff, inLen)) {
+      throw new IllegalArgumentException("Not a multi-buffer container");
+    }
+    int version = in[inOff] & ~MARKER;
+    if (version != VERSION) {
+      throw new IllegalArgumentException("Unsupported container version: "
+          + version);
+    }
+  }
+
+  private static void checkRange(byte[] data, int off, int len) {
+    if (off < 0 || len < 0 || off > data.length - len) {
+      throw new IllegalArgumentException(
+          "offset or length is negative, or exceeds the array boundary");
+    }
+  }
+
+  private static native long create(boolean forEncryption, byte[] key,
+      byte[] iv);
+
+  private static native void destroy(long context);
+
+  private static native int seal(long context, byte[] in, int inOff, int inLen,
+      int chunkSize, byte[] out, int outOff);
+
+  private static native int open(long context, byte[] in, int inOff, int inLen,
+      long position, int length, byte[] out, int outOff);
+
+  private static native int openMessage(long context, byte[] in, int inOff,
+      int inLen, byte[] out, int outOff);
+}
@@ -0,0 +1,235 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+import com.intel.diceros.provider.symmetric.util.Constants;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.locks.ReadWriteLock;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
+
+/**
+ * Schedules independent AES-CBC encryption jobs from many threads onto the
+ * lanes of the multi-buffer kernel. Every job has its own IV and length, the
+ * output is plain AES-CBC (optionally PKCS5 padded) and can be decrypted by
+ * any AES/CBC cipher.
+ * <p>
+ * Jobs are run when all lanes are occupied, or by the waiting thread once the
+ * flush timeout has passed, so single jobs still complete under low load.
+ * Every submitted {@link Job} must be awaited, the manager cannot be closed
+ * while a job is outstanding.
+ * <p>
+ * A job may also bring its own key, e.g. of one tenant, so messages of
+ * different tenants fill the lanes together. All keys of a manager have the
+ * same size.
+ */
+public class AESMultiBufferJobManager {
+  /** default time a job waits for other jobs to fill the lanes, in ns */
+  public static final long DEFAULT_FLUSH_TIMEOUT = 100000L;
+
+  private final int padding;
+  private final boolean hasKey;
+  // submitters share the manager, only close excludes them
+  private final ReadWriteLock lock = new ReentrantReadWriteLock();
+  private long manager = 0;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  /**
+   * A submitted encryption job.
+   */
+  public final class Job {
+    private final ByteBuffer input;
+    private final ByteBuffer output;
+    private long job;
+    private int outputLength = -1;
+
+    private Job(ByteBuffer input, ByteBuffer output, long job) {
+      this.input = input;
+      this.output = output;
+      this.job = job;
+    }
+
+    /**
+     * Wait for the job to complete.
+     *
+     * @return the number of bytes written to the output buffer
+     */
+    public synchronized int await() {
+      if (job != 0) {
+        long handle = job;
+        long mgr = openManager();
+        job = 0;
+        outputLength = waitFor(mgr, handle);
+      }
+      return outputLength;
+    }
+  }
+
+  public AESMultiBufferJobManager(byte[] key, int padding) {
+    this(key, padding, DEFAULT_FLUSH_TIMEOUT);
+  }
+
+  /**
+   * @param key the AES key shared by all jobs
+   * @param padding {@link Constants#PADDING_PKCS5PADDING} or
+   *        {@link Constants#PADDING_NOPADDING}
+   * @param flushTimeout the time in ns a waiting job gives other threads to
+   *        fill the remaining lanes
+   */
+  public AESMultiBufferJobManager(byte[] key, int padding, long flushTimeout) {
+    this.padding = padding;
+    this.hasKey = true;
+    this.manager = create(key, key.length, padding, flushTimeout);
+  }
+
+  /**
+   * Create a manager without a shared key, every job must be submitted with
+   * its own key of <code>keyLength</code> bytes.
+   */
+  public AESMultiBufferJobManager(int keyLength, int padding,
+      long flushTimeout) {
+    this.padding = padding;
+    this.hasKey = false;
+    this.manager = create(null, keyLength, padding, flushTimeout);
+  }
+
+  /**
+   * Queue the encryption of the remaining bytes of <code>input</code> into
+   * <code>output</code>. Both buffers must be direct and must not be touched
+   * until the job is completed. The position of <code>input</code> is moved to
+   * its limit and the position of <code>output</code> past the ciphertext.
+   */
+  public Job submit(ByteBuffer input, ByteBuffer output, byte[] iv) {
+    if (!hasKey) {
+      throw new IllegalStateException("Job manager has no shared key");
+    }
+    return submit(input, output, iv, null);
+  }
+
+  /**
+   * Queue a job like {@link #submit(ByteBuffer, ByteBuffer, byte[])}, but
+   * encrypt it with its own <code>key</code>, which must have the key size of
+   * the manager.
+   */
+  public Job submit(ByteBuffer input, ByteBuffer output, byte[] iv,
+      byte[] key) {
+    int inputLength = input.remaining();
+    int outputLength = getOutputSize(inputLength);
+    if (output.remaining() < outputLength) {
+      throw new IllegalArgumentException("Output buffer too short");
+    }
+
+    long job;
+    lock.readLock().lock();
+    try {
+      checkManager();
+      job = submit(manager, input, input.position(), inputLength, output,
+          output.position(), iv, key);
+    } finally {
+      lock.readLock().unlock();
+    }
+    input.position(input.limit());
+    output.position(output.position() + outputLength);
+    return new Job(input, output, job);
+  }
+
+  public int getOutputSize(int inputLen) {
+    if (padding == Constants.PADDING_PKCS5PADDING) {
+      return (inputLen / Constants.AES_BLOCK_SIZE + 1) * Constants.AES_BLOCK_SIZE;
+    }
+    return inputLen;
+  }
+
+  /**
+   * Run all queued jobs now, regardless of the lane occupancy.
+   */
+  public void flush() {
+    lock.readLock().lock();
+    try {
+      checkManager();
+      flush(manager);
+    } finally {
+      lock.readLock().unlock();
+    }
+  }
+
+  /**
+   * Free the native manager.
+   *
+   * @throws IllegalStateException if a submitted job is not awaited yet
+   */
+  public void close() {
+    lock.writeLock().lock();
+    try {
+      if (manager != 0) {
+        destroy(manager);
+        manager = 0;
+      }
+    } finally {
+      lock.writeLock().unlock();
+    }
+  }
+
+  @Override
+  protected void finalize() throws Throwable {
+    try {
+      close();
+    } finally {
+      super.finalize();
+    }
+  }
+
+  private void checkManager() {
+    if (manager == 0) {
+      throw new IllegalStateException("Job manager is closed");
+    }
+  }
+
+  /*
+   * The handle stays valid after the lock is released: the native manager
+   * counts the outstanding jobs and refuses to be destroyed until they are
+   * awaited.
+   */
+  private long openManager() {
+    lock.readLock().lock();
+    try {
+      checkManager();
+      return manager;
+    } finally {
+      lock.readLock().unlock();
+    }
+  }
+
+  private static native long create(byte[] key, int keyLength, int padding,
+      long flushTimeout);
+
+  private static native void destroy(long manager);
+
+  private static native long submit(long manager, ByteBuffer inputDirectBuffer,
+      int start, int inputLength, ByteBuffer outputDirectBuffer, int begin, byte[] iv,
+      byte[] key);
+
+  private static native int waitFor(long manager, long job);
+
+  private static native void flush(long manager);
+}
@@ -34,6 +34,11 @@ public class AESMutliBufferEngine implements BlockCipher {
   CipherParameters params = null;
   private long aesContext = 0; // context used by openssl
 
+  static {
+    WorkerPool.ensureConfigured();
+    KernelDispatch.ensureConfigured();
+  }
+
   public AESMutliBufferEngine(int mode) {
     this.mode = mode;
   }
@@ -85,7 +90,8 @@ public class AESMutliBufferEngine implements BlockCipher {
 
   @Override
   public int doFinal(byte[] out, int outOff) {
-    return 0;
+    checkCipherInit();
+    return doFinal(aesContext, out, outOff);
   }
 
   @Override
@@ -107,9 +113,6 @@ public class AESMutliBufferEngine implements BlockCipher {
 
   @Override
   public int processByteBuffer(ByteBuffer input, ByteBuffer output, boolean isUpdate) {
-    if (isUpdate) {
-      throw new UnsupportedOperationException("Mutli Buffer don't support the update method.");
-    }
     checkCipherInit();
     return processByteBuffer(aesContext, input, input.position(), input.limit()-input.position(), output,
             output.position(), isUpdate);
@@ -155,6 +158,11 @@ public class AESMutliBufferEngine implements BlockCipher {
     throw new UnsupportedOperationException();
   }
 
+  @Override
+  public void setTagLen(int tLen) {
+    throw new UnsupportedOperationException();
+  }
+
   @Override
   public void updateAAD(byte[] src, int offset, int len) {
     throw new UnsupportedOperationException();
@@ -187,5 +195,12 @@ public class AESMutliBufferEngine implements BlockCipher {
 
   private native int processBlock(long context, byte[] in, int inOff, int inLen, byte[] out, int outOff);
 
+  private native int doFinal(long context, byte[] out, int outOff);
+
   private native int destoryCipherContext(long context);
+
+  @Override
+  public void seek(long position) {
+    throw new UnsupportedOperationException();
+  }
 }
@@ -35,9 +35,15 @@ public class AESOpensslEngine implements BlockCipher {
   private int mode;
   private int padding = Constants.PADDING_NOPADDING;
   private byte[] IV;
+  private int tagLen = 0; // GCM tag length handled by the native context
+  private static final int MAX_BYTES_PER_CHECKSUM = 16 * 1024 * 1024;
   CipherParameters params = null;
   private long aesContext = 0; // context used by openssl
 
+  static {
+    WorkerPool.ensureConfigured();
+  }
+
   public AESOpensslEngine(int mode) {
     this.mode = mode;
   }
@@ -63,6 +69,9 @@ public class AESOpensslEngine implements BlockCipher {
       }
       aesContext = initWorkingKey(((KeyParameter) params).getKey(), forEncryption,
           mode, padding, IV, aesContext);
+      if (mode == Constants.MODE_GCM) {
+        setTagLen(aesContext, tagLen);
+      }
     } else {
       throw new IllegalArgumentException(
               "invalid parameter passed to AES init - "
@@ -161,7 +170,24 @@ public class AESOpensslEngine implements BlockCipher {
 
   @Override
   public int getTagLen(){
-    throw new UnsupportedOperationException();
+    if (mode != Constants.MODE_GCM) {
+      throw new UnsupportedOperationException();
+    }
+    return tagLen;
+  }
+
+  @Override
+  public void setTagLen(int tLen) {
+    if (mode != Constants.MODE_GCM) {
+      throw new UnsupportedOperationException();
+    }
+    if (tLen < 0 || tLen > Constants.AES_BLOCK_SIZE) {
+      throw new IllegalArgumentException("Invalid tag length: " + tLen);
+    }
+    this.tagLen = tLen;
+    if (aesContext != 0) {
+      setTagLen(aesContext, tLen);
+    }
   }
 
   @Override
@@ -177,6 +203,126 @@ public class AESOpensslEngine implements BlockCipher {
     src.position(src.limit());
   }
 
+  @Override
+  public void seek(long position) {
+    if (mode != Constants.MODE_CTR) {
+      throw new UnsupportedOperationException();
+    }
+    checkCipherInit();
+    seek(aesContext, position);
+  }
+
+  /**
+   * XTS only: process <code>inLen</code> bytes as consecutive data units of
+   * <code>dataUnitSize</code> bytes, unit i using the tweak of sector
+   * <code>startSector + i</code> (128 bit little endian). The unit size must be
+   * a multiple of the block size, the last unit may be shorter but must hold
+   * at least one block.
+   *
+   * @return the number of bytes stored in <code>out</code>
+   */
+  public int processSectors(byte[] in, int inOff, int inLen, byte[] out,
+      int outOff, int dataUnitSize, long startSector) {
+    if (inOff < 0 || outOff < 0) {
+      throw new IllegalArgumentException("Negative offset");
+    }
+    checkXTSSectors(in.length - inOff, inLen, out.length - outOff, dataUnitSize);
+    checkCipherInit();
+    return processSectors(aesContext, in, inOff, inLen, out, outOff,
+        dataUnitSize, startSector);
+  }
+
+  /**
+   * Direct buffer version of
+   * {@link #processSectors(byte[], int, int, byte[], int, int, long)}, all
+   * remaining bytes of <code>input</code> are processed.
+   */
+  public int processSectors(ByteBuffer input, ByteBuffer output,
+      int dataUnitSize, long startSector) {
+    int inLen = input.remaining();
+    checkXTSSectors(inLen, inLen, output.remaining(), dataUnitSize);
+    checkCipherInit();
+    int len = processSectorsByteBuffer(aesContext, input, input.position(),
+        inLen, output, output.position(), dataUnitSize, startSector);
+    input.position(input.limit());
+    output.position(output.position() + len);
+    return len;
+  }
+
+  /**
+   * CTR only: encrypt or decrypt the remaining bytes of <code>input</code>
+   * into <code>output</code> and compute the CRC32C of every
+   * <code>bytesPerChecksum</code> bytes of the ciphertext in the same pass.
+   * The checksum of chunk i is stored at <code>checksums[checksumOff + i]</code>,
+   * the last chunk may be shorter. Both buffers must be direct and may be
+   * the same for in-place processing.
+   *
+   * @return the number of bytes stored in <code>output</code>
+   */
+  public int processWithChecksums(ByteBuffer input, ByteBuffer output,
+      int bytesPerChecksum, int[] checksums, int checksumOff) {
+    if (mode != Constants.MODE_CTR) {
+      throw new UnsupportedOperationException();
+    }
+    if (bytesPerChecksum <= 0 || bytesPerChecksum > MAX_BYTES_PER_CHECKSUM) {
+      throw new IllegalArgumentException("Invalid bytes per checksum: "
+          + bytesPerChecksum);
+    }
+    int inLen = input.remaining();
+    int count = (int) (((long) inLen + bytesPerChecksum - 1) / bytesPerChecksum);
+    if (inLen > output.remaining()) {
+      throw new DataLengthException("output buffer too short");
+    }
+    if (checksumOff < 0 || checksumOff > checksums.length - count) {
+      throw new DataLengthException("checksum array too short");
+    }
+    checkCipherInit();
+    int len = processChecksummed(aesContext, input, input.position(), inLen,
+        output, output.position(), bytesPerChecksum, checksums, checksumOff);
+    input.position(input.limit());
+    output.position(output.position() + len);
+    return len;
+  }
+
+  /**
+   * @return the native context, for the jobs of {@link AsyncCipher}
+   */
+  long getContext() {
+    checkCipherInit();
+    return aesContext;
+  }
+
+  /**
+   * @return the most bytes an update of <code>inLen</code> bytes, followed
+   *         by the final call if <code>isFinal</code> is set, writes
+   */
+  int getOutputBound(int inLen, boolean isFinal) {
+    int bound = inLen;
+    if (mode == Constants.MODE_CBC) {
+      bound += Constants.AES_BLOCK_SIZE;
+    } else if (mode == Constants.MODE_GCM && isFinal && forEncryption) {
+      bound += tagLen;
+    }
+    return bound;
+  }
+
+  private void checkXTSSectors(int inAvailable, int inLen, int outAvailable,
+      int dataUnitSize) {
+    if (mode != Constants.MODE_XTS) {
+      throw new UnsupportedOperationException();
+    }
+    if (inLen < 0 || inLen > inAvailable) {
+      throw new DataLengthException("input buffer too short");
+    }
+    if (inLen > outAvailable) {
+      throw new DataLengthException("output buffer too short");
+    }
+    if (dataUnitSize < Constants.AES_BLOCK_SIZE
+        || dataUnitSize % Constants.AES_BLOCK_SIZE != 0) {
+      throw new IllegalArgumentException("Invalid data unit size: " + dataUnitSize);
+    }
+  }
+
   private void checkCipherInit() {
     if (aesContext == 0) {
       init(forEncryption, params);
@@ -211,7 +357,21 @@ public class AESOpensslEngine implements BlockCipher {
 
   private native void setTag(long context, byte[] tag, int tagOff, int tLen);
   private native void getTag(long context, byte[] out, int outOff, int tLen);
+  private native void setTagLen(long context, int tLen);
 
   private native void updateAADFromByteArray(long context, byte[] src, int offset, int len);
   private native void updateAADFromByteBuffer(long context, ByteBuffer src, int inputPos, int inputLimit);
+
+  private native void seek(long context, long position);
+
+  private native int processSectors(long context, byte[] in, int inOff,
+      int inLen, byte[] out, int outOff, int dataUnitSize, long startSector);
+
+  private native int processChecksummed(long context, ByteBuffer input,
+      int inputPos, int inputLength, ByteBuffer output, int outputPos,
+      int bytesPerChecksum, int[] checksums, int checksumOff);
+
+  private native int processSectorsByteBuffer(long context, ByteBuffer input,
+      int inputPos, int inLen, ByteBuffer output, int outputPos,
+      int dataUnitSize, long startSector);
 }
@@ -0,0 +1,211 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+import com.intel.diceros.crypto.DataLengthException;
+
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+
+/**
+ * Submits the updates of one {@link AESOpensslEngine} to the native workers
+ * of an {@link AsyncCipherService}. The jobs run in submission order, a job
+ * with <code>isFinal</code> set ends the message like
+ * <code>doFinal</code>.
+ * <p>
+ * The buffers must be direct, and belong to the job until it completes:
+ * then the input is consumed and the output position is advanced by the
+ * bytes written, as with {@link AESOpensslEngine#processByteBuffer}.
+ */
+public final class AsyncCipher {
+  private final AsyncCipherService service;
+  private final AESOpensslEngine engine;
+  private long session;
+  private int inFlight = 0;
+
+  AsyncCipher(AsyncCipherService service, AESOpensslEngine engine,
+      long session) {
+    this.service = service;
+    this.engine = engine;
+    this.session = session;
+  }
+
+  /**
+   * Queue one job.
+   *
+   * @param callback notified on completion, may be null
+   * @return the number of bytes written, once the job completed
+   */
+  public Future<Integer> submit(ByteBuffer input, ByteBuffer output,
+      boolean isFinal, AsyncCallback callback) {
+    return submit(new ByteBuffer[] { input }, new ByteBuffer[] { output },
+        new boolean[] { isFinal }, callback).get(0);
+  }
+
+  /**
+   * Queue a batch of jobs with a single native call, job i processes
+   * <code>inputs[i]</code> into <code>outputs[i]</code>.
+   *
+   * @param callback notified once per job, may be null
+   */
+  public List<Future<Integer>> submit(ByteBuffer[] inputs,
+      ByteBuffer[] outputs, boolean[] isFinal, AsyncCallback callback) {
+    if (inputs.length != outputs.length || inputs.length != isFinal.length) {
+      throw new IllegalArgumentException("Batch arrays differ in length");
+    }
+    Job[] jobs = new Job[inputs.length];
+    List<Future<Integer>> futures = new ArrayList<Future<Integer>>(jobs.length);
+    for (int i = 0; i < jobs.length; i++) {
+      if (!inputs[i].isDirect() || !outputs[i].isDirect()) {
+        throw new IllegalArgumentException("Only direct buffers are supported");
+      }
+      if (outputs[i].remaining() < engine.getOutputBound(inputs[i].remaining(),
+          isFinal[i])) {
+        throw new DataLengthException("output buffer too short");
+      }
+      jobs[i] = new Job(inputs[i], outputs[i], isFinal[i], callback);
+      futures.add(jobs[i]);
+    }
+
+    synchronized (this) {
+      if (session == 0) {
+        throw new IllegalStateException("Cipher is closed");
+      }
+      inFlight += jobs.length;
+    }
+    try {
+      service.submit(session, jobs);
+    } catch (RuntimeException e) {
+      finished(jobs.length);
+      throw e;
+    }
+    return futures;
+  }
+
+  /**
+   * Wait for the jobs in flight and release the native session. The engine
+   * can be used directly again afterwards.
+   */
+  public synchronized void close() throws InterruptedException {
+    while (inFlight > 0) {
+      wait();
+    }
+    if (session != 0) {
+      service.closeSession(session);
+      session = 0;
+    }
+  }
+
+  private synchronized void finished(int count) {
+    inFlight -= count;
+    if (inFlight == 0) {
+      notifyAll();
+    }
+  }
+
+  /**
+   * A queued job and its future.
+   */
+  final class Job implements Future<Integer> {
+    final ByteBuffer input;
+    final ByteBuffer output;
+    final int outputPosition;
+    final boolean isFinal;
+    private final AsyncCallback callback;
+    private final CountDownLatch done = new CountDownLatch(1);
+    private int length;
+    private Exception error;
+
+    Job(ByteBuffer input, ByteBuffer output, boolean isFinal,
+        AsyncCallback callback) {
+      this.input = input;
+      this.output = output;
+      this.outputPosition = output.position();
+      this.isFinal = isFinal;
+      this.callback = callback;
+    }
+
+    void complete(int length, Exception error) {
+      if (error == null) {
+        input.position(input.limit());
+        output.position(outputPosition + length);
+      }
+      this.length = length;
+      this.error = error;
+      done.countDown();
+      finished(1);
+      if (callback == null) {
+        return;
+      }
+      try {
+        if (error == null) {
+          callback.completed(length);
+        } else {
+          callback.failed(error);
+        }
+      } catch (RuntimeException e) {
+        // a failing callback must not stop the completion thread
+      }
+    }
+
+    @Override
+    public boolean cancel(boolean mayInterruptIfRunning) {
+      // a queued job is owned by the native workers
+      return false;
+    }
+
+    @Override
+    public boolean isCancelled() {
+      return false;
+    }
+
+    @Override
+    public boolean isDone() {
+      return done.getCount() == 0;
+    }
+
+    @Override
+    public Integer get() throws InterruptedException, ExecutionException {
+      done.await();
+      return result();
+    }
+
+    @Override
+    public Integer get(long timeout, TimeUnit unit)
+        throws InterruptedException, ExecutionException, TimeoutException {
+      if (!done.await(timeout, unit)) {
+        throw new TimeoutException();
+      }
+      return result();
+    }
+
+    private Integer result() throws ExecutionException {
+      if (error != null) {
+        throw new ExecutionException(error);
+      }
+      return Integer.valueOf(length);
+    }
+  }
+}
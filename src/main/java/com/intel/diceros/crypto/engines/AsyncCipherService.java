@@ -0,0 +1,199 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+import java.nio.ByteBuffer;
+import java.security.GeneralSecurityException;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLong;
+
+import javax.crypto.BadPaddingException;
+
+/**
+ * Runs cipher jobs on native worker threads, so that the callers can go on
+ * with their I/O while the data is encrypted.
+ * <p>
+ * Every {@link AsyncCipher} of a service runs its jobs one at a time and in
+ * submission order, different ciphers run in parallel. Finished jobs are
+ * completed on a single daemon thread of the service, which updates the
+ * buffer positions, completes the futures and calls the callbacks.
+ */
+public final class AsyncCipherService {
+  // keep in sync with aes_openssl.h
+  static final int ERROR_UPDATE = -1;
+  static final int ERROR_FINAL = -2;
+  static final int ERROR_SHORT_INPUT = -3;
+  static final int ERROR_TAG = -4;
+
+  // finished jobs fetched per native call
+  private static final int POLL_BATCH = 64;
+
+  private final ConcurrentHashMap<Long, AsyncCipher.Job> pending =
+      new ConcurrentHashMap<Long, AsyncCipher.Job>();
+  private final AtomicLong nextId = new AtomicLong();
+  private final Thread completer;
+  private long queue;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  /**
+   * @param threads the number of native worker threads
+   */
+  public AsyncCipherService(int threads) {
+    if (threads < 1) {
+      throw new IllegalArgumentException("Invalid thread count: " + threads);
+    }
+    queue = create(threads);
+    completer = new Thread(new Runnable() {
+      @Override
+      public void run() {
+        complete();
+      }
+    }, "diceros-async-completer");
+    completer.setDaemon(true);
+    completer.start();
+  }
+
+  /**
+   * Create a cipher which submits the jobs of <code>engine</code>. The
+   * engine must be initialized and must not be used directly while the
+   * cipher has jobs in flight.
+   */
+  public synchronized AsyncCipher newCipher(AESOpensslEngine engine) {
+    checkOpen();
+    return new AsyncCipher(this, engine, openSession(queue,
+        engine.getContext()));
+  }
+
+  /**
+   * Finish the submitted jobs and stop the worker threads.
+   */
+  public void close() throws InterruptedException {
+    synchronized (this) {
+      if (queue == 0) {
+        return;
+      }
+      shutdown(queue);
+    }
+    completer.join();
+    synchronized (this) {
+      destroy(queue);
+      queue = 0;
+    }
+  }
+
+  /**
+   * Queue the jobs of one session in a single native call.
+   */
+  synchronized void submit(long session, AsyncCipher.Job[] jobs) {
+    checkOpen();
+    int count = jobs.length;
+    long[] ids = new long[count];
+    ByteBuffer[] inputs = new ByteBuffer[count];
+    ByteBuffer[] outputs = new ByteBuffer[count];
+    int[] ranges = new int[count * 3];
+    boolean[] isFinal = new boolean[count];
+    for (int i = 0; i < count; i++) {
+      AsyncCipher.Job job = jobs[i];
+      ids[i] = nextId.incrementAndGet();
+      inputs[i] = job.input;
+      outputs[i] = job.output;
+      ranges[3 * i] = job.input.position();
+      ranges[3 * i + 1] = job.input.remaining();
+      ranges[3 * i + 2] = job.outputPosition;
+      isFinal[i] = job.isFinal;
+      pending.put(ids[i], job);
+    }
+    boolean queued = false;
+    try {
+      queued = submit(queue, session, ids, inputs, outputs, ranges, isFinal,
+          count);
+    } finally {
+      if (!queued) {
+        for (int i = 0; i < count; i++) {
+          pending.remove(ids[i]);
+        }
+      }
+    }
+    if (!queued) {
+      throw new IllegalStateException("Service is closed");
+    }
+  }
+
+  synchronized void closeSession(long session) {
+    closeSession(queue, session);
+  }
+
+  private void checkOpen() {
+    if (queue == 0) {
+      throw new IllegalStateException("Service is closed");
+    }
+  }
+
+  private void complete() {
+    long[] ids = new long[POLL_BATCH];
+    int[] results = new int[POLL_BATCH];
+    int count;
+    // the queue is only destroyed after this thread ended
+    while ((count = poll(queue, ids, results)) > 0) {
+      for (int i = 0; i < count; i++) {
+        AsyncCipher.Job job = pending.remove(ids[i]);
+        if (results[i] >= 0) {
+          job.complete(results[i], null);
+        } else {
+          job.complete(0, toException(results[i]));
+        }
+      }
+    }
+  }
+
+  private static Exception toException(int error) {
+    switch (error) {
+    case ERROR_UPDATE:
+      return new GeneralSecurityException(
+          "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
+    case ERROR_SHORT_INPUT:
+      return new GeneralSecurityException("input is too short");
+    case ERROR_TAG:
+      return new BadPaddingException("Tag mismatch!");
+    default:
+      return new GeneralSecurityException(
+          "Error in EVP_EncryptFinal_ex or EVP_DecryptFinal_ex");
+    }
+  }
+
+  private static native long create(int threads);
+
+  private static native void shutdown(long queue);
+
+  private static native void destroy(long queue);
+
+  private static native long openSession(long queue, long context);
+
+  private static native void closeSession(long queue, long session);
+
+  private static native boolean submit(long queue, long session, long[] ids,
+      ByteBuffer[] inputs, ByteBuffer[] outputs, int[] ranges, boolean[] isFinal,
+      int count);
+
+  private static native int poll(long queue, long[] ids, int[] results);
+}
@@ -0,0 +1,99 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+/**
+ * View of the native dispatch registry: the CPU features probed at library
+ * load and the kernels bound for them.
+ * <p>
+ * One-shot multi-buffer CBC encryption writes the 8 lane format unless wide
+ * output is enabled, either with {@link #setWideOutput(boolean)} or with the
+ * system property below, which is read when the class is loaded. Only
+ * enable it when every reader of the ciphertext knows the 16 lane format.
+ */
+public final class KernelDispatch {
+  // keep in sync with cpu_features.h
+  public static final int CPU_FEATURE_AESNI = 0x01;
+  public static final int CPU_FEATURE_PCLMUL = 0x02;
+  public static final int CPU_FEATURE_AVX2 = 0x04;
+  public static final int CPU_FEATURE_AVX512F = 0x08;
+  public static final int CPU_FEATURE_VAES = 0x10;
+  public static final int CPU_FEATURE_SHANI = 0x20;
+  public static final int CPU_FEATURE_RDRAND = 0x40;
+  public static final int CPU_FEATURE_RDSEED = 0x80;
+  public static final int CPU_FEATURE_SSE42 = 0x100;
+
+  /** true to let one-shot CBC encryption use all 16 lanes */
+  public static final String WIDE_OUTPUT_PROPERTY = "diceros.mbcbc.wide";
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+    setWideOutput(Boolean.getBoolean(WIDE_OUTPUT_PROPERTY));
+  }
+
+  private KernelDispatch() {
+  }
+
+  /**
+   * Load the class, and with it the system property. The multi-buffer
+   * engine calls this before its first message.
+   */
+  public static void ensureConfigured() {
+  }
+
+  /**
+   * @return true if the CPU (and the OS) support all the given features
+   */
+  public static boolean hasFeatures(int features) {
+    return (getCpuFeatures() & features) == features;
+  }
+
+  /**
+   * @return the bitmask of the supported CPU_FEATURE_* flags
+   */
+  public static native int getCpuFeatures();
+
+  /**
+   * @return the number of lanes of the multi-buffer CBC encryption kernel
+   */
+  public static native int getLanes();
+
+  /**
+   * @param mode one of the Constants.MODE_* values
+   * @param forEncryption the direction
+   * @param keyLength the key length in bytes
+   * @return the name of the bound kernel, or null if openssl is used (only
+   *         CBC and GCM have in-tree kernels)
+   */
+  public static native String getKernelName(int mode, boolean forEncryption,
+      int keyLength);
+
+  /**
+   * @param enabled true to write the 16 lane one-shot CBC format on hosts
+   *        with the wide kernel, false for the 8 lane format every build
+   *        reads
+   */
+  public static native void setWideOutput(boolean enabled);
+
+  /**
+   * @return true if one-shot CBC encryption may write the 16 lane format
+   */
+  public static native boolean isWideOutput();
+}
@@ -0,0 +1,84 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.engines;
+
+/**
+ * The native worker pool which splits very large CTR, XTS and multi-buffer
+ * CBC decryption jobs, and large DRNG fills, into chunks run on several
+ * cores.
+ * <p>
+ * The pool is off unless a thread count is set, either with
+ * {@link #configure(int, int, int)} or with the system properties below,
+ * which are read when the class is loaded. Jobs smaller than the threshold,
+ * and jobs submitted while another one is running, take the single thread
+ * path.
+ */
+public final class WorkerPool {
+  /** extra threads next to the caller, 0 disables the pool */
+  public static final String THREADS_PROPERTY = "diceros.workpool.threads";
+  /** the smallest job in bytes split over the pool */
+  public static final String THRESHOLD_PROPERTY = "diceros.workpool.threshold";
+  /** the bytes per chunk, a multiple of 4096 */
+  public static final String CHUNK_SIZE_PROPERTY = "diceros.workpool.chunk";
+
+  // keep in sync with work_pool.h
+  public static final int MAX_THREADS = 64;
+  public static final int DEFAULT_THRESHOLD = 8 * 1024 * 1024;
+  public static final int DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+    // invalid properties leave the pool off rather than fail the engines
+    configurePool(Integer.getInteger(THREADS_PROPERTY, 0).intValue(),
+        Integer.getInteger(THRESHOLD_PROPERTY, DEFAULT_THRESHOLD).intValue(),
+        Integer.getInteger(CHUNK_SIZE_PROPERTY, DEFAULT_CHUNK_SIZE).intValue(),
+        false);
+  }
+
+  private WorkerPool() {
+  }
+
+  /**
+   * Load the class, and with it the system properties. The engines and the
+   * DRNG call this so that the pool is set up before their first job.
+   */
+  public static void ensureConfigured() {
+  }
+
+  /**
+   * Replace the worker threads, waits for a running job to finish.
+   *
+   * @param threads the worker threads next to the calling thread, 0 to
+   *        disable the pool
+   * @param threshold jobs below this many bytes stay single threaded
+   * @param chunkSize the bytes per chunk, a multiple of 4096
+   */
+  public static void configure(int threads, int threshold, int chunkSize) {
+    configurePool(threads, threshold, chunkSize, true);
+  }
+
+  /**
+   * @return the number of worker threads, 0 if the pool is off
+   */
+  public static native int getThreads();
+
+  private static native void configurePool(int threads, int threshold,
+      int chunkSize, boolean strict);
+}
@@ -0,0 +1,237 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.crypto.macs;
+
+import java.nio.ByteBuffer;
+import java.security.GeneralSecurityException;
+import java.security.InvalidAlgorithmParameterException;
+import java.security.InvalidKeyException;
+import java.security.MessageDigest;
+
+/**
+ * HMAC, AES-CMAC and AES-GMAC computed by openssl in the native library.
+ * <p>
+ * The key state (the HMAC pads, the AES key schedule) is computed once per
+ * key: initializing again with an equal key only restarts the message.
+ * GMAC authenticates the message as GCM additional data and needs a fresh
+ * nonce for every message, so after {@link #doFinal} it must be initialized
+ * again before the next message.
+ * <p>
+ * An instance is not thread safe.
+ */
+public class NativeMac {
+  // keep in sync with NativeMac.c
+  public static final int HMAC_SHA1 = 1;
+  public static final int HMAC_SHA256 = 2;
+  public static final int HMAC_SHA512 = 3;
+  public static final int CMAC_AES = 4;
+  public static final int GMAC_AES = 5;
+
+  private final int type;
+  private final byte[] single = new byte[1];
+  private byte[] key = null;
+  private boolean ready = false;
+  private long context = 0;
+
+  static {
+    System.loadLibrary("crypto");
+    System.loadLibrary("diceros");
+  }
+
+  public NativeMac(int type) {
+    this.type = type;
+    this.context = create(type);
+  }
+
+  private NativeMac(NativeMac other) {
+    this.type = other.type;
+    this.key = other.key == null ? null : other.key.clone();
+    this.ready = other.ready;
+    this.context = copy(other.context);
+  }
+
+  public int getMacLength() {
+    switch (type) {
+    case HMAC_SHA1:
+      return 20;
+    case HMAC_SHA256:
+      return 32;
+    case HMAC_SHA512:
+      return 64;
+    default:
+      return 16;
+    }
+  }
+
+  /**
+   * @param key the mac key, an AES key for CMAC and GMAC
+   * @param iv the GMAC nonce, ignored by the other macs
+   */
+  public void init(byte[] key, byte[] iv) throws InvalidKeyException,
+      InvalidAlgorithmParameterException {
+    checkContext();
+    if (type == GMAC_AES && iv == null) {
+      throw new InvalidAlgorithmParameterException("GMAC needs a nonce");
+    }
+    ready = false;
+    if (this.key != null && MessageDigest.isEqual(this.key, key)) {
+      // keep the precomputed key state
+      init(context, null, iv);
+    } else {
+      clearKey();
+      init(context, key, iv);
+      this.key = key.clone();
+    }
+    ready = true;
+  }
+
+  public void update(byte in) {
+    single[0] = in;
+    update(single, 0, 1);
+  }
+
+  public void update(byte[] in, int inOff, int len) {
+    checkReady();
+    if (inOff < 0 || len < 0 || inOff > in.length - len) {
+      throw new IllegalArgumentException("Input out of the array bounds");
+    }
+    if (len > 0) {
+      updateArray(context, in, inOff, len);
+    }
+  }
+
+  /**
+   * Authenticate the remaining bytes of <code>input</code> and move its
+   * position to the limit. Direct buffers are read in place.
+   */
+  public void update(ByteBuffer input) {
+    checkReady();
+    int len = input.remaining();
+    if (len == 0) {
+      return;
+    }
+    if (input.isDirect()) {
+      updateDirect(context, input, input.position(), len);
+      input.position(input.limit());
+    } else if (input.hasArray()) {
+      update(input.array(), input.arrayOffset() + input.position(), len);
+      input.position(input.limit());
+    } else {
+      byte[] data = new byte[len];
+      input.get(data);
+      update(data, 0, len);
+    }
+  }
+
+  /**
+   * Write the mac to <code>out</code>. HMAC and CMAC are ready for the next
+   * message with the same key afterwards.
+   *
+   * @return the mac length
+   */
+  public int doFinal(byte[] out, int outOff) {
+    checkReady();
+    if (outOff < 0 || outOff > out.length - getMacLength()) {
+      throw new IllegalArgumentException("Output buffer too short");
+    }
+    if (type == GMAC_AES) {
+      ready = false;
+    }
+    return doFinal(context, out, outOff);
+  }
+
+  /**
+   * Restart the message with the current key. A GMAC needs to be
+   * initialized with a new nonce instead.
+   */
+  public void reset() {
+    checkContext();
+    ready = false;
+    if (key != null && type != GMAC_AES) {
+      try {
+        init(context, null, null);
+      } catch (GeneralSecurityException e) {
+        throw new IllegalStateException("Cannot restart the mac", e);
+      }
+      ready = true;
+    }
+  }
+
+  /**
+   * @return an independent mac in the same state
+   */
+  public NativeMac copy() {
+    checkContext();
+    return new NativeMac(this);
+  }
+
+  public synchronized void close() {
+    if (context != 0) {
+      destroy(context);
+      context = 0;
+    }
+    clearKey();
+  }
+
+  @Override
+  protected void finalize() throws Throwable {
+    try {
+      close();
+    } finally {
+      super.finalize();
+    }
+  }
+
+  private void clearKey() {
+    if (key != null) {
+      java.util.Arrays.fill(key, (byte) 0);
+      key = null;
+    }
+  }
+
+  private void checkContext() {
+    if (context == 0) {
+      throw new IllegalStateException("Mac is closed");
+    }
+  }
+
+  private void checkReady() {
+    checkContext();
+    if (!ready) {
+      throw new IllegalStateException("Mac is not initialized");
+    }
+  }
+
+  private static native long create(int type);
+
+  private static native long copy(long context);
+
+  private static native void destroy(long context);
+
+  private static native void init(long context, byte[] key, byte[] iv)
+      throws InvalidKeyException, InvalidAlgorithmParameterException;
+
+  private static native void updateArray(long context, byte[] in, int inOff,
+      int inLen);
+
+  private static native void updateDirect(long context,
+      ByteBuffer inputDirectBuffer, int start, int inputLength);
+
+  private static native int doFinal(long context, byte[] out, int outOff);
+}
@@ -162,6 +162,11 @@ public class CBCBlockCipher implements BlockCipher {
     throw new UnsupportedOperationException();
   }
 
+  @Override
+  public void setTagLen(int tLen) {
+    throw new UnsupportedOperationException();
+  }
+
   @Override
   public void updateAAD(byte[] src, int offset, int len) {
     throw new UnsupportedOperationException();
@@ -171,4 +176,9 @@ public class CBCBlockCipher implements BlockCipher {
   public void updateAAD(ByteBuffer src) {
     throw new UnsupportedOperationException();
   }
+
+  @Override
+  public void seek(long position) {
+    throw new UnsupportedOperationException();
+  }
 }
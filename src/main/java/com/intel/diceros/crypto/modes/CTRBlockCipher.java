@@ -137,6 +137,11 @@ public class CTRBlockCipher implements BlockCipher {
     throw new UnsupportedOperationException();
   }
 
+  @Override
+  public void setTagLen(int tLen) {
+    throw new UnsupportedOperationException();
+  }
+
   @Override
   public void updateAAD(byte[] src, int offset, int len) {
     throw new UnsupportedOperationException();
@@ -146,4 +151,28 @@ public class CTRBlockCipher implements BlockCipher {
   public void updateAAD(ByteBuffer src) {
     throw new UnsupportedOperationException();
   }
+
+  @Override
+  public void seek(long position) {
+    cipher.seek(position);
+  }
+
+  /**
+   * Positioned read: process <code>inLen</code> bytes which start at byte
+   * <code>position</code> of the stream.
+   */
+  public int processBlock(long position, byte[] in, int inOff, int inLen,
+                          byte[] out, int outOff) {
+    cipher.seek(position);
+    return cipher.processBlock(in, inOff, inLen, out, outOff);
+  }
+
+  /**
+   * Positioned read: process the remaining bytes of <code>input</code> which
+   * start at byte <code>position</code> of the stream.
+   */
+  public int processByteBuffer(long position, ByteBuffer input, ByteBuffer output) {
+    cipher.seek(position);
+    return cipher.processByteBuffer(input, output, true);
+  }
 }
@@ -23,6 +23,7 @@ import java.security.ProviderException;
 
 import com.intel.diceros.crypto.BlockCipher;
 import com.intel.diceros.crypto.DataLengthException;
+import com.intel.diceros.crypto.engines.AESOpensslEngine;
 import com.intel.diceros.crypto.params.CipherParameters;
 import com.intel.diceros.crypto.params.KeyParameter;
 import com.intel.diceros.crypto.params.ParametersWithIV;
@@ -98,6 +99,31 @@ public class XTSBlockCipher implements BlockCipher{
     return cipher.processByteBuffer(input, output, isUpdate);
   }
 
+  /**
+   * Encrypt or decrypt a run of data units in one call, unit i being sector
+   * <code>startSector + i</code>. See
+   * {@link AESOpensslEngine#processSectors(byte[], int, int, byte[], int, int, long)}.
+   */
+  public int processSectors(byte[] in, int inOff, int inLen, byte[] out,
+      int outOff, int dataUnitSize, long startSector) {
+    return sectorEngine().processSectors(in, inOff, inLen, out, outOff,
+        dataUnitSize, startSector);
+  }
+
+  public int processSectors(ByteBuffer input, ByteBuffer output,
+      int dataUnitSize, long startSector) {
+    return sectorEngine().processSectors(input, output, dataUnitSize,
+        startSector);
+  }
+
+  private AESOpensslEngine sectorEngine() {
+    if (!(cipher instanceof AESOpensslEngine)) {
+      throw new UnsupportedOperationException(
+          "Sector processing needs the openssl engine");
+    }
+    return (AESOpensslEngine) cipher;
+  }
+
   @Override
   public void reset() {
     cipher.reset();
@@ -138,6 +164,11 @@ public class XTSBlockCipher implements BlockCipher{
     throw new UnsupportedOperationException();
   }
 
+  @Override
+  public void setTagLen(int tLen) {
+    throw new UnsupportedOperationException();
+  }
+
   @Override
   public void updateAAD(byte[] src, int offset, int len) {
     throw new UnsupportedOperationException();
@@ -147,4 +178,9 @@ public class XTSBlockCipher implements BlockCipher{
   public void updateAAD(ByteBuffer src) {
     throw new UnsupportedOperationException();
   }
+
+  @Override
+  public void seek(long position) {
+    throw new UnsupportedOperationException();
+  }
 }
@@ -32,6 +32,8 @@ import java.security.Provider;
  * <p>Supported algorithms and their names:
  * <p>- AES (CTR mode, CBC mode, MBCBC mode, XTS mode, GCM mode)
  * <p>- SecureRandom (DRNG)
+ * <p>- MessageDigest (SHA-1, SHA-256)
+ * <p>- Mac (HmacSHA1, HmacSHA256, HmacSHA512, AESCMAC, AESGMAC)
  */
 public final class DicerosProvider extends Provider implements
         ConfigurableProvider {
@@ -41,11 +43,15 @@ public final class DicerosProvider extends Provider implements
   private static final long serialVersionUID = -5933716767994628685L;
 
   private static String info = "Diceros Provider v1.0, implementing AES encryption of CTR mode," +
-      "CBC mode, MBCBC mode, XTS mode, GCM mode and SecureRandom based on DRNG";
+      "CBC mode, MBCBC mode, XTS mode, GCM mode, SecureRandom based on DRNG, SHA-1/SHA-256 digests and HMAC/CMAC/GMAC";
   private static final String SYMMETRIC_PACKAGE = "com.intel.diceros.provider.symmetric.";
   private static final String[] SYMMETRIC_CIPHERS = {"AESAlgorithmProvider"};
   private static final String SECURERANDOM_PACKAGE = "com.intel.diceros.provider.securerandom.";
   private static final String[] SECURERANDOM = {"SecureRandomAlgorithmProvider"};
+  private static final String DIGEST_PACKAGE = "com.intel.diceros.provider.digest.";
+  private static final String[] DIGESTS = {"DigestAlgorithmProvider"};
+  private static final String MAC_PACKAGE = "com.intel.diceros.provider.mac.";
+  private static final String[] MACS = {"MacAlgorithmProvider"};
 
   public DicerosProvider() {
     super(PROVIDER_NAME, 1.0, info);
@@ -64,6 +70,8 @@ public final class DicerosProvider extends Provider implements
   private void setup() {
     loadAlgorithms(SYMMETRIC_PACKAGE, SYMMETRIC_CIPHERS);
     loadAlgorithms(SECURERANDOM_PACKAGE, SECURERANDOM);
+    loadAlgorithms(DIGEST_PACKAGE, DIGESTS);
+    loadAlgorithms(MAC_PACKAGE, MACS);
   }
 
   private void loadAlgorithms(String packageName, String[] names) {
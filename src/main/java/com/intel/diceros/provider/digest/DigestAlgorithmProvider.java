@@ -0,0 +1,38 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.provider.digest;
+
+import com.intel.diceros.provider.config.ConfigurableProvider;
+import com.intel.diceros.provider.util.AlgorithmProvider;
+
+public class DigestAlgorithmProvider extends AlgorithmProvider {
+  private static final String PREFIX = SHA.class.getName();
+
+  public DigestAlgorithmProvider() {
+  }
+
+  @Override
+  public void configure(ConfigurableProvider provider) {
+    provider.addAlgorithm("MessageDigest.SHA-1", PREFIX + "$SHA1");
+    provider.addAlgorithm("Alg.Alias.MessageDigest.SHA1", "SHA-1");
+    provider.addAlgorithm("Alg.Alias.MessageDigest.SHA", "SHA-1");
+    provider.addAlgorithm("MessageDigest.SHA-256", PREFIX + "$SHA256");
+    provider.addAlgorithm("Alg.Alias.MessageDigest.SHA256", "SHA-256");
+  }
+}
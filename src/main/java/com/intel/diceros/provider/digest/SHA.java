@@ -0,0 +1,99 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.provider.digest;
+
+import com.intel.diceros.crypto.digests.SHADigest;
+
+import java.nio.ByteBuffer;
+import java.security.DigestException;
+import java.security.MessageDigestSpi;
+
+/**
+ * MessageDigest SPIs of SHA-1 and SHA-256 backed by {@link SHADigest}.
+ */
+public class SHA {
+
+  private static class Base extends MessageDigestSpi implements Cloneable {
+    private SHADigest digest;
+
+    Base(int algorithm) {
+      digest = new SHADigest(algorithm);
+    }
+
+    @Override
+    protected int engineGetDigestLength() {
+      return digest.getDigestLength();
+    }
+
+    @Override
+    protected void engineUpdate(byte input) {
+      digest.update(input);
+    }
+
+    @Override
+    protected void engineUpdate(byte[] input, int offset, int len) {
+      digest.update(input, offset, len);
+    }
+
+    @Override
+    protected void engineUpdate(ByteBuffer input) {
+      digest.update(input);
+    }
+
+    @Override
+    protected byte[] engineDigest() {
+      byte[] out = new byte[digest.getDigestLength()];
+      digest.doFinal(out, 0);
+      return out;
+    }
+
+    @Override
+    protected int engineDigest(byte[] buf, int offset, int len)
+        throws DigestException {
+      if (len < digest.getDigestLength()) {
+        throw new DigestException("Output buffer too short");
+      }
+      return digest.doFinal(buf, offset);
+    }
+
+    @Override
+    protected void engineReset() {
+      digest.reset();
+    }
+
+    @Override
+    public Object clone() throws CloneNotSupportedException {
+      Base copy = (Base) super.clone();
+      copy.digest = digest.copy();
+      return copy;
+    }
+  }
+
+  public static final class SHA1 extends Base {
+    public SHA1() {
+      super(SHADigest.SHA1);
+    }
+  }
+
+  public static final class SHA256 extends Base {
+    public SHA256() {
+      super(SHADigest.SHA256);
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.provider.mac;
+
+import com.intel.diceros.crypto.macs.NativeMac;
+
+import java.nio.ByteBuffer;
+import java.security.InvalidAlgorithmParameterException;
+import java.security.InvalidKeyException;
+import java.security.Key;
+import java.security.spec.AlgorithmParameterSpec;
+
+import javax.crypto.MacSpi;
+import javax.crypto.spec.IvParameterSpec;
+
+/**
+ * Mac SPIs of HMAC, AES-CMAC and AES-GMAC backed by {@link NativeMac}.
+ */
+public class MAC {
+
+  private static class Base extends MacSpi implements Cloneable {
+    private final int type;
+    private NativeMac mac;
+
+    Base(int type) {
+      this.type = type;
+      this.mac = new NativeMac(type);
+    }
+
+    @Override
+    protected int engineGetMacLength() {
+      return mac.getMacLength();
+    }
+
+    @Override
+    protected void engineInit(Key key, AlgorithmParameterSpec params)
+        throws InvalidKeyException, InvalidAlgorithmParameterException {
+      if (key == null || key.getEncoded() == null) {
+        throw new InvalidKeyException("Key must be a raw secret key");
+      }
+      byte[] iv = null;
+      if (type == NativeMac.GMAC_AES) {
+        if (params instanceof IvParameterSpec) {
+          iv = ((IvParameterSpec) params).getIV();
+        } else {
+          throw new InvalidAlgorithmParameterException("GMAC needs a nonce");
+        }
+      } else if (params != null) {
+        throw new InvalidAlgorithmParameterException(
+            "No parameters expected");
+      }
+      mac.init(key.getEncoded(), iv);
+    }
+
+    @Override
+    protected void engineUpdate(byte input) {
+      mac.update(input);
+    }
+
+    @Override
+    protected void engineUpdate(byte[] input, int offset, int len) {
+      mac.update(input, offset, len);
+    }
+
+    @Override
+    protected void engineUpdate(ByteBuffer input) {
+      mac.update(input);
+    }
+
+    @Override
+    protected byte[] engineDoFinal() {
+      byte[] out = new byte[mac.getMacLength()];
+      mac.doFinal(out, 0);
+      return out;
+    }
+
+    @Override
+    protected void engineReset() {
+      mac.reset();
+    }
+
+    @Override
+    public Object clone() throws CloneNotSupportedException {
+      Base copy = (Base) super.clone();
+      copy.mac = mac.copy();
+      return copy;
+    }
+  }
+
+  public static final class HmacSHA1 extends Base {
+    public HmacSHA1() {
+      super(NativeMac.HMAC_SHA1);
+    }
+  }
+
+  public static final class HmacSHA256 extends Base {
+    public HmacSHA256() {
+      super(NativeMac.HMAC_SHA256);
+    }
+  }
+
+  public static final class HmacSHA512 extends Base {
+    public HmacSHA512() {
+      super(NativeMac.HMAC_SHA512);
+    }
+  }
+
+  public static final class AESCMAC extends Base {
+    public AESCMAC() {
+      super(NativeMac.CMAC_AES);
+    }
+  }
+
+  /**
+   * Needs a nonce as {@link IvParameterSpec} on every init, a finished mac
+   * must be initialized with a new nonce. The tag has 128 bits.
+   */
+  public static final class AESGMAC extends Base {
+    public AESGMAC() {
+      super(NativeMac.GMAC_AES);
+    }
+  }
+}
@@ -0,0 +1,40 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.provider.mac;
+
+import com.intel.diceros.provider.config.ConfigurableProvider;
+import com.intel.diceros.provider.util.AlgorithmProvider;
+
+public class MacAlgorithmProvider extends AlgorithmProvider {
+  private static final String PREFIX = MAC.class.getName();
+
+  public MacAlgorithmProvider() {
+  }
+
+  @Override
+  public void configure(ConfigurableProvider provider) {
+    provider.addAlgorithm("Mac.HmacSHA1", PREFIX + "$HmacSHA1");
+    provider.addAlgorithm("Mac.HmacSHA256", PREFIX + "$HmacSHA256");
+    provider.addAlgorithm("Mac.HmacSHA512", PREFIX + "$HmacSHA512");
+    provider.addAlgorithm("Mac.AESCMAC", PREFIX + "$AESCMAC");
+    provider.addAlgorithm("Alg.Alias.Mac.AES-CMAC", "AESCMAC");
+    provider.addAlgorithm("Mac.AESGMAC", PREFIX + "$AESGMAC");
+    provider.addAlgorithm("Alg.Alias.Mac.AES-GMAC", "AESGMAC");
+  }
+}
@@ -18,7 +18,11 @@
 
 package com.intel.diceros.provider.securerandom;
 
+import com.intel.diceros.crypto.engines.WorkerPool;
+
 import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+import java.security.ProviderException;
 import java.security.SecureRandomSpi;
 
 /**
@@ -39,6 +43,7 @@ public class SecureRandom {
       try {
         System.loadLibrary("crypto");
         System.loadLibrary("diceros");
+        WorkerPool.ensureConfigured();
         synchronized (Object.class) {
           boolean ret = drngInit();
           if (ret) {
@@ -188,13 +193,182 @@ public class SecureRandom {
 
     @Override
     protected byte[] engineGenerateSeed(int numBytes) {
-      return randomDefault.generateSeed(numBytes);
+      return generateSeed(numBytes, randomDefault);
+    }
+
+    /**
+     * Generate seed bytes from RDSEED, or from conditioned RDRAND output when
+     * RDSEED is missing or exhausted. The <code>fallback</code> is only used
+     * without the DRNG, its generateSeed may block on /dev/random.
+     */
+    static byte[] generateSeed(int numBytes,
+        java.security.SecureRandom fallback) {
+      byte[] seed = new byte[numBytes];
+      if (numBytes == 0 || (drngAvailable && drngSeedBytes(seed))) {
+        return seed;
+      }
+      return fallback.generateSeed(numBytes);
+    }
+
+    /**
+     * Fill the bytes between the position and the limit of a direct buffer,
+     * e.g. a slice of a large off-heap or memory mapped region, and move the
+     * position to the limit. Large ranges are filled by the native worker
+     * pool when it is enabled, see {@link WorkerPool}.
+     *
+     * @return false if the DRNG is unavailable or failed, the position is
+     *         unchanged then
+     */
+    public static boolean nextBytes(ByteBuffer buffer) {
+      if (!buffer.isDirect()) {
+        throw new IllegalArgumentException("Buffer must be direct");
+      }
+      if (buffer.isReadOnly()) {
+        throw new ReadOnlyBufferException();
+      }
+      if (!drngAvailable || drngRandBytesRange(buffer, buffer.position(),
+          buffer.remaining()) != 0) {
+        return false;
+      }
+      buffer.position(buffer.limit());
+      return true;
     }
 
     private static native boolean drngInit();
 
+    private static native boolean drngSeedBytes(byte[] buffer);
+
+    private static native int drngRandBytesRange(ByteBuffer buffer,
+        long offset, long length);
+
     private native boolean drngRandBytes(byte[] buffer);
 
     private native int drngRandBytes(ByteBuffer directBuffer);
   }
+
+  /**
+   * CTR_DRBG of NIST SP 800-90A with AES-256 and no derivation function.
+   * Every thread has its own DRBG state, instantiated and reseeded from
+   * RDSEED. When RDSEED is unavailable the entropy is taken from the
+   * SecureRandom provided by the jre or jdk, and when the native library is
+   * unavailable that SecureRandom is used for all output.
+   */
+  public static final class CTRDRBG extends SecureRandomSpi {
+    private static final long serialVersionUID = -3722465430573880142L;
+
+    private static final int SEED_LENGTH = 48;
+    private static boolean drbgAvailable = false;
+    private java.security.SecureRandom randomDefault = null;
+
+    static {
+      try {
+        System.loadLibrary("crypto");
+        System.loadLibrary("diceros");
+        drbgAvailable = true;
+      } catch (UnsatisfiedLinkError e) {
+        drbgAvailable = false;
+      }
+    }
+
+    public CTRDRBG() {
+      randomDefault = new java.security.SecureRandom();
+    }
+
+    /**
+     * The native DRBG state of a thread, freed with the thread local.
+     */
+    private static final class State {
+      private final long context;
+
+      State(long context) {
+        this.context = context;
+      }
+
+      @Override
+      protected void finalize() throws Throwable {
+        try {
+          destroy(context);
+        } finally {
+          super.finalize();
+        }
+      }
+    }
+
+    private static final ThreadLocal<State> stateThreadLocal = new ThreadLocal<State>() {
+      @Override
+      protected State initialValue() {
+        long context = create(null);
+        if (context == 0) {
+          context = create(defaultEntropy());
+        }
+        if (context == 0) {
+          throw new ProviderException("Cannot instantiate the CTR_DRBG");
+        }
+        return new State(context);
+      }
+    };
+
+    private static java.security.SecureRandom entropyDefault = null;
+
+    /**
+     * The entropy input when RDSEED is unavailable.
+     */
+    private static synchronized byte[] defaultEntropy() {
+      if (entropyDefault == null) {
+        entropyDefault = new java.security.SecureRandom();
+      }
+      byte[] entropy = new byte[SEED_LENGTH];
+      entropyDefault.nextBytes(entropy);
+      return entropy;
+    }
+
+    /**
+     * The seed supplements the state of the calling thread, it is folded
+     * into the additional input of a reseed.
+     */
+    @Override
+    protected void engineSetSeed(byte[] seed) {
+      if (!drbgAvailable) {
+        randomDefault.setSeed(seed);
+        return;
+      }
+      byte[] additional = new byte[Math.min(seed.length, SEED_LENGTH)];
+      for (int i = 0; i < seed.length; i++) {
+        additional[i % SEED_LENGTH] ^= seed[i];
+      }
+      long context = stateThreadLocal.get().context;
+      if (!reseed(context, null, additional)) {
+        reseed(context, defaultEntropy(), additional);
+      }
+    }
+
+    @Override
+    protected void engineNextBytes(byte[] bytes) {
+      if (!drbgAvailable) {
+        randomDefault.nextBytes(bytes);
+        return;
+      }
+      long context = stateThreadLocal.get().context;
+      int done = generate(context, bytes, 0, bytes.length);
+      while (done < bytes.length) {
+        reseed(context, defaultEntropy(), null);
+        done += generate(context, bytes, done, bytes.length - done);
+      }
+    }
+
+    @Override
+    protected byte[] engineGenerateSeed(int numBytes) {
+      return DRNG.generateSeed(numBytes, randomDefault);
+    }
+
+    private static native long create(byte[] entropy);
+
+    private static native void destroy(long context);
+
+    private static native boolean reseed(long context, byte[] entropy,
+        byte[] additional);
+
+    private static native int generate(long context, byte[] out, int off,
+        int len);
+  }
 }
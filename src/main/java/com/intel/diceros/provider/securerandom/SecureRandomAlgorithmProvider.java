@@ -30,5 +30,7 @@ public class SecureRandomAlgorithmProvider extends AlgorithmProvider{
   @Override
   public void configure(ConfigurableProvider provider) {
     provider.addAlgorithm("SecureRandom.DRNG", PREFIX + "$DRNG");
+    provider.addAlgorithm("SecureRandom.CTRDRBG", PREFIX + "$CTRDRBG");
+    provider.addAlgorithm("Alg.Alias.SecureRandom.CTR_DRBG", "CTRDRBG");
   }
 }
@@ -555,7 +555,7 @@ public class AES {
     @Override
     protected byte[] engineUpdate(byte[] input, int inputOffset, int inputLen) {
       if (DCProviderAvailable) {
-        throw new UnsupportedOperationException("Multi Buffer didn't support this method");
+        return super.engineUpdate(input, inputOffset, inputLen);
       } else {
         return defaultCipher.update(input, inputOffset, inputLen);
       }
@@ -565,7 +565,8 @@ public class AES {
     protected int engineUpdate(byte[] input, int inputOffset, int inputLen,
                                byte[] output, int outputOffset) throws ShortBufferException {
       if (DCProviderAvailable) {
-        throw new UnsupportedOperationException("Multi Buffer didn't support this method");
+        return super.engineUpdate(input, inputOffset, inputLen, output,
+                outputOffset);
       } else {
         return defaultCipher.update(input, inputOffset, inputLen, output,
                 outputOffset);
@@ -607,7 +608,7 @@ public class AES {
     protected int engineUpdate(ByteBuffer input, ByteBuffer output)
             throws ShortBufferException {
       if (DCProviderAvailable) {
-        throw new UnsupportedOperationException("Multi Buffer didn't support this method");
+        return super.engineUpdate(input, output);
       } else {
         return defaultCipher.update(input, output);
       }
@@ -132,11 +132,11 @@ public abstract class BaseBlockCipher extends CipherSpi {
     byte[] iv = ivParam.getIV();
     if (iv == null) {
       if (cipher.getUnderlyingCipher().getMode() == Constants.MODE_GCM) {
-        iv = new byte[Constants.GCM_DEFAULT_IV_LEN];
+        iv = NonceGenerator.getDefault().nextNonce();
       } else {
         iv = new byte[cipher.getBlockSize()];
+        SecureRandom.getInstance("DRNG", "DC").nextBytes(iv);
       }
-      SecureRandom.getInstance("DRNG", "DC").nextBytes(iv);
     }
     return new IvParameterSpec(iv);
   }
@@ -198,7 +198,11 @@ public abstract class BaseBlockCipher extends CipherSpi {
     ParametersWithIV param = retrieveParam(key, params);
 
     if (ivLength >= 0 && param.getIV() == null) {
-      if ((opmode == Cipher.ENCRYPT_MODE) || (opmode == Cipher.WRAP_MODE)) {
+      if (((opmode == Cipher.ENCRYPT_MODE) || (opmode == Cipher.WRAP_MODE))
+          && cipher.getUnderlyingCipher().getMode() == Constants.MODE_GCM) {
+        // GCM needs a unique IV rather than a random one
+        param.setIV(NonceGenerator.getDefault().nextNonce());
+      } else if ((opmode == Cipher.ENCRYPT_MODE) || (opmode == Cipher.WRAP_MODE)) {
         SecureRandom ivRandom = random;
         if (ivRandom == null) {
           try {
@@ -209,14 +213,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
           }
         }
 
-        byte[] iv = null;
-        if (ivLength == 0 &&
-            cipher.getUnderlyingCipher().getMode() == Constants.MODE_GCM) {
-          // default IV size for GCM mode is 96 bit.
-          iv = new byte[Constants.GCM_DEFAULT_IV_LEN];
-        } else if (ivLength > 0) {
-          iv = new byte[ivLength];
-        }
+        byte[] iv = new byte[ivLength];
         ivRandom.nextBytes(iv);
         param.setIV(iv);
       } else {
@@ -469,6 +466,11 @@ public abstract class BaseBlockCipher extends CipherSpi {
      */
     private int head = 0;
 
+    /**
+     * has the current message been fed through an update?
+     */
+    private boolean updated = false;
+
     /**
      * internal buffer
      */
@@ -483,6 +485,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
     public void init(boolean forEncryption, CipherParameters params)
         throws IllegalArgumentException {
       this.buffered = 0;
+      this.updated = false;
       this.forEncryption = forEncryption;
       cipher.init(forEncryption, params);
       blockSize = cipher.getBlockSize();
@@ -500,10 +503,14 @@ public abstract class BaseBlockCipher extends CipherSpi {
 
     @Override
     public int getOutputSize(int len) {
-      if (len == 0 && head == 2) {
-        return 0;
-      }
       int totalLen = buffered + len;
+      if (head == 2) {
+        // the multi-buffer engine writes its header and always pads
+        if (len == 0 && !updated) {
+          return 0;
+        }
+        return forEncryption ? totalLen + blockSize + head : totalLen;
+      }
       if (padding == Constants.PADDING_NOPADDING) {
         if (cipher.getMode() != Constants.MODE_GCM) {
           return totalLen;
@@ -556,6 +563,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
       }
 
       int outConsumed = cipher.processBlock(in, inOff, len, out, outOff);
+      updated |= len > 0;
       if (cipher.getMode() == Constants.MODE_CBC) {
         buffered = buffered + len - outConsumed;
       }
@@ -582,6 +590,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
         throw new RuntimeException(e);
       } finally {
         buffered = 0;
+        updated = false;
         reset();
       }
     }
@@ -597,6 +606,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
       } finally {
         reset();
         buffered = 0;
+        updated = false;
       }
       return result;
     }
@@ -629,6 +639,7 @@ public abstract class BaseBlockCipher extends CipherSpi {
       }
       // need native process
       int n = cipher.processByteBuffer(input, output, isUpdate);
+      updated |= isUpdate;
       if (cipher.getMode() == Constants.MODE_CBC) {
         buffered = buffered + inLen -n;
       }
@@ -0,0 +1,102 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.provider.symmetric.util;
+
+import com.intel.diceros.provider.DicerosProvider;
+
+import java.security.SecureRandom;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * Unique 96 bit nonces for AES-GCM, built as in NIST SP 800-38D 8.2.1: a
+ * random 32 bit fixed field per generator followed by a 64 bit counter.
+ * <p>
+ * Each thread reserves a block of counter values with one atomic add and
+ * hands them out without further synchronization, so the nonces of a
+ * generator never repeat and no native call is made per nonce. The fixed
+ * field and the start of the counter are drawn from the DRNG when the
+ * generator is created.
+ */
+public final class NonceGenerator {
+  public static final int NONCE_LENGTH = Constants.GCM_DEFAULT_IV_LEN;
+  public static final int FIXED_LENGTH = 4;
+
+  // counter values a thread reserves at a time
+  private static final long BLOCK_SIZE = 1 << 16;
+
+  private final byte[] fixed = new byte[FIXED_LENGTH];
+  private final AtomicLong nextBlock;
+
+  /**
+   * The next counter value of a thread and the values left in its block.
+   */
+  private final ThreadLocal<long[]> threadBlock = new ThreadLocal<long[]>() {
+    @Override
+    protected long[] initialValue() {
+      return new long[2];
+    }
+  };
+
+  private static final class DefaultHolder {
+    static final NonceGenerator INSTANCE = new NonceGenerator();
+  }
+
+  public NonceGenerator() {
+    SecureRandom random;
+    try {
+      random = SecureRandom.getInstance("DRNG", DicerosProvider.PROVIDER_NAME);
+    } catch (Exception e) {
+      random = new SecureRandom();
+    }
+    random.nextBytes(fixed);
+    nextBlock = new AtomicLong(random.nextLong());
+  }
+
+  /**
+   * @return the generator shared by the ciphers of the provider
+   */
+  public static NonceGenerator getDefault() {
+    return DefaultHolder.INSTANCE;
+  }
+
+  /**
+   * Write the next nonce to <code>nonce</code> at <code>off</code>.
+   */
+  public void nextNonce(byte[] nonce, int off) {
+    long[] block = threadBlock.get();
+    if (block[1] == 0) {
+      block[0] = nextBlock.getAndAdd(BLOCK_SIZE);
+      block[1] = BLOCK_SIZE;
+    }
+    long counter = block[0]++;
+    block[1]--;
+
+    System.arraycopy(fixed, 0, nonce, off, FIXED_LENGTH);
+    for (int i = NONCE_LENGTH - 1; i >= FIXED_LENGTH; i--) {
+      nonce[off + i] = (byte) counter;
+      counter >>>= 8;
+    }
+  }
+
+  public byte[] nextNonce() {
+    byte[] nonce = new byte[NONCE_LENGTH];
+    nextNonce(nonce, 0);
+    return nonce;
+  }
+}
@@ -35,16 +35,79 @@ typedef struct _sAesData_x8 {
     uint64_t numblocks;
 } sAesData_x8;
 
+typedef struct _sAesData_x16 {
+    uint8_t *inbuf[16];
+    uint8_t *outbuf[16];
+    uint8_t *keysched;
+    uint8_t *iv[16];
+    uint64_t numblocks;
+} sAesData_x16;
+
+// one key schedule per lane, see aes_cbc_enc_*_x8_keys
+typedef struct _sAesKeysData_x8 {
+    uint8_t *inbuf[8];
+    uint8_t *outbuf[8];
+    uint8_t *keysched[8];
+    uint8_t *iv[8];
+    uint64_t numblocks;
+} sAesKeysData_x8;
+
+typedef struct _sGcmData {
+    uint8_t *keysched;      // set by the caller, from aes_keyexp_*_enc
+    uint8_t hashKeys[8 * 16]; // H^1..H^8, set by aes_gcm_precomp_*
+    uint8_t ekj0[16];       // E(K, J0), masks the tag
+    uint8_t counter[16];    // next counter block
+    uint8_t ghash[16];      // running GHASH value
+    uint8_t keystream[16];  // keystream of the last partial block
+    uint64_t aadLength;
+    uint64_t msgLength;
+} sGcmData;
+
 // Multi-buffer: The same key is applied to all streams
 void aes_cbc_enc_128_x8(sAesData_x8 *args);
 void aes_cbc_enc_192_x8(sAesData_x8 *args);
 void aes_cbc_enc_256_x8(sAesData_x8 *args);
 
+// Multi-buffer: every stream has its own key, of the same size
+void aes_cbc_enc_128_x8_keys(sAesKeysData_x8 *args);
+void aes_cbc_enc_192_x8_keys(sAesKeysData_x8 *args);
+void aes_cbc_enc_256_x8_keys(sAesKeysData_x8 *args);
+
 // Single Buffer:
 void iDec128_CBC_by8(sAesData *data);
 void iDec192_CBC_by8(sAesData *data);
 void iDec256_CBC_by8(sAesData *data);
 
+// VAES/AVX-512, only valid on CPUs with VAES and AVX512F:
+void aes_cbc_enc_128_x16(sAesData_x16 *args);
+void aes_cbc_enc_192_x16(sAesData_x16 *args);
+void aes_cbc_enc_256_x16(sAesData_x16 *args);
+void iDec128_CBC_by16(sAesData *data);
+void iDec192_CBC_by16(sAesData *data);
+void iDec256_CBC_by16(sAesData *data);
+
+// AES-GCM, stitched CTR and GHASH, only valid on CPUs with PCLMULQDQ:
+void aes_gcm_precomp_128(sGcmData *data);
+void aes_gcm_precomp_192(sGcmData *data);
+void aes_gcm_precomp_256(sGcmData *data);
+void aes_gcm_init_128(sGcmData *data, const uint8_t *iv, uint64_t ivLength);
+void aes_gcm_init_192(sGcmData *data, const uint8_t *iv, uint64_t ivLength);
+void aes_gcm_init_256(sGcmData *data, const uint8_t *iv, uint64_t ivLength);
+int aes_gcm_aad(sGcmData *data, const uint8_t *aad, uint64_t length);
+void aes_gcm_enc_128_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_enc_192_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_enc_256_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_dec_128_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_dec_192_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_dec_256_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length);
+void aes_gcm_finalize(sGcmData *data, uint8_t *tag);
+
 // Key Expansion:
 void aes_keyexp_128_enc(uint8_t *key, uint8_t *enc_exp_keys);
 void aes_keyexp_192_enc(uint8_t *key, uint8_t *enc_exp_keys);
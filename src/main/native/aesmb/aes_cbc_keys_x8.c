@@ -0,0 +1,78 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AES-CBC encryption of 8 independent lanes, each with its own key. The
+ * lane layout follows aes_cbc_enc_*_x8, but keysched holds one schedule per
+ * lane, so messages of different keys (e.g. of different tenants) share a
+ * kernel pass. All schedules must be of the same key size.
+ *
+ * The round keys of 8 lanes do not fit in the registers, they are read
+ * from the (L1 resident) schedules on every round. The 8 interleaved lanes
+ * still hide the latency of aesenc.
+ */
+
+#include <wmmintrin.h>
+#include "aes_api.h"
+
+static inline void cbc_enc_keys_x8(sAesKeysData_x8 *args, int rounds) {
+  __m128i state[8];
+  int i, r;
+
+  for (i = 0; i < 8; i++) {
+    state[i] = _mm_loadu_si128((__m128i *) args->iv[i]);
+  }
+
+  uint64_t block;
+  for (block = 0; block < args->numblocks; block++) {
+    uint64_t offset = block * 16;
+    for (i = 0; i < 8; i++) {
+      __m128i data = _mm_loadu_si128((__m128i *) (args->inbuf[i] + offset));
+      state[i] = _mm_xor_si128(_mm_xor_si128(data, state[i]),
+          _mm_loadu_si128((__m128i *) args->keysched[i]));
+    }
+    for (r = 1; r < rounds; r++) {
+      for (i = 0; i < 8; i++) {
+        state[i] = _mm_aesenc_si128(state[i],
+            _mm_loadu_si128((__m128i *) (args->keysched[i] + 16 * r)));
+      }
+    }
+    for (i = 0; i < 8; i++) {
+      state[i] = _mm_aesenclast_si128(state[i],
+          _mm_loadu_si128((__m128i *) (args->keysched[i] + 16 * rounds)));
+      _mm_storeu_si128((__m128i *) (args->outbuf[i] + offset), state[i]);
+    }
+  }
+
+  // write back the last cipher block of each lane, like the x8 kernels
+  for (i = 0; i < 8; i++) {
+    _mm_storeu_si128((__m128i *) args->iv[i], state[i]);
+  }
+}
+
+void aes_cbc_enc_128_x8_keys(sAesKeysData_x8 *args) {
+  cbc_enc_keys_x8(args, 10);
+}
+
+void aes_cbc_enc_192_x8_keys(sAesKeysData_x8 *args) {
+  cbc_enc_keys_x8(args, 12);
+}
+
+void aes_cbc_enc_256_x8_keys(sAesKeysData_x8 *args) {
+  cbc_enc_keys_x8(args, 14);
+}
@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AES-CBC kernels for CPUs with VAES and AVX-512. One zmm register holds
+ * four AES blocks, so a single vaesenc/vaesdec works on four blocks.
+ *
+ * aes_cbc_enc_*_x16: 16 independent CBC streams (lanes) with the same key,
+ *   the lane layout follows aes_cbc_enc_*_x8.
+ * iDec*_CBC_by16: one CBC stream, decrypting 16 blocks per iteration, the
+ *   interface follows iDec*_CBC_by8.
+ *
+ * The key schedules are the ones produced by aes_keyexp_*_enc/dec.
+ */
+
+#include <immintrin.h>
+#include "aes_api.h"
+
+#define LOAD_X4(p0, p1, p2, p3) \
+  _mm512_inserti32x4(_mm512_inserti32x4(_mm512_inserti32x4( \
+      _mm512_castsi128_si512(_mm_loadu_si128((__m128i *) (p0))), \
+      _mm_loadu_si128((__m128i *) (p1)), 1), \
+      _mm_loadu_si128((__m128i *) (p2)), 2), \
+      _mm_loadu_si128((__m128i *) (p3)), 3)
+
+#define STORE_X4(p0, p1, p2, p3, v) do { \
+  _mm_storeu_si128((__m128i *) (p0), _mm512_extracti32x4_epi32((v), 0)); \
+  _mm_storeu_si128((__m128i *) (p1), _mm512_extracti32x4_epi32((v), 1)); \
+  _mm_storeu_si128((__m128i *) (p2), _mm512_extracti32x4_epi32((v), 2)); \
+  _mm_storeu_si128((__m128i *) (p3), _mm512_extracti32x4_epi32((v), 3)); \
+} while (0)
+
+static inline void cbc_enc_x16(sAesData_x16 *args, int rounds) {
+  __m512i keys[15];
+  __m512i state[4];
+  int i, r, g;
+
+  for (r = 0; r <= rounds; r++) {
+    keys[r] = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((__m128i *) (args->keysched + 16 * r)));
+  }
+
+  for (g = 0; g < 4; g++) {
+    state[g] = LOAD_X4(args->iv[4 * g], args->iv[4 * g + 1],
+        args->iv[4 * g + 2], args->iv[4 * g + 3]);
+  }
+
+  uint64_t block;
+  for (block = 0; block < args->numblocks; block++) {
+    uint64_t offset = block * 16;
+    for (g = 0; g < 4; g++) {
+      __m512i data = LOAD_X4(args->inbuf[4 * g] + offset,
+          args->inbuf[4 * g + 1] + offset, args->inbuf[4 * g + 2] + offset,
+          args->inbuf[4 * g + 3] + offset);
+      state[g] = _mm512_xor_si512(_mm512_xor_si512(data, state[g]), keys[0]);
+    }
+    for (r = 1; r < rounds; r++) {
+      for (g = 0; g < 4; g++) {
+        state[g] = _mm512_aesenc_epi128(state[g], keys[r]);
+      }
+    }
+    for (g = 0; g < 4; g++) {
+      state[g] = _mm512_aesenclast_epi128(state[g], keys[rounds]);
+      STORE_X4(args->outbuf[4 * g] + offset, args->outbuf[4 * g + 1] + offset,
+          args->outbuf[4 * g + 2] + offset, args->outbuf[4 * g + 3] + offset,
+          state[g]);
+    }
+  }
+
+  // write back the last cipher block of each lane, like the x8 kernels
+  for (i = 0; i < 16; i += 4) {
+    STORE_X4(args->iv[i], args->iv[i + 1], args->iv[i + 2], args->iv[i + 3],
+        state[i / 4]);
+  }
+}
+
+static inline void cbc_dec_by16(sAesData *data, int rounds) {
+  __m512i keys[15];
+  int r, g;
+
+  for (r = 0; r <= rounds; r++) {
+    keys[r] = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((__m128i *) (data->keysched + 16 * r)));
+  }
+
+  uint8_t *in = data->inbuf;
+  uint8_t *out = data->outbuf;
+  uint64_t blocks = data->numblocks;
+  __m128i iv = _mm_loadu_si128((__m128i *) data->iv);
+
+  while (blocks >= 16) {
+    __m512i cipher[4];
+    __m512i prev[4];
+    __m512i state[4];
+
+    // read everything before writing, in and out may be the same buffer
+    for (g = 0; g < 4; g++) {
+      cipher[g] = _mm512_loadu_si512(in + 64 * g);
+    }
+    // the masked load never touches the 16 bytes before the input
+    prev[0] = _mm512_inserti32x4(
+        _mm512_maskz_loadu_epi64(0xFC, in - 16), iv, 0);
+    for (g = 1; g < 4; g++) {
+      prev[g] = _mm512_loadu_si512(in + 64 * g - 16);
+    }
+    iv = _mm512_extracti32x4_epi32(cipher[3], 3);
+
+    for (g = 0; g < 4; g++) {
+      state[g] = _mm512_xor_si512(cipher[g], keys[rounds]);
+    }
+    for (r = rounds - 1; r > 0; r--) {
+      for (g = 0; g < 4; g++) {
+        state[g] = _mm512_aesdec_epi128(state[g], keys[r]);
+      }
+    }
+    for (g = 0; g < 4; g++) {
+      state[g] = _mm512_aesdeclast_epi128(state[g], keys[0]);
+      _mm512_storeu_si512(out + 64 * g, _mm512_xor_si512(state[g], prev[g]));
+    }
+
+    in += 256;
+    out += 256;
+    blocks -= 16;
+  }
+
+  for (; blocks > 0; blocks--) {
+    __m128i cipher = _mm_loadu_si128((__m128i *) in);
+    __m128i state = _mm_xor_si128(cipher,
+        _mm512_castsi512_si128(keys[rounds]));
+    for (r = rounds - 1; r > 0; r--) {
+      state = _mm_aesdec_si128(state, _mm512_castsi512_si128(keys[r]));
+    }
+    state = _mm_aesdeclast_si128(state, _mm512_castsi512_si128(keys[0]));
+    _mm_storeu_si128((__m128i *) out, _mm_xor_si128(state, iv));
+    iv = cipher;
+    in += 16;
+    out += 16;
+  }
+
+  _mm_storeu_si128((__m128i *) data->iv, iv);
+}
+
+void aes_cbc_enc_128_x16(sAesData_x16 *args) {
+  cbc_enc_x16(args, 10);
+}
+
+void aes_cbc_enc_192_x16(sAesData_x16 *args) {
+  cbc_enc_x16(args, 12);
+}
+
+void aes_cbc_enc_256_x16(sAesData_x16 *args) {
+  cbc_enc_x16(args, 14);
+}
+
+void iDec128_CBC_by16(sAesData *data) {
+  cbc_dec_by16(data, 10);
+}
+
+void iDec192_CBC_by16(sAesData *data) {
+  cbc_dec_by16(data, 12);
+}
+
+void iDec256_CBC_by16(sAesData *data) {
+  cbc_dec_by16(data, 14);
+}
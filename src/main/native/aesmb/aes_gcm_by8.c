@@ -0,0 +1,425 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AES-GCM for CPUs with AES-NI and PCLMULQDQ. The bulk loop encrypts eight
+ * counter blocks per iteration and hashes eight ciphertext blocks in the
+ * same iteration, the carry-less multiplications are issued between the
+ * AES rounds so that both units are busy. The eight products are summed
+ * with the powers H^8..H^1 and reduced once per iteration.
+ *
+ * GHASH values are kept byte reflected in the registers, the field
+ * multiplication follows the Intel carry-less multiplication white paper.
+ *
+ * The key schedule is the one produced by aes_keyexp_*_enc. All functions
+ * can be called repeatedly to process a message in pieces of any length.
+ */
+
+#include <immintrin.h>
+#include <string.h>
+#include "aes_api.h"
+
+#define GCM_BLOCK_SIZE 16
+
+static inline __m128i bswap128(__m128i x) {
+  const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+      12, 13, 14, 15);
+  return _mm_shuffle_epi8(x, mask);
+}
+
+/*
+ * Accumulate the unreduced 256 bit product a * b into lo/mid/hi.
+ */
+static inline void clmul_acc(__m128i a, __m128i b, __m128i *lo, __m128i *mid,
+    __m128i *hi) {
+  *lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+  *hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+  *mid = _mm_xor_si128(*mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01),
+      _mm_clmulepi64_si128(a, b, 0x10)));
+}
+
+/*
+ * Reduce an accumulated product modulo x^128 + x^7 + x^2 + x + 1.
+ */
+static inline __m128i gf_reduce(__m128i lo, __m128i mid, __m128i hi) {
+  __m128i t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  __m128i t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+  __m128i t2, t4, t5, t7, t8, t9;
+
+  // shift the 256 bit product left by one, the operands are reflected
+  t7 = _mm_srli_epi32(t3, 31);
+  t8 = _mm_srli_epi32(t6, 31);
+  t3 = _mm_slli_epi32(t3, 1);
+  t6 = _mm_slli_epi32(t6, 1);
+  t9 = _mm_srli_si128(t7, 12);
+  t8 = _mm_slli_si128(t8, 4);
+  t7 = _mm_slli_si128(t7, 4);
+  t3 = _mm_or_si128(t3, t7);
+  t6 = _mm_or_si128(t6, t8);
+  t6 = _mm_or_si128(t6, t9);
+
+  t7 = _mm_slli_epi32(t3, 31);
+  t8 = _mm_slli_epi32(t3, 30);
+  t9 = _mm_slli_epi32(t3, 25);
+  t7 = _mm_xor_si128(t7, t8);
+  t7 = _mm_xor_si128(t7, t9);
+  t8 = _mm_srli_si128(t7, 4);
+  t7 = _mm_slli_si128(t7, 12);
+  t3 = _mm_xor_si128(t3, t7);
+
+  t2 = _mm_srli_epi32(t3, 1);
+  t4 = _mm_srli_epi32(t3, 2);
+  t5 = _mm_srli_epi32(t3, 7);
+  t2 = _mm_xor_si128(t2, t4);
+  t2 = _mm_xor_si128(t2, t5);
+  t2 = _mm_xor_si128(t2, t8);
+  t3 = _mm_xor_si128(t3, t2);
+  return _mm_xor_si128(t6, t3);
+}
+
+static inline __m128i gf_mul(__m128i a, __m128i b) {
+  __m128i lo = _mm_setzero_si128();
+  __m128i mid = _mm_setzero_si128();
+  __m128i hi = _mm_setzero_si128();
+  clmul_acc(a, b, &lo, &mid, &hi);
+  return gf_reduce(lo, mid, hi);
+}
+
+static inline void load_keys(const uint8_t *keysched, __m128i *keys,
+    int rounds) {
+  int r;
+  for (r = 0; r <= rounds; r++) {
+    keys[r] = _mm_loadu_si128((const __m128i *) (keysched + 16 * r));
+  }
+}
+
+static inline __m128i aes_block(const __m128i *keys, int rounds, __m128i x) {
+  int r;
+  x = _mm_xor_si128(x, keys[0]);
+  for (r = 1; r < rounds; r++) {
+    x = _mm_aesenc_si128(x, keys[r]);
+  }
+  return _mm_aesenclast_si128(x, keys[rounds]);
+}
+
+static inline __m128i hash_key(const sGcmData *data, int power) {
+  return _mm_loadu_si128((const __m128i *) (data->hashKeys + 16 * (power - 1)));
+}
+
+static inline void ghash_mult(sGcmData *data) {
+  __m128i x = bswap128(_mm_loadu_si128((__m128i *) data->ghash));
+  _mm_storeu_si128((__m128i *) data->ghash,
+      bswap128(gf_mul(x, hash_key(data, 1))));
+}
+
+/*
+ * GHASH of whole blocks into the reflected accumulator x.
+ */
+static inline __m128i ghash_blocks(const sGcmData *data, __m128i x,
+    const uint8_t *in, uint64_t blocks) {
+  __m128i h = hash_key(data, 1);
+  for (; blocks > 0; blocks--) {
+    x = _mm_xor_si128(x, bswap128(_mm_loadu_si128((const __m128i *) in)));
+    x = gf_mul(x, h);
+    in += GCM_BLOCK_SIZE;
+  }
+  return x;
+}
+
+static inline void gcm_precomp(sGcmData *data, int rounds) {
+  __m128i keys[15];
+  int i;
+
+  load_keys(data->keysched, keys, rounds);
+  __m128i h = bswap128(aes_block(keys, rounds, _mm_setzero_si128()));
+  __m128i power = h;
+  for (i = 0; i < 8; i++) {
+    _mm_storeu_si128((__m128i *) (data->hashKeys + 16 * i), power);
+    power = gf_mul(power, h);
+  }
+}
+
+static inline void gcm_init(sGcmData *data, const uint8_t *iv,
+    uint64_t ivLength, int rounds) {
+  __m128i keys[15];
+  __m128i j0;
+
+  load_keys(data->keysched, keys, rounds);
+  if (ivLength == 12) {
+    uint8_t block[GCM_BLOCK_SIZE] = { 0 };
+    memcpy(block, iv, 12);
+    block[15] = 1;
+    j0 = _mm_loadu_si128((__m128i *) block);
+  } else {
+    uint8_t block[GCM_BLOCK_SIZE] = { 0 };
+    uint64_t full = ivLength / GCM_BLOCK_SIZE;
+    uint64_t bits = ivLength * 8;
+    int i;
+
+    __m128i x = ghash_blocks(data, _mm_setzero_si128(), iv, full);
+    if (ivLength % GCM_BLOCK_SIZE) {
+      memcpy(block, iv + full * GCM_BLOCK_SIZE, ivLength % GCM_BLOCK_SIZE);
+      x = ghash_blocks(data, x, block, 1);
+    }
+    memset(block, 0, sizeof(block));
+    for (i = 0; i < 8; i++) {
+      block[15 - i] = (uint8_t) (bits >> (8 * i));
+    }
+    x = ghash_blocks(data, x, block, 1);
+    j0 = bswap128(x);
+  }
+
+  _mm_storeu_si128((__m128i *) data->ekj0, aes_block(keys, rounds, j0));
+  // the counter is kept byte reflected, so inc32 is a 32 bit add of lane 0
+  _mm_storeu_si128((__m128i *) data->counter,
+      _mm_add_epi32(bswap128(j0), _mm_set_epi32(0, 0, 0, 1)));
+  memset(data->ghash, 0, sizeof(data->ghash));
+  memset(data->keystream, 0, sizeof(data->keystream));
+  data->aadLength = 0;
+  data->msgLength = 0;
+}
+
+int aes_gcm_aad(sGcmData *data, const uint8_t *aad, uint64_t length) {
+  if (data->msgLength > 0) {
+    return -1;
+  }
+
+  unsigned int n = data->aadLength % GCM_BLOCK_SIZE;
+  data->aadLength += length;
+  for (; n > 0 && length > 0; length--) {
+    data->ghash[n] ^= *aad++;
+    n = (n + 1) % GCM_BLOCK_SIZE;
+    if (n == 0) {
+      ghash_mult(data);
+    }
+  }
+
+  uint64_t blocks = length / GCM_BLOCK_SIZE;
+  if (blocks > 0) {
+    __m128i x = bswap128(_mm_loadu_si128((__m128i *) data->ghash));
+    x = ghash_blocks(data, x, aad, blocks);
+    _mm_storeu_si128((__m128i *) data->ghash, bswap128(x));
+    aad += blocks * GCM_BLOCK_SIZE;
+    length -= blocks * GCM_BLOCK_SIZE;
+  }
+  for (n = 0; n < length; n++) {
+    data->ghash[n] ^= aad[n];
+  }
+  return 0;
+}
+
+static inline void gcm_crypt(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length, int rounds, int encrypt) {
+  __m128i keys[15];
+  unsigned int n = data->msgLength % GCM_BLOCK_SIZE;
+
+  if (length == 0) {
+    return;
+  }
+  // the last AAD block was partial
+  if (data->msgLength == 0 && data->aadLength % GCM_BLOCK_SIZE) {
+    ghash_mult(data);
+  }
+  data->msgLength += length;
+
+  // finish the partial block of the previous call
+  for (; n > 0 && length > 0; length--) {
+    uint8_t b = *in++;
+    uint8_t c = b ^ data->keystream[n];
+    data->ghash[n] ^= encrypt ? c : b;
+    *out++ = c;
+    n = (n + 1) % GCM_BLOCK_SIZE;
+    if (n == 0) {
+      ghash_mult(data);
+    }
+  }
+
+  load_keys(data->keysched, keys, rounds);
+  const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+  __m128i counter = _mm_loadu_si128((__m128i *) data->counter);
+  __m128i x = bswap128(_mm_loadu_si128((__m128i *) data->ghash));
+  __m128i hashed[8];
+  int pending = 0;
+  int i, r;
+
+  while (length >= 8 * GCM_BLOCK_SIZE) {
+    __m128i state[8];
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    if (!encrypt) {
+      // decryption hashes the ciphertext of this iteration
+      for (i = 0; i < 8; i++) {
+        hashed[i] = bswap128(_mm_loadu_si128((const __m128i *) (in + 16 * i)));
+      }
+      pending = 1;
+    }
+    if (pending) {
+      hashed[0] = _mm_xor_si128(hashed[0], x);
+    }
+
+    for (i = 0; i < 8; i++) {
+      state[i] = _mm_xor_si128(bswap128(counter), keys[0]);
+      counter = _mm_add_epi32(counter, one);
+    }
+    for (r = 1; r < rounds; r++) {
+      for (i = 0; i < 8; i++) {
+        state[i] = _mm_aesenc_si128(state[i], keys[r]);
+      }
+      // one block of GHASH per round, rounds - 1 >= 9 leaves room for 8
+      if (pending && r <= 8) {
+        clmul_acc(hashed[r - 1], hash_key(data, 9 - r), &lo, &mid, &hi);
+      }
+    }
+    for (i = 0; i < 8; i++) {
+      state[i] = _mm_aesenclast_si128(state[i], keys[rounds]);
+      state[i] = _mm_xor_si128(state[i],
+          _mm_loadu_si128((const __m128i *) (in + 16 * i)));
+      _mm_storeu_si128((__m128i *) (out + 16 * i), state[i]);
+    }
+    if (pending) {
+      x = gf_reduce(lo, mid, hi);
+    }
+
+    if (encrypt) {
+      // encryption hashes this ciphertext during the next iteration
+      for (i = 0; i < 8; i++) {
+        hashed[i] = bswap128(state[i]);
+      }
+      pending = 1;
+    } else {
+      pending = 0;
+    }
+
+    in += 8 * GCM_BLOCK_SIZE;
+    out += 8 * GCM_BLOCK_SIZE;
+    length -= 8 * GCM_BLOCK_SIZE;
+  }
+
+  if (pending) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    hashed[0] = _mm_xor_si128(hashed[0], x);
+    for (i = 0; i < 8; i++) {
+      clmul_acc(hashed[i], hash_key(data, 8 - i), &lo, &mid, &hi);
+    }
+    x = gf_reduce(lo, mid, hi);
+  }
+
+  __m128i h = hash_key(data, 1);
+  while (length >= GCM_BLOCK_SIZE) {
+    __m128i block = _mm_loadu_si128((const __m128i *) in);
+    __m128i c = _mm_xor_si128(block, aes_block(keys, rounds, bswap128(counter)));
+    counter = _mm_add_epi32(counter, one);
+    _mm_storeu_si128((__m128i *) out, c);
+    x = gf_mul(_mm_xor_si128(x, bswap128(encrypt ? c : block)), h);
+
+    in += GCM_BLOCK_SIZE;
+    out += GCM_BLOCK_SIZE;
+    length -= GCM_BLOCK_SIZE;
+  }
+  _mm_storeu_si128((__m128i *) data->ghash, bswap128(x));
+
+  if (length > 0) {
+    _mm_storeu_si128((__m128i *) data->keystream,
+        aes_block(keys, rounds, bswap128(counter)));
+    counter = _mm_add_epi32(counter, one);
+    for (n = 0; n < length; n++) {
+      uint8_t c = in[n] ^ data->keystream[n];
+      data->ghash[n] ^= encrypt ? c : in[n];
+      out[n] = c;
+    }
+  }
+  _mm_storeu_si128((__m128i *) data->counter, counter);
+}
+
+void aes_gcm_finalize(sGcmData *data, uint8_t *tag) {
+  uint8_t block[GCM_BLOCK_SIZE];
+  uint64_t aadBits = data->aadLength * 8;
+  uint64_t msgBits = data->msgLength * 8;
+  int i;
+
+  if ((data->msgLength == 0 && data->aadLength % GCM_BLOCK_SIZE)
+      || data->msgLength % GCM_BLOCK_SIZE) {
+    ghash_mult(data);
+  }
+  for (i = 0; i < 8; i++) {
+    block[7 - i] = (uint8_t) (aadBits >> (8 * i));
+    block[15 - i] = (uint8_t) (msgBits >> (8 * i));
+  }
+  __m128i x = bswap128(_mm_loadu_si128((__m128i *) data->ghash));
+  x = ghash_blocks(data, x, block, 1);
+  _mm_storeu_si128((__m128i *) tag, _mm_xor_si128(bswap128(x),
+      _mm_loadu_si128((__m128i *) data->ekj0)));
+}
+
+void aes_gcm_precomp_128(sGcmData *data) {
+  gcm_precomp(data, 10);
+}
+
+void aes_gcm_precomp_192(sGcmData *data) {
+  gcm_precomp(data, 12);
+}
+
+void aes_gcm_precomp_256(sGcmData *data) {
+  gcm_precomp(data, 14);
+}
+
+void aes_gcm_init_128(sGcmData *data, const uint8_t *iv, uint64_t ivLength) {
+  gcm_init(data, iv, ivLength, 10);
+}
+
+void aes_gcm_init_192(sGcmData *data, const uint8_t *iv, uint64_t ivLength) {
+  gcm_init(data, iv, ivLength, 12);
+}
+
+void aes_gcm_init_256(sGcmData *data, const uint8_t *iv, uint64_t ivLength) {
+  gcm_init(data, iv, ivLength, 14);
+}
+
+void aes_gcm_enc_128_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 10, 1);
+}
+
+void aes_gcm_enc_192_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 12, 1);
+}
+
+void aes_gcm_enc_256_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 14, 1);
+}
+
+void aes_gcm_dec_128_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 10, 0);
+}
+
+void aes_gcm_dec_192_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 12, 0);
+}
+
+void aes_gcm_dec_256_update(sGcmData *data, uint8_t *out, const uint8_t *in,
+    uint64_t length) {
+  gcm_crypt(data, out, in, length, 14, 0);
+}
@@ -0,0 +1,518 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Native benchmark of the AES paths of libdiceros, without a JVM.
+ *
+ * Implementations:
+ *   evp         raw EVP_aes_* ciphers of libcrypto (ctr, cbc, xts, gcm)
+ *   aesmb       the libaesmb kernels: aesmb_encrypt/aesmb_decrypt for cbc,
+ *               the stitched kernels behind aesmb_gcm_cipher for gcm
+ *   bufferCrypt the multi-buffer CBC glue with its header and padding
+ *
+ * Every point runs the given number of threads, each with its own context
+ * and buffers, for at least the given time. The results are written as
+ * JSON, a readable line per point goes to stderr. cycles_per_byte is
+ * measured with the TSC, whose rate can differ from the core clock.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+#include <openssl/evp.h>
+
+#include "cpu_features.h"
+#include "com/intel/diceros/crypto/engines/aes_utils.h"
+#include "com/intel/diceros/crypto/engines/aes_dispatch.h"
+#include "com/intel/diceros/crypto/engines/aes_gcm.h"
+#include "com/intel/diceros/crypto/engines/aes_multibuffer.h"
+
+#define IMPL_EVP 0
+#define IMPL_AESMB 1
+#define IMPL_BUFFER 2
+#define IMPL_COUNT 3
+
+#define MAX_THREAD_COUNTS 16
+#define BUFFER_SLACK 64
+#define GCM_TAG_LENGTH 16
+
+static const char* implNames[IMPL_COUNT] = {"evp", "aesmb", "bufferCrypt"};
+static const char* modeNames[] = {"ctr", "cbc", "xts", "gcm"};
+
+typedef struct _BenchSpec {
+  int impl;
+  int mode;
+  int forEncryption;
+  int keyBits;
+  size_t size;
+} BenchSpec;
+
+typedef struct _Worker {
+  const BenchSpec* spec;
+  pthread_barrier_t* start;
+  double minSeconds;
+  uint8_t* input;
+  uint8_t* output;
+  size_t inputLength;
+  CipherContext* ctx;
+  uint8_t tag[GCM_TAG_LENGTH];
+  uint64_t bytes;
+  uint64_t cycles;
+  double seconds;
+  int error;
+} Worker;
+
+static uint8_t benchKey[64];
+static uint8_t benchIv[16 * AESMB_MAX_LANES];
+
+static double now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double tscGhz() {
+  double begin = now();
+  uint64_t tsc = __rdtsc();
+  struct timespec pause = {0, 200 * 1000 * 1000};
+  nanosleep(&pause, NULL);
+  return (__rdtsc() - tsc) / (now() - begin) / 1e9;
+}
+
+static int keyLength(const BenchSpec* spec) {
+  int length = spec->keyBits / 8;
+  return spec->mode == MODE_XTS ? 2 * length : length;
+}
+
+static const EVP_CIPHER* evpCipher(const BenchSpec* spec) {
+  int length = keyLength(spec);
+  if (spec->mode == MODE_GCM) {
+    if (spec->impl == IMPL_AESMB) {
+      // NULL without the GCM kernels, the point is skipped then
+      return aesmb_gcm_cipher(length);
+    }
+    switch (length) {
+    case 16:
+      return EVP_aes_128_gcm();
+    case 24:
+      return EVP_aes_192_gcm();
+    case 32:
+      return EVP_aes_256_gcm();
+    default:
+      return NULL;
+    }
+  }
+  return getCipher(spec->mode, length);
+}
+
+/*
+ * One message through EVP, returns the bytes processed or -1.
+ */
+static long evpMessage(EVP_CIPHER_CTX* ctx, int mode, int forEncryption,
+    uint8_t* tag, uint8_t* output, const uint8_t* input, size_t length) {
+  int outLength = 0;
+  int finalLength = 0;
+  if (!EVP_CipherInit_ex(ctx, NULL, NULL, NULL, benchIv, -1)) {
+    return -1;
+  }
+  if (mode == MODE_GCM && !forEncryption && !EVP_CIPHER_CTX_ctrl(ctx,
+      EVP_CTRL_GCM_SET_TAG, GCM_TAG_LENGTH, tag)) {
+    return -1;
+  }
+  if (!EVP_CipherUpdate(ctx, output, &outLength, input, length)
+      || !EVP_CipherFinal_ex(ctx, output + outLength, &finalLength)) {
+    return -1;
+  }
+  if (mode == MODE_GCM && forEncryption && !EVP_CIPHER_CTX_ctrl(ctx,
+      EVP_CTRL_GCM_GET_TAG, GCM_TAG_LENGTH, tag)) {
+    return -1;
+  }
+  return length;
+}
+
+static CipherContext* newEvpContext(const EVP_CIPHER* cipher,
+    int forEncryption) {
+  CipherContext* ctx = createCipherContext();
+  if (ctx == NULL) {
+    return NULL;
+  }
+  if (!EVP_CipherInit_ex(ctx->opensslCtx, cipher, NULL, benchKey, benchIv,
+      forEncryption)) {
+    destroyCipherContext(ctx);
+    return NULL;
+  }
+  EVP_CIPHER_CTX_set_padding(ctx->opensslCtx, 0);
+  return ctx;
+}
+
+static CipherContext* newMbContext(const BenchSpec* spec, int forEncryption) {
+  CipherContext* ctx = createCipherContextMB(aesmb_dispatch()->handle,
+      (signed char*) benchKey, keyLength(spec), (signed char*) benchIv, 16);
+  if (ctx == NULL) {
+    return NULL;
+  }
+  if (!ctx->aesmbCtx->aesEnabled
+      || opensslResetContext(forEncryption, ctx->opensslCtx, ctx) != 0) {
+    destroyCipherContext(ctx);
+    return NULL;
+  }
+  EVP_CIPHER_CTX_set_padding(ctx->opensslCtx, 1);
+  return ctx;
+}
+
+/*
+ * Process one message of the worker, returns the bytes processed or -1.
+ */
+static long benchOp(Worker* w) {
+  const BenchSpec* spec = w->spec;
+  int outLength = 0;
+  if (spec->impl == IMPL_BUFFER) {
+    reset(w->ctx, NULL, NULL);
+    return bufferCrypt(w->ctx, (const char*) w->input, w->inputLength,
+        (char*) w->output) > 0 ? (long) spec->size : -1;
+  }
+  if (spec->impl == IMPL_AESMB && spec->mode == MODE_CBC) {
+    int lanes = w->ctx->aesmbCtx->lanes;
+    int ret = spec->forEncryption ?
+        aesmb_encrypt(w->ctx, w->input, w->inputLength, w->output, &outLength,
+            lanes) :
+        aesmb_decrypt(w->ctx, w->input, w->inputLength, w->output, &outLength,
+            lanes);
+    return ret < 0 ? -1 : outLength;
+  }
+  return evpMessage(w->ctx->opensslCtx, spec->mode, spec->forEncryption,
+      w->tag, w->output, w->input, w->inputLength);
+}
+
+/*
+ * Allocate the buffers and the context of a worker. Decryption input is
+ * produced by the matching encryption so that tags and padding verify.
+ * Returns 0, 1 if the point is not supported or -1 on error.
+ */
+static int setupWorker(Worker* w) {
+  const BenchSpec* spec = w->spec;
+  size_t capacity = spec->size + BUFFER_SLACK;
+  if (posix_memalign((void**) &w->input, CACHE_LINE_SIZE, capacity) != 0
+      || posix_memalign((void**) &w->output, CACHE_LINE_SIZE, capacity) != 0) {
+    return -1;
+  }
+  memset(w->input, 0x5a, capacity);
+  memset(w->output, 0, capacity);
+  w->inputLength = spec->size;
+
+  if (spec->impl == IMPL_BUFFER || (spec->impl == IMPL_AESMB
+      && spec->mode == MODE_CBC)) {
+    if (spec->mode != MODE_CBC) {
+      return 1;
+    }
+    w->ctx = newMbContext(spec, spec->forEncryption);
+    if (w->ctx == NULL) {
+      return 1;
+    }
+    if (spec->impl == IMPL_AESMB) {
+      // the kernels only take whole blocks for every lane
+      return spec->size < (size_t) w->ctx->aesmbCtx->lanes * 16 ? 1 : 0;
+    }
+    if (!spec->forEncryption) {
+      CipherContext* enc = newMbContext(spec, ENCRYPTION);
+      if (enc == NULL) {
+        return -1;
+      }
+      int length = bufferCrypt(enc, (const char*) w->input, spec->size,
+          (char*) w->output);
+      destroyCipherContext(enc);
+      if (length <= 0 || (size_t) length > capacity) {
+        return -1;
+      }
+      memcpy(w->input, w->output, length);
+      w->inputLength = length;
+    }
+    return 0;
+  }
+
+  // libaesmb has no CTR or XTS kernels, never report libcrypto as aesmb
+  if (spec->impl == IMPL_AESMB && spec->mode != MODE_GCM) {
+    return 1;
+  }
+  const EVP_CIPHER* cipher = evpCipher(spec);
+  if (cipher == NULL || (spec->mode == MODE_XTS && spec->size < 16)) {
+    return 1;
+  }
+  w->ctx = newEvpContext(cipher, spec->forEncryption);
+  if (w->ctx == NULL) {
+    return -1;
+  }
+  if (spec->mode == MODE_GCM && !spec->forEncryption) {
+    CipherContext* enc = newEvpContext(cipher, ENCRYPTION);
+    if (enc == NULL) {
+      return -1;
+    }
+    long ret = evpMessage(enc->opensslCtx, MODE_GCM, ENCRYPTION, w->tag,
+        w->output, w->input, spec->size);
+    destroyCipherContext(enc);
+    if (ret < 0) {
+      return -1;
+    }
+    memcpy(w->input, w->output, spec->size);
+  }
+  return 0;
+}
+
+static void cleanupWorker(Worker* w) {
+  if (w->ctx != NULL) {
+    destroyCipherContext(w->ctx);
+  }
+  free(w->input);
+  free(w->output);
+}
+
+static void* runWorker(void* arg) {
+  Worker* w = (Worker*) arg;
+  // one message to warm up caches and lazily expanded key schedules
+  w->error = benchOp(w) < 0;
+  pthread_barrier_wait(w->start);
+  if (w->error) {
+    return NULL;
+  }
+
+  double begin = now();
+  uint64_t tsc = __rdtsc();
+  do {
+    long n = benchOp(w);
+    if (n < 0) {
+      w->error = 1;
+      return NULL;
+    }
+    w->bytes += n;
+    w->seconds = now() - begin;
+  } while (w->seconds < w->minSeconds);
+  w->cycles = __rdtsc() - tsc;
+  return NULL;
+}
+
+/*
+ * Run a point on threads threads and append its JSON record, returns 0,
+ * 1 if skipped or -1 on error.
+ */
+static int runPoint(const BenchSpec* spec, int threads, double minSeconds,
+    FILE* json, int* records) {
+  Worker workers[threads];
+  pthread_t ids[threads];
+  pthread_barrier_t start;
+  int i, ret = 0;
+
+  memset(workers, 0, sizeof(workers));
+  for (i = 0; i < threads && ret == 0; i++) {
+    workers[i].spec = spec;
+    workers[i].start = &start;
+    workers[i].minSeconds = minSeconds;
+    ret = setupWorker(&workers[i]);
+  }
+  if (ret == 0) {
+    pthread_barrier_init(&start, NULL, threads);
+    for (i = 0; i < threads; i++) {
+      pthread_create(&ids[i], NULL, runWorker, &workers[i]);
+    }
+    for (i = 0; i < threads; i++) {
+      pthread_join(ids[i], NULL);
+      if (workers[i].error) {
+        ret = -1;
+      }
+    }
+    pthread_barrier_destroy(&start);
+  }
+
+  if (ret == 0) {
+    // aggregate throughput of all threads, cycles per byte of one thread
+    double gbps = 0;
+    double cpb = 0;
+    for (i = 0; i < threads; i++) {
+      gbps += workers[i].bytes / workers[i].seconds / 1e9;
+      cpb += (double) workers[i].cycles / workers[i].bytes / threads;
+    }
+    fprintf(stderr, "%-11s %-3s %-7s %3d bits %9lu bytes %2d threads: "
+        "%8.3f GB/s %8.2f cycles/byte\n", implNames[spec->impl],
+        modeNames[spec->mode], spec->forEncryption ? "encrypt" : "decrypt",
+        spec->keyBits, (unsigned long) spec->size, threads, gbps, cpb);
+    fprintf(json, "%s    {\"impl\": \"%s\", \"mode\": \"%s\", "
+        "\"direction\": \"%s\", \"key_bits\": %d, \"size\": %lu, "
+        "\"threads\": %d, \"gbps\": %.4f, \"cycles_per_byte\": %.4f}",
+        *records > 0 ? ",\n" : "", implNames[spec->impl],
+        modeNames[spec->mode], spec->forEncryption ? "encrypt" : "decrypt",
+        spec->keyBits, (unsigned long) spec->size, threads, gbps, cpb);
+    (*records)++;
+  }
+  for (i = 0; i < threads; i++) {
+    cleanupWorker(&workers[i]);
+  }
+  return ret;
+}
+
+static int parseList(const char* arg, int* values, int max) {
+  int count = 0;
+  char* copy = strdup(arg);
+  char* save = NULL;
+  char* token;
+  for (token = strtok_r(copy, ",", &save); token != NULL && count < max;
+      token = strtok_r(NULL, ",", &save)) {
+    values[count++] = atoi(token);
+  }
+  free(copy);
+  return count;
+}
+
+static int parseNames(const char* arg, const char** names, int count) {
+  int mask = 0;
+  int i;
+  char* copy = strdup(arg);
+  char* save = NULL;
+  char* token;
+  for (token = strtok_r(copy, ",", &save); token != NULL;
+      token = strtok_r(NULL, ",", &save)) {
+    for (i = 0; i < count; i++) {
+      if (strcmp(token, names[i]) == 0) {
+        mask |= 1 << i;
+      }
+    }
+  }
+  free(copy);
+  return mask;
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  -i impls    evp,aesmb,bufferCrypt (all)\n"
+      "  -m modes    ctr,cbc,xts,gcm (all)\n"
+      "  -k bits     key sizes, 128,192,256 (all)\n"
+      "  -s bytes    smallest message, 16\n"
+      "  -S bytes    largest message, 67108864, sizes grow 4x\n"
+      "  -t threads  thread counts, e.g. 1,2,4 (1)\n"
+      "  -d seconds  minimum time per point (0.2)\n"
+      "  -o file     JSON output (stdout)\n", name);
+}
+
+int main(int argc, char** argv) {
+  int implMask = (1 << IMPL_COUNT) - 1;
+  int modeMask = 0xf;
+  int keyBits[3] = {128, 192, 256};
+  int keyCount = 3;
+  int threadCounts[MAX_THREAD_COUNTS] = {1};
+  int threadCount = 1;
+  size_t minSize = 16;
+  size_t maxSize = 64 * 1024 * 1024;
+  double minSeconds = 0.2;
+  FILE* json = stdout;
+  int opt, records = 0, failures = 0;
+
+  while ((opt = getopt(argc, argv, "i:m:k:s:S:t:d:o:h")) != -1) {
+    switch (opt) {
+    case 'i':
+      implMask = parseNames(optarg, implNames, IMPL_COUNT);
+      break;
+    case 'm':
+      modeMask = parseNames(optarg, modeNames, 4);
+      break;
+    case 'k':
+      keyCount = parseList(optarg, keyBits, 3);
+      break;
+    case 's':
+      minSize = strtoul(optarg, NULL, 10);
+      break;
+    case 'S':
+      maxSize = strtoul(optarg, NULL, 10);
+      break;
+    case 't':
+      threadCount = parseList(optarg, threadCounts, MAX_THREAD_COUNTS);
+      break;
+    case 'd':
+      minSeconds = atof(optarg);
+      break;
+    case 'o':
+      json = fopen(optarg, "w");
+      if (json == NULL) {
+        perror(optarg);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (minSize == 0 || minSize > maxSize) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  memset(benchKey, 0x3c, sizeof(benchKey));
+  memset(benchIv, 0xa5, sizeof(benchIv));
+  const AesMbDispatch* dispatch = aesmb_dispatch();
+  if (dispatch->handle == NULL) {
+    fprintf(stderr, "libaesmb not loaded (%s), the aesmb paths are skipped\n",
+        dispatch->loadError);
+  }
+
+  int features = cpu_features();
+  fprintf(json, "{\n  \"tsc_ghz\": %.3f,\n  \"cpu_features\": {\"aesni\": %d, "
+      "\"pclmul\": %d, \"avx2\": %d, \"avx512f\": %d, \"vaes\": %d},\n"
+      "  \"aesmb_lanes\": %d,\n  \"results\": [\n", tscGhz(),
+      (features & CPU_FEATURE_AESNI) != 0, (features & CPU_FEATURE_PCLMUL) != 0,
+      (features & CPU_FEATURE_AVX2) != 0, (features & CPU_FEATURE_AVX512F) != 0,
+      (features & CPU_FEATURE_VAES) != 0, dispatch->lanes);
+
+  BenchSpec spec;
+  int t, k;
+  for (spec.impl = 0; spec.impl < IMPL_COUNT; spec.impl++) {
+    if (!(implMask & (1 << spec.impl))) {
+      continue;
+    }
+    for (spec.mode = MODE_CTR; spec.mode <= MODE_GCM; spec.mode++) {
+      if (!(modeMask & (1 << spec.mode))) {
+        continue;
+      }
+      for (spec.forEncryption = 1; spec.forEncryption >= 0;
+          spec.forEncryption--) {
+        for (k = 0; k < keyCount; k++) {
+          spec.keyBits = keyBits[k];
+          for (spec.size = minSize; spec.size <= maxSize; spec.size *= 4) {
+            for (t = 0; t < threadCount; t++) {
+              if (threadCounts[t] > 0 && runPoint(&spec, threadCounts[t],
+                  minSeconds, json, &records) < 0) {
+                fprintf(stderr, "%s %s %d bits %lu bytes failed\n",
+                    implNames[spec.impl], modeNames[spec.mode], spec.keyBits,
+                    (unsigned long) spec.size);
+                failures++;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  fprintf(json, "\n  ]\n}\n");
+  if (json != stdout) {
+    fclose(json);
+  }
+  return failures > 0 ? 2 : 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_crypto_digests_SHADigest.h"
+#include "sha.h"
+
+// max bytes hashed per GetPrimitiveArrayCritical section
+#define CRITICAL_CHUNK_SIZE (256 * 1024)
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_create(
+    JNIEnv *env, jclass clazz, jint algorithm) {
+  ShaContext* ctx = (ShaContext*) malloc(sizeof(ShaContext));
+  if (ctx == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  if (sha_init(ctx, algorithm) != 0) {
+    free(ctx);
+    THROW(env, "java/lang/IllegalArgumentException", "Unknown algorithm");
+    return 0;
+  }
+  return (jlong) ctx;
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_copy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  ShaContext* ctx = (ShaContext*) malloc(sizeof(ShaContext));
+  if (ctx == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  memcpy(ctx, (ShaContext*) context, sizeof(ShaContext));
+  return (jlong) ctx;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_destroy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  ShaContext* ctx = (ShaContext*) context;
+  memset(ctx, 0, sizeof(ShaContext));
+  free(ctx);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_reset(
+    JNIEnv *env, jclass clazz, jlong context) {
+  ShaContext* ctx = (ShaContext*) context;
+  sha_init(ctx, ctx->alg);
+}
+
+/*
+ * The array is pinned at most CRITICAL_CHUNK_SIZE bytes at a time, so that
+ * a single large update can not stall the GC for long.
+ */
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_updateArray(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray in, jint inOff,
+    jint inLen) {
+  ShaContext* ctx = (ShaContext*) context;
+  while (inLen > 0) {
+    int chunk = inLen > CRITICAL_CHUNK_SIZE ? CRITICAL_CHUNK_SIZE : inLen;
+    uint8_t* input = (uint8_t*) (*env)->GetPrimitiveArrayCritical(env, in, 0);
+    if (NULL == input) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the input array");
+      return;
+    }
+    sha_update(ctx, input + inOff, chunk);
+    (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+    inOff += chunk;
+    inLen -= chunk;
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_updateDirect(
+    JNIEnv *env, jclass clazz, jlong context, jobject inputDirectBuffer,
+    jint start, jint inputLength) {
+  uint8_t* input = (uint8_t*)
+      (*env)->GetDirectBufferAddress(env, inputDirectBuffer);
+  if (NULL == input) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Input must be a direct buffer");
+    return;
+  }
+  sha_update((ShaContext*) context, input + start, inputLength);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_doFinal(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray out, jint outOff) {
+  uint8_t digest[SHA256_HASH_LENGTH];
+  ShaContext* ctx = (ShaContext*) context;
+  int length = sha_hash_length(ctx->alg);
+  sha_final(ctx, digest);
+  (*env)->SetByteArrayRegion(env, out, outOff, length, (jbyte*) digest);
+}
+
+JNIEXPORT jstring JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_getKernelName(
+    JNIEnv *env, jclass clazz, jint algorithm) {
+  if (sha_hash_length(algorithm) < 0) {
+    return NULL;
+  }
+  return (*env)->NewStringUTF(env, sha_kernel_name(algorithm));
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_digests_SHADigest_batch(
+    JNIEnv *env, jclass clazz, jobject messages, jintArray offsets,
+    jintArray lengths, jint count, jobject digests, jint begin) {
+  uint8_t* base = (uint8_t*) (*env)->GetDirectBufferAddress(env, messages);
+  jlong capacity = (*env)->GetDirectBufferCapacity(env, messages);
+  uint8_t* output = (uint8_t*) (*env)->GetDirectBufferAddress(env, digests);
+  if (NULL == base || NULL == output) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Messages and digests must be in direct buffers");
+    return;
+  }
+
+  jint* off = (jint*) malloc(2 * count * sizeof(jint));
+  const uint8_t** inputs = (const uint8_t**) malloc(count * sizeof(uint8_t*));
+  uint8_t** outputs = (uint8_t**) malloc(count * sizeof(uint8_t*));
+  size_t* sizes = (size_t*) malloc(count * sizeof(size_t));
+  if (NULL == off || NULL == inputs || NULL == outputs || NULL == sizes) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the batch");
+    goto cleanup;
+  }
+  jint* len = off + count;
+  (*env)->GetIntArrayRegion(env, offsets, 0, count, off);
+  (*env)->GetIntArrayRegion(env, lengths, 0, count, len);
+
+  int i;
+  for (i = 0; i < count; i++) {
+    if (off[i] < 0 || len[i] < 0 || (jlong) off[i] + len[i] > capacity) {
+      THROW(env, "java/lang/IllegalArgumentException",
+          "Message out of the buffer bounds");
+      goto cleanup;
+    }
+    inputs[i] = base + off[i];
+    sizes[i] = len[i];
+    outputs[i] = output + begin + i * SHA256_HASH_LENGTH;
+  }
+  sha256_batch(inputs, sizes, count, outputs);
+
+cleanup:
+  free(off);
+  free(inputs);
+  free(outputs);
+  free(sizes);
+}
@@ -0,0 +1,369 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "cpu_features.h"
+#include "sha.h"
+
+static const uint32_t sha1Init[5] = {
+  0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static const uint32_t sha256Init[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t sha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t load32(const uint8_t* p) {
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+      | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline void store32(uint8_t* p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void sha1_compress_c(uint32_t* state, const uint8_t* data,
+    size_t blocks) {
+  uint32_t w[80];
+  int t;
+  for (; blocks > 0; blocks--, data += SHA_BLOCK_LENGTH) {
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+        e = state[4];
+    for (t = 0; t < 16; t++) {
+      w[t] = load32(data + 4 * t);
+    }
+    for (; t < 80; t++) {
+      w[t] = ROL(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+    }
+    for (t = 0; t < 80; t++) {
+      uint32_t f, k;
+      if (t < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5a827999;
+      } else if (t < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ed9eba1;
+      } else if (t < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8f1bbcdc;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xca62c1d6;
+      }
+      uint32_t temp = ROL(a, 5) + f + e + k + w[t];
+      e = d;
+      d = c;
+      c = ROL(b, 30);
+      b = a;
+      a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+}
+
+static void sha256_compress_c(uint32_t* state, const uint8_t* data,
+    size_t blocks) {
+  uint32_t w[64];
+  int t;
+  for (; blocks > 0; blocks--, data += SHA_BLOCK_LENGTH) {
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+        e = state[4], f = state[5], g = state[6], h = state[7];
+    for (t = 0; t < 16; t++) {
+      w[t] = load32(data + 4 * t);
+    }
+    for (; t < 64; t++) {
+      uint32_t s0 = ROR(w[t - 15], 7) ^ ROR(w[t - 15], 18) ^ (w[t - 15] >> 3);
+      uint32_t s1 = ROR(w[t - 2], 17) ^ ROR(w[t - 2], 19) ^ (w[t - 2] >> 10);
+      w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    for (t = 0; t < 64; t++) {
+      uint32_t s1 = ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + sha256K[t] + w[t];
+      uint32_t s0 = ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+static pthread_once_t bindOnce = PTHREAD_ONCE_INIT;
+static ShaCompress sha1Compress = sha1_compress_c;
+static ShaCompress sha256Compress = sha256_compress_c;
+static int sha256X8 = 0;
+
+static void bindKernels() {
+  // the SHA-NI kernels also use SSE4.1, which every SHA-NI CPU has
+  if (cpu_has(CPU_FEATURE_SHANI)) {
+    sha1Compress = sha1_compress_ni;
+    sha256Compress = sha256_compress_ni;
+  }
+  sha256X8 = cpu_has(CPU_FEATURE_AVX2);
+}
+
+int sha_hash_length(int alg) {
+  switch (alg) {
+  case SHA_ALG_SHA1:
+    return SHA1_HASH_LENGTH;
+  case SHA_ALG_SHA256:
+    return SHA256_HASH_LENGTH;
+  default:
+    return -1;
+  }
+}
+
+const char* sha_kernel_name(int alg) {
+  pthread_once(&bindOnce, bindKernels);
+  if (alg == SHA_ALG_SHA1) {
+    return sha1Compress == sha1_compress_ni ? "sha1_compress_ni" :
+        "sha1_compress_c";
+  }
+  return sha256Compress == sha256_compress_ni ? "sha256_compress_ni" :
+      "sha256_compress_c";
+}
+
+int sha_init(ShaContext* ctx, int alg) {
+  pthread_once(&bindOnce, bindKernels);
+  if (alg == SHA_ALG_SHA1) {
+    memcpy(ctx->state, sha1Init, sizeof(sha1Init));
+    ctx->compress = sha1Compress;
+  } else if (alg == SHA_ALG_SHA256) {
+    memcpy(ctx->state, sha256Init, sizeof(sha256Init));
+    ctx->compress = sha256Compress;
+  } else {
+    return -1;
+  }
+  ctx->alg = alg;
+  ctx->length = 0;
+  ctx->num = 0;
+  return 0;
+}
+
+void sha_update(ShaContext* ctx, const uint8_t* data, size_t length) {
+  ctx->length += length;
+  if (ctx->num > 0) {
+    size_t n = SHA_BLOCK_LENGTH - ctx->num;
+    if (length < n) {
+      memcpy(ctx->buffer + ctx->num, data, length);
+      ctx->num += length;
+      return;
+    }
+    memcpy(ctx->buffer + ctx->num, data, n);
+    ctx->compress(ctx->state, ctx->buffer, 1);
+    data += n;
+    length -= n;
+    ctx->num = 0;
+  }
+  // full blocks are hashed in place
+  if (length >= SHA_BLOCK_LENGTH) {
+    size_t blocks = length / SHA_BLOCK_LENGTH;
+    ctx->compress(ctx->state, data, blocks);
+    data += blocks * SHA_BLOCK_LENGTH;
+    length -= blocks * SHA_BLOCK_LENGTH;
+  }
+  if (length > 0) {
+    memcpy(ctx->buffer, data, length);
+    ctx->num = length;
+  }
+}
+
+/*
+ * Write the padding of a message of length bytes, ending with the last num
+ * bytes of data, into tail. Returns the number of tail blocks, 1 or 2.
+ */
+static int pad(uint8_t* tail, const uint8_t* data, int num, uint64_t length) {
+  int blocks = num < SHA_BLOCK_LENGTH - 8 ? 1 : 2;
+  int end = blocks * SHA_BLOCK_LENGTH;
+  memcpy(tail, data, num);
+  tail[num] = 0x80;
+  memset(tail + num + 1, 0, end - 8 - num - 1);
+  store32(tail + end - 8, (uint32_t) (length >> 29));
+  store32(tail + end - 4, (uint32_t) (length << 3));
+  return blocks;
+}
+
+void sha_final(ShaContext* ctx, uint8_t* out) {
+  uint8_t tail[2 * SHA_BLOCK_LENGTH];
+  int blocks = pad(tail, ctx->buffer, ctx->num, ctx->length);
+  int words = sha_hash_length(ctx->alg) / 4;
+  int i;
+  ctx->compress(ctx->state, tail, blocks);
+  for (i = 0; i < words; i++) {
+    store32(out + 4 * i, ctx->state[i]);
+  }
+  memset(ctx->buffer, 0, sizeof(ctx->buffer));
+  sha_init(ctx, ctx->alg);
+}
+
+#define LANES 8
+
+// lane phases of a batch message
+#define PHASE_DATA 0
+#define PHASE_TAIL 1
+
+typedef struct _BatchLane {
+  int message;           // -1 for an idle lane
+  int phase;
+  size_t blocks;         // blocks left in the phase
+  uint8_t tail[2 * SHA_BLOCK_LENGTH];
+} BatchLane;
+
+static void startTail(BatchLane* lane, const uint8_t** data,
+    const uint8_t* input, size_t length) {
+  size_t full = length / SHA_BLOCK_LENGTH * SHA_BLOCK_LENGTH;
+  lane->phase = PHASE_TAIL;
+  lane->blocks = pad(lane->tail, input + full, length - full, length);
+  *data = lane->tail;
+}
+
+static void startData(BatchLane* lane, const uint8_t** data,
+    const uint8_t* input, size_t length) {
+  lane->phase = PHASE_DATA;
+  lane->blocks = length / SHA_BLOCK_LENGTH;
+  *data = input;
+  if (lane->blocks == 0) {
+    startTail(lane, data, input, length);
+  }
+}
+
+/*
+ * Keep the eight lanes busy with messages, a kernel pass runs for as many
+ * blocks as the shortest lane needs in its current phase.
+ */
+static void sha256_batch_x8(const uint8_t** inputs, const size_t* lengths,
+    int count, uint8_t** outputs) {
+  static const uint8_t idle[SHA_BLOCK_LENGTH];
+  uint32_t state[8][LANES];
+  const uint8_t* data[LANES];
+  int step[LANES];
+  BatchLane lanes[LANES];
+  int next = 0, busy = 0;
+  int i, w;
+
+  for (i = 0; i < LANES; i++) {
+    lanes[i].message = -1;
+    data[i] = idle;
+    step[i] = 0;
+  }
+
+  while (next < count || busy > 0) {
+    for (i = 0; i < LANES && next < count; i++) {
+      if (lanes[i].message < 0) {
+        lanes[i].message = next++;
+        for (w = 0; w < 8; w++) {
+          state[w][i] = sha256Init[w];
+        }
+        startData(&lanes[i], &data[i], inputs[lanes[i].message],
+            lengths[lanes[i].message]);
+        step[i] = SHA_BLOCK_LENGTH;
+        busy++;
+      }
+    }
+
+    size_t blocks = 0;
+    for (i = 0; i < LANES; i++) {
+      if (lanes[i].message >= 0 && (blocks == 0 || lanes[i].blocks < blocks)) {
+        blocks = lanes[i].blocks;
+      }
+    }
+    sha256_compress_x8_avx2(state, data, step, blocks);
+
+    for (i = 0; i < LANES; i++) {
+      BatchLane* lane = &lanes[i];
+      if (lane->message < 0) {
+        continue;
+      }
+      lane->blocks -= blocks;
+      if (lane->blocks > 0) {
+        continue;
+      }
+      if (lane->phase == PHASE_DATA) {
+        startTail(lane, &data[i], inputs[lane->message],
+            lengths[lane->message]);
+        continue;
+      }
+      for (w = 0; w < 8; w++) {
+        store32(outputs[lane->message] + 4 * w, state[w][i]);
+      }
+      lane->message = -1;
+      data[i] = idle;
+      step[i] = 0;
+      busy--;
+    }
+  }
+}
+
+void sha256_batch(const uint8_t** inputs, const size_t* lengths, int count,
+    uint8_t** outputs) {
+  pthread_once(&bindOnce, bindKernels);
+  // SHA-NI hashes a single message faster than a lane of the AVX2 kernel
+  if (sha256X8 && sha256Compress != sha256_compress_ni && count > 1) {
+    sha256_batch_x8(inputs, lengths, count, outputs);
+    return;
+  }
+
+  ShaContext ctx;
+  int i;
+  for (i = 0; i < count; i++) {
+    sha_init(&ctx, SHA_ALG_SHA256);
+    sha_update(&ctx, inputs[i], lengths[i]);
+    sha_final(&ctx, outputs[i]);
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SHA_H
+#define __SHA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// algorithms, shared with com.intel.diceros.crypto.digests.SHADigest
+#define SHA_ALG_SHA1 1
+#define SHA_ALG_SHA256 2
+
+#define SHA1_HASH_LENGTH 20
+#define SHA256_HASH_LENGTH 32
+#define SHA_BLOCK_LENGTH 64
+
+/*
+ * Compress blocks * 64 bytes of data into the state.
+ */
+typedef void (*ShaCompress)(uint32_t* state, const uint8_t* data,
+    size_t blocks);
+
+typedef struct _ShaContext {
+  uint32_t state[8];
+  uint64_t length;       // bytes hashed so far
+  uint8_t buffer[SHA_BLOCK_LENGTH];
+  int num;               // bytes pending in buffer
+  int alg;
+  ShaCompress compress;
+} ShaContext;
+
+/*
+ * Returns the digest length of alg, or -1 if it is unknown.
+ */
+int sha_hash_length(int alg);
+
+/*
+ * Start a new message, returns -1 if alg is unknown.
+ */
+int sha_init(ShaContext* ctx, int alg);
+void sha_update(ShaContext* ctx, const uint8_t* data, size_t length);
+
+/*
+ * Write the digest of the message to out and start a new message.
+ */
+void sha_final(ShaContext* ctx, uint8_t* out);
+
+/*
+ * Returns the name of the compression kernel bound for alg.
+ */
+const char* sha_kernel_name(int alg);
+
+/*
+ * Hash count independent messages with SHA-256, digest i is written to
+ * outputs[i]. Eight messages are hashed together with AVX2 when the CPU
+ * supports it.
+ */
+void sha256_batch(const uint8_t** inputs, const size_t* lengths, int count,
+    uint8_t** outputs);
+
+/*
+ * The compression kernels, see sha.c for the dispatch.
+ */
+void sha1_compress_ni(uint32_t* state, const uint8_t* data, size_t blocks);
+void sha256_compress_ni(uint32_t* state, const uint8_t* data, size_t blocks);
+
+/*
+ * Compress blocks blocks into eight transposed states, state[w][lane] is word
+ * w of a lane. The data pointer of a lane advances by step[lane] bytes per
+ * block, idle lanes use a step of 0. The advanced pointers are written back
+ * to data.
+ */
+void sha256_compress_x8_avx2(uint32_t state[8][8], const uint8_t* data[8],
+    const int step[8], size_t blocks);
+
+#endif
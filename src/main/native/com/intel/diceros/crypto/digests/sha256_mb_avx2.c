@@ -0,0 +1,146 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-buffer SHA-256 for AVX2: the eight 32 bit elements of a register
+ * belong to eight independent messages, so every instruction advances all
+ * of them. Only called after the CPU has been checked for AVX2, see sha.c.
+ */
+
+#include <immintrin.h>
+#include "sha.h"
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static const uint32_t sha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR8(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), \
+    _mm256_slli_epi32(x, 32 - (n)))
+
+/*
+ * Load the 16 big endian words of one block of every lane, transposed so
+ * that w[t] holds word t of all lanes.
+ */
+AVX2_TARGET
+static inline void loadBlock(__m256i* w, const uint8_t* data[8]) {
+  const __m256i swap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6,
+      7, 0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  int half, i;
+  for (half = 0; half < 2; half++) {
+    __m256i r[8], t[8];
+    // row i: words 8 * half .. 8 * half + 7 of lane i
+    for (i = 0; i < 8; i++) {
+      r[i] = _mm256_shuffle_epi8(_mm256_loadu_si256(
+          (const __m256i*) (data[i] + 32 * half)), swap);
+    }
+    // 8x8 transpose of 32 bit elements
+    for (i = 0; i < 8; i += 2) {
+      t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+      t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4) {
+      r[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+      r[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+      r[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+      r[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (i = 0; i < 4; i++) {
+      w[8 * half + i] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x20);
+      w[8 * half + i + 4] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x31);
+    }
+  }
+}
+
+AVX2_TARGET
+void sha256_compress_x8_avx2(uint32_t state[8][8], const uint8_t* data[8],
+    const int step[8], size_t blocks) {
+  const uint8_t* p[8];
+  __m256i s[8], v[8], w[16];
+  int i, t;
+
+  for (i = 0; i < 8; i++) {
+    s[i] = _mm256_loadu_si256((const __m256i*) state[i]);
+    p[i] = data[i];
+  }
+
+  for (; blocks > 0; blocks--) {
+    loadBlock(w, p);
+    for (i = 0; i < 8; i++) {
+      v[i] = s[i];
+      p[i] += step[i];
+    }
+
+    for (t = 0; t < 64; t++) {
+      __m256i wt;
+      if (t < 16) {
+        wt = w[t];
+      } else {
+        __m256i w15 = w[(t - 15) & 15], w2 = w[(t - 2) & 15];
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROR8(w15, 7),
+            ROR8(w15, 18)), _mm256_srli_epi32(w15, 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROR8(w2, 17),
+            ROR8(w2, 19)), _mm256_srli_epi32(w2, 10));
+        wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0),
+            _mm256_add_epi32(w[(t - 7) & 15], s1));
+        w[t & 15] = wt;
+      }
+
+      __m256i a = v[0], b = v[1], c = v[2], e = v[4];
+      __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROR8(e, 6), ROR8(e, 11)),
+          ROR8(e, 25));
+      __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, v[5]),
+          _mm256_andnot_si256(e, v[6]));
+      __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(v[7], s1),
+          _mm256_add_epi32(ch, _mm256_add_epi32(wt,
+          _mm256_set1_epi32(sha256K[t]))));
+      __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROR8(a, 2), ROR8(a, 13)),
+          ROR8(a, 22));
+      __m256i maj = _mm256_xor_si256(_mm256_and_si256(a, b),
+          _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+      v[7] = v[6];
+      v[6] = v[5];
+      v[5] = e;
+      v[4] = _mm256_add_epi32(v[3], t1);
+      v[3] = c;
+      v[2] = b;
+      v[1] = a;
+      v[0] = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+    }
+
+    for (i = 0; i < 8; i++) {
+      s[i] = _mm256_add_epi32(s[i], v[i]);
+    }
+  }
+
+  for (i = 0; i < 8; i++) {
+    _mm256_storeu_si256((__m256i*) state[i], s[i]);
+    data[i] = p[i];
+  }
+}
@@ -0,0 +1,150 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SHA-1 and SHA-256 compression with the SHA extensions. Message words are
+ * kept in groups of four per register, W[g & 3] holds group g while the
+ * following groups are scheduled from it. Only called after the CPU has
+ * been checked for SHA-NI, see sha.c.
+ */
+
+#include <immintrin.h>
+#include "sha.h"
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1")))
+
+static const uint32_t sha256K[64] __attribute__((aligned(16))) = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+SHA_NI_TARGET
+void sha1_compress_ni(uint32_t* state, const uint8_t* data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+      0x08090a0b0c0d0e0fULL);
+  __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state),
+      0x1B);
+  __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+  __m128i e1, abcdSave, eSave;
+  __m128i w[4];
+  int g;
+
+  for (; blocks > 0; blocks--, data += SHA_BLOCK_LENGTH) {
+    abcdSave = abcd;
+    eSave = e0;
+
+#pragma GCC unroll 20
+    for (g = 0; g < 20; g++) {
+      // e0 and e1 swap roles every four rounds
+      __m128i* e = (g & 1) ? &e1 : &e0;
+      __m128i* next = (g & 1) ? &e0 : &e1;
+      if (g < 4) {
+        w[g] = _mm_shuffle_epi8(_mm_loadu_si128(
+            (const __m128i*) (data + 16 * g)), mask);
+      }
+      *e = g == 0 ? _mm_add_epi32(*e, w[0]) : _mm_sha1nexte_epu32(*e, w[g & 3]);
+      *next = abcd;
+      if (g >= 3 && g <= 18) {
+        w[(g + 1) & 3] = _mm_sha1msg2_epu32(w[(g + 1) & 3], w[g & 3]);
+      }
+      switch (g / 5) {
+      case 0:
+        abcd = _mm_sha1rnds4_epu32(abcd, *e, 0);
+        break;
+      case 1:
+        abcd = _mm_sha1rnds4_epu32(abcd, *e, 1);
+        break;
+      case 2:
+        abcd = _mm_sha1rnds4_epu32(abcd, *e, 2);
+        break;
+      default:
+        abcd = _mm_sha1rnds4_epu32(abcd, *e, 3);
+        break;
+      }
+      if (g >= 1 && g <= 16) {
+        w[(g + 3) & 3] = _mm_sha1msg1_epu32(w[(g + 3) & 3], w[g & 3]);
+      }
+      if (g >= 2 && g <= 17) {
+        w[(g + 2) & 3] = _mm_xor_si128(w[(g + 2) & 3], w[g & 3]);
+      }
+    }
+
+    e0 = _mm_sha1nexte_epu32(e0, eSave);
+    abcd = _mm_add_epi32(abcd, abcdSave);
+  }
+
+  _mm_storeu_si128((__m128i*) state, _mm_shuffle_epi32(abcd, 0x1B));
+  state[4] = _mm_extract_epi32(e0, 3);
+}
+
+SHA_NI_TARGET
+void sha256_compress_ni(uint32_t* state, const uint8_t* data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+      0x0405060700010203ULL);
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state),
+      0xB1);
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(
+      (const __m128i*) (state + 4)), 0x1B);
+  // the rounds work on ABEF and CDGH
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+  __m128i abefSave, cdghSave, msg;
+  __m128i w[4];
+  int g;
+
+  for (; blocks > 0; blocks--, data += SHA_BLOCK_LENGTH) {
+    abefSave = state0;
+    cdghSave = state1;
+    for (g = 0; g < 4; g++) {
+      w[g] = _mm_shuffle_epi8(_mm_loadu_si128(
+          (const __m128i*) (data + 16 * g)), mask);
+    }
+
+#pragma GCC unroll 16
+    for (g = 0; g < 16; g++) {
+      msg = _mm_add_epi32(w[g & 3],
+          _mm_load_si128((const __m128i*) (sha256K + 4 * g)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      state0 = _mm_sha256rnds2_epu32(state0, state1,
+          _mm_shuffle_epi32(msg, 0x0E));
+      if (g < 12) {
+        // group g + 4 from groups g .. g + 3
+        msg = _mm_add_epi32(_mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]),
+            _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+        w[g & 3] = _mm_sha256msg2_epu32(msg, w[(g + 3) & 3]);
+      }
+    }
+
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  _mm_storeu_si128((__m128i*) state, _mm_blend_epi16(tmp, state1, 0xF0));
+  _mm_storeu_si128((__m128i*) (state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
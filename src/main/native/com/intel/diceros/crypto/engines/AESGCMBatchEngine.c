@@ -0,0 +1,263 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+#include "com_intel_diceros.h"
+#include "aes_utils.h"
+#include "com_intel_diceros_crypto_engines_AESGCMBatchEngine.h"
+
+#define DESC_NONCE_OFFSET com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_NONCE_OFFSET
+#define DESC_NONCE_LENGTH com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_NONCE_LENGTH
+#define DESC_AAD_OFFSET com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_AAD_OFFSET
+#define DESC_AAD_LENGTH com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_AAD_LENGTH
+#define DESC_INPUT_OFFSET com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_INPUT_OFFSET
+#define DESC_INPUT_LENGTH com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_INPUT_LENGTH
+#define DESC_OUTPUT_OFFSET com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESC_OUTPUT_OFFSET
+#define DESCRIPTOR_SIZE com_intel_diceros_crypto_engines_AESGCMBatchEngine_DESCRIPTOR_SIZE
+#define AUTHENTICATION_FAILED com_intel_diceros_crypto_engines_AESGCMBatchEngine_AUTHENTICATION_FAILED
+
+// results copied to the java array per SetIntArrayRegion call
+#define RECORDS_PER_CHUNK 64
+
+typedef struct _GcmBatchContext {
+  EVP_CIPHER_CTX* encryptCtx;
+  EVP_CIPHER_CTX* decryptCtx;
+  int encryptIvLength;
+  int decryptIvLength;
+  int tagLength;
+} GcmBatchContext;
+
+static void freeBatchContext(GcmBatchContext* batchCtx) {
+  if (batchCtx->encryptCtx != NULL) {
+    EVP_CIPHER_CTX_cleanup(batchCtx->encryptCtx);
+    free(batchCtx->encryptCtx);
+  }
+  if (batchCtx->decryptCtx != NULL) {
+    EVP_CIPHER_CTX_cleanup(batchCtx->decryptCtx);
+    free(batchCtx->decryptCtx);
+  }
+  free(batchCtx);
+}
+
+static EVP_CIPHER_CTX* newKeyedContext(const EVP_CIPHER* cipher,
+    const unsigned char* key, int enc) {
+  EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX *) malloc(sizeof(EVP_CIPHER_CTX));
+  if (ctx == NULL) {
+    return NULL;
+  }
+  EVP_CIPHER_CTX_init(ctx);
+  if (!EVP_CipherInit_ex(ctx, cipher, NULL, key, NULL, enc)) {
+    EVP_CIPHER_CTX_cleanup(ctx);
+    free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESGCMBatchEngine_create(
+    JNIEnv *env, jclass clazz, jbyteArray key, jint tagLength) {
+  int keyLength = (*env)->GetArrayLength(env, key);
+  EVP_CIPHER* cipher = getCipher(MODE_GCM, keyLength);
+  if (cipher == NULL) {
+    THROW(env, "java/lang/IllegalArgumentException", "unsupportted key size");
+    return 0;
+  }
+
+  unsigned char keyBytes[32];
+  (*env)->GetByteArrayRegion(env, key, 0, keyLength, (jbyte *) keyBytes);
+
+  GcmBatchContext* batchCtx = (GcmBatchContext*) calloc(1,
+      sizeof(GcmBatchContext));
+  if (batchCtx == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  // the key schedule is expanded here once, records only reload the IV
+  batchCtx->encryptCtx = newKeyedContext(cipher, keyBytes, ENCRYPTION);
+  batchCtx->decryptCtx = newKeyedContext(cipher, keyBytes, DECRYPTION);
+  memset(keyBytes, 0, sizeof(keyBytes));
+  if (batchCtx->encryptCtx == NULL || batchCtx->decryptCtx == NULL) {
+    freeBatchContext(batchCtx);
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in initializing the batch context");
+    return 0;
+  }
+  batchCtx->encryptIvLength = EVP_CIPHER_iv_length(cipher);
+  batchCtx->decryptIvLength = batchCtx->encryptIvLength;
+  batchCtx->tagLength = tagLength;
+  return (jlong) batchCtx;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESGCMBatchEngine_destroy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  freeBatchContext((GcmBatchContext*) context);
+}
+
+static int inRange(jint offset, jint length, jlong capacity) {
+  return offset >= 0 && length >= 0 && (jlong) offset + length <= capacity;
+}
+
+/*
+ * Check the ranges of the n records in desc against the buffer capacity.
+ */
+static int checkRecords(const jint* desc, int n, int seal, int tagLength,
+    jlong capacity) {
+  int i;
+  for (i = 0; i < n; i++, desc += DESCRIPTOR_SIZE) {
+    jint inputLength = desc[DESC_INPUT_LENGTH];
+    jint outputLength = seal ? inputLength + tagLength :
+        inputLength - tagLength;
+    if (inputLength < 0 || inputLength > 0x7fffffff - tagLength
+        || outputLength < 0 || desc[DESC_NONCE_LENGTH] <= 0
+        || !inRange(desc[DESC_NONCE_OFFSET], desc[DESC_NONCE_LENGTH], capacity)
+        || !inRange(desc[DESC_AAD_OFFSET], desc[DESC_AAD_LENGTH], capacity)
+        || !inRange(desc[DESC_INPUT_OFFSET], inputLength, capacity)
+        || !inRange(desc[DESC_OUTPUT_OFFSET], outputLength, capacity)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Seal or open one record, returns its output length, AUTHENTICATION_FAILED
+ * or -2 on an openssl error.
+ */
+static int processRecord(GcmBatchContext* batchCtx, int seal,
+    unsigned char* base, const jint* desc) {
+  EVP_CIPHER_CTX* ctx = seal ? batchCtx->encryptCtx : batchCtx->decryptCtx;
+  int* ivLength = seal ? &batchCtx->encryptIvLength :
+      &batchCtx->decryptIvLength;
+  int tagLength = batchCtx->tagLength;
+  int nonceLength = desc[DESC_NONCE_LENGTH];
+  int dataLength = seal ? desc[DESC_INPUT_LENGTH] :
+      desc[DESC_INPUT_LENGTH] - tagLength;
+  unsigned char* in = base + desc[DESC_INPUT_OFFSET];
+  unsigned char* out = base + desc[DESC_OUTPUT_OFFSET];
+  int outLength = 0;
+  int len;
+
+  if (nonceLength != *ivLength) {
+    if (!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, nonceLength, NULL)) {
+      return -2;
+    }
+    *ivLength = nonceLength;
+  }
+  if (!EVP_CipherInit_ex(ctx, NULL, NULL, NULL,
+      base + desc[DESC_NONCE_OFFSET], -1)) {
+    return -2;
+  }
+  if (desc[DESC_AAD_LENGTH] > 0 && !EVP_CipherUpdate(ctx, NULL, &len,
+      base + desc[DESC_AAD_OFFSET], desc[DESC_AAD_LENGTH])) {
+    return -2;
+  }
+  if (!seal && !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, tagLength,
+      in + dataLength)) {
+    return -2;
+  }
+  if (dataLength > 0) {
+    if (!EVP_CipherUpdate(ctx, out, &len, in, dataLength)) {
+      return -2;
+    }
+    outLength = len;
+  }
+  if (!EVP_CipherFinal_ex(ctx, out + outLength, &len)) {
+    if (seal) {
+      return -2;
+    }
+    memset(out, 0, dataLength);
+    return AUTHENTICATION_FAILED;
+  }
+  outLength += len;
+  if (seal) {
+    if (!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tagLength,
+        out + outLength)) {
+      return -2;
+    }
+    outLength += tagLength;
+  }
+  return outLength;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESGCMBatchEngine_process(
+    JNIEnv *env, jclass clazz, jlong context, jboolean seal, jobject records,
+    jintArray descriptors, jint count, jintArray results) {
+  GcmBatchContext* batchCtx = (GcmBatchContext*) context;
+  unsigned char* base = (*env)->GetDirectBufferAddress(env, records);
+  jlong capacity = (*env)->GetDirectBufferCapacity(env, records);
+  jint res[RECORDS_PER_CHUNK];
+  int failures = 0;
+  int first, n, i;
+
+  if (base == NULL) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Records must be in a direct buffer");
+    return 0;
+  }
+  if (count < 0 || (jlong) count * DESCRIPTOR_SIZE
+      > (*env)->GetArrayLength(env, descriptors)
+      || count > (*env)->GetArrayLength(env, results)) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid record count");
+    return 0;
+  }
+
+  // the descriptors are copied once and that copy is validated and used,
+  // so neither a bad descriptor nor a concurrent change of the java array
+  // after the check can make a record reach outside the buffer
+  jint* desc = (jint*) malloc((count > 0 ? (size_t) count : 1)
+      * DESCRIPTOR_SIZE * sizeof(jint));
+  if (desc == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot copy the descriptors");
+    return 0;
+  }
+  (*env)->GetIntArrayRegion(env, descriptors, 0, count * DESCRIPTOR_SIZE,
+      desc);
+  if ((*env)->ExceptionCheck(env)) {
+    free(desc);
+    return 0;
+  }
+  if (!checkRecords(desc, count, seal, batchCtx->tagLength, capacity)) {
+    free(desc);
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Record out of the buffer bounds");
+    return 0;
+  }
+
+  for (first = 0; first < count; first += n) {
+    n = count - first < RECORDS_PER_CHUNK ? count - first : RECORDS_PER_CHUNK;
+    for (i = 0; i < n; i++) {
+      res[i] = processRecord(batchCtx, seal, base,
+          desc + (size_t) (first + i) * DESCRIPTOR_SIZE);
+      if (res[i] == -2) {
+        (*env)->SetIntArrayRegion(env, results, first, i, res);
+        free(desc);
+        THROW(env, "java/security/GeneralSecurityException",
+            "Error in processing the record batch");
+        return 0;
+      }
+      if (res[i] == AUTHENTICATION_FAILED) {
+        failures++;
+      }
+    }
+    (*env)->SetIntArrayRegion(env, results, first, n, res);
+  }
+  free(desc);
+  return failures;
+}
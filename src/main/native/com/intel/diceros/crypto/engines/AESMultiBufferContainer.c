@@ -0,0 +1,176 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "config.h"
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_crypto_engines_AESMultiBufferContainer.h"
+#include "aes_multibuffer.h"
+#include "aes_multibuffer_stream.h"
+#include "aes_multibuffer_container.h"
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferContainer_create(
+    JNIEnv *env, jclass clazz, jboolean forEncryption, jbyteArray key, jbyteArray iv) {
+  int keyLength = (*env)->GetArrayLength(env, key);
+  int ivLength = (*env)->GetArrayLength(env, iv);
+  jbyte nativeKey[32];
+  jbyte nativeIv[16];
+  if ((keyLength != 16 && keyLength != 24 && keyLength != 32) || ivLength != 16) {
+    THROW(env, "java/lang/IllegalArgumentException", "Illegal key or IV size");
+    return 0;
+  }
+  (*env)->GetByteArrayRegion(env, key, 0, keyLength, nativeKey);
+  (*env)->GetByteArrayRegion(env, iv, 0, ivLength, nativeIv);
+
+  int loadLibraryResult = 0;
+  long ctx = init(env, forEncryption, nativeKey, keyLength, nativeIv, ivLength,
+      PADDING_NOPADDING, 0, &loadLibraryResult);
+  memset(nativeKey, 0, sizeof(nativeKey));
+  if (loadLibraryResult == -1) {
+    THROW(env, "java/lang/UnsatisfiedLinkError", "Cannot load " HADOOP_CRYPTO_LIBRARY);
+    return 0;
+  }
+  return ctx;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferContainer_destroy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  destroyCipherContext((CipherContext*) context);
+}
+
+/*
+ * Copy length bytes of array from offset into a new native buffer, returns
+ * NULL with an exception pending on failure. Only the given range of the
+ * java array is read, and results are written back with
+ * SetByteArrayRegion over the output range only, so instances working on
+ * disjoint ranges of one shared array never overwrite each other.
+ */
+static unsigned char* copyRange(JNIEnv *env, jbyteArray array, jint offset,
+    jint length) {
+  unsigned char* buffer = (unsigned char*) malloc(length > 0 ? length : 1);
+  if (NULL == buffer) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the buffer");
+    return NULL;
+  }
+  (*env)->GetByteArrayRegion(env, array, offset, length, (jbyte *) buffer);
+  if ((*env)->ExceptionCheck(env)) {
+    free(buffer);
+    return NULL;
+  }
+  return buffer;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferContainer_seal(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray in, jint inOff, jint inputLength,
+    jint chunkSize, jbyteArray out, jint outOff) {
+  int outputLength = (int) aesmb_container_length(inputLength);
+  unsigned char * input = copyRange(env, in, inOff, inputLength);
+  if (NULL == input) {
+    return 0;
+  }
+  unsigned char * output = (unsigned char *) malloc(outputLength);
+  if (NULL == output) {
+    free(input);
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the buffer");
+    return 0;
+  }
+
+  int length = aesmb_container_seal((CipherContext*) context, input,
+      inputLength, chunkSize, output);
+  free(input);
+  if (length < 0) {
+    free(output);
+    THROW(env, "java/security/GeneralSecurityException", "Error in sealing the container");
+    return 0;
+  }
+  (*env)->SetByteArrayRegion(env, out, outOff, length, (jbyte *) output);
+  free(output);
+  return length;
+}
+
+/*
+ * Only the chunks of the range are decrypted, so the container is pinned
+ * read only for a bounded time and never written back.
+ */
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferContainer_open(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray in, jint inOff, jint inputLength,
+    jlong position, jint length, jbyteArray out, jint outOff) {
+  unsigned char * output = (unsigned char *) malloc(length > 0 ? length : 1);
+  if (NULL == output) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the buffer");
+    return 0;
+  }
+  unsigned char * input = (unsigned char *)
+      (*env)->GetPrimitiveArrayCritical(env, in, 0);
+  if (NULL == input) {
+    free(output);
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the java arrays");
+    return 0;
+  }
+
+  int result = aesmb_container_open((CipherContext*) context, input + inOff,
+      inputLength, position, length, output);
+
+  (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+  if (result < 0) {
+    free(output);
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Range outside of the container or damaged container");
+    return 0;
+  }
+  (*env)->SetByteArrayRegion(env, out, outOff, result, (jbyte *) output);
+  free(output);
+  return result;
+}
+
+/*
+ * Messages in the one-shot or the streaming format have no chunks and are
+ * decrypted as a whole.
+ */
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferContainer_openMessage(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray in, jint inOff, jint inputLength,
+    jbyteArray out, jint outOff) {
+  CipherContext* cipherContext = (CipherContext*) context;
+  int bound = aesmb_stream_final_bound(cipherContext, inputLength);
+  if (outOff + bound > (*env)->GetArrayLength(env, out)) {
+    THROW(env, "com/intel/diceros/crypto/OutputLengthException", "Output buffer too short");
+    return 0;
+  }
+  unsigned char * input = copyRange(env, in, inOff, inputLength);
+  if (NULL == input) {
+    return 0;
+  }
+  unsigned char * output = (unsigned char *) malloc(bound > 0 ? bound : 1);
+  if (NULL == output) {
+    free(input);
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the buffer");
+    return 0;
+  }
+
+  int length = aesmb_stream_final(cipherContext, input, inputLength, output);
+  free(input);
+  if (length < 0) {
+    free(output);
+    THROW(env, "javax/crypto/BadPaddingException", "Bad padding or corrupted data");
+    return 0;
+  }
+  (*env)->SetByteArrayRegion(env, out, outOff, length, (jbyte *) output);
+  free(output);
+  return length;
+}
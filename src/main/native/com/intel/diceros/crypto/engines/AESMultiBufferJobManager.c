@@ -0,0 +1,168 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "config.h"
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_crypto_engines_AESMultiBufferJobManager.h"
+#include "aes_mb_job_manager.h"
+#include "aes_dispatch.h"
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferJobManager_create(
+    JNIEnv *env, jclass clazz, jbyteArray key, jint keyLength, jint padding,
+    jlong flushTimeout) {
+  if (key != NULL) {
+    keyLength = (*env)->GetArrayLength(env, key);
+  }
+  if (keyLength != 32 && keyLength != 24 && keyLength != 16) {
+    THROW(env, "java/lang/IllegalArgumentException", "Illegal key size");
+    return 0;
+  }
+
+  // without a key every job brings its own
+  uint8_t nativeKey[32];
+  if (key != NULL) {
+    (*env)->GetByteArrayRegion(env, key, 0, keyLength, (jbyte *) nativeKey);
+  }
+
+  int result = 0;
+  AesMbJobManager* mgr = aesmb_mgr_create(key != NULL ? nativeKey : NULL,
+      keyLength, padding, flushTimeout, &result);
+  memset(nativeKey, 0, sizeof(nativeKey));
+  if (result == -1) {
+    char msg[1000];
+    snprintf(msg, 1000, "Cannot load %s (%s)!", HADOOP_AESMB_LIBRARY,
+        aesmb_dispatch()->loadError);
+    THROW(env, "java/lang/UnsatisfiedLinkError", msg);
+    return 0;
+  } else if (result == -3) {
+    THROW(env, "java/lang/UnsupportedOperationException",
+        "AES-NI is not supported by the CPU");
+    return 0;
+  } else if (result != 0) {
+    THROW(env, "java/lang/IllegalStateException",
+        "Cannot create the multi-buffer job manager");
+    return 0;
+  }
+
+  return (jlong) mgr;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferJobManager_destroy(
+    JNIEnv *env, jclass clazz, jlong manager) {
+  if (aesmb_mgr_destroy((AesMbJobManager*) manager) != 0) {
+    THROW(env, "java/lang/IllegalStateException",
+        "Job manager has jobs which are not awaited");
+  }
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferJobManager_submit(
+    JNIEnv *env, jclass clazz, jlong manager, jobject inputDirectBuffer,
+    jint start, jint inputLength, jobject outputDirectBuffer, jint begin,
+    jbyteArray iv, jbyteArray key) {
+  AesMbJobManager* mgr = (AesMbJobManager*) manager;
+  if (NULL == mgr) {
+    THROW(env, "java/lang/IllegalStateException", "Job manager is closed");
+    return 0;
+  }
+  if ((*env)->GetArrayLength(env, iv) != 16) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid iv length");
+    return 0;
+  }
+
+  unsigned char * input = (unsigned char *)
+      (*env)->GetDirectBufferAddress(env, inputDirectBuffer);
+  unsigned char * output = (unsigned char *)
+      (*env)->GetDirectBufferAddress(env, outputDirectBuffer);
+  if (NULL == input || NULL == output) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Multi-buffer jobs need direct buffers");
+    return 0;
+  }
+
+  AesMbJob* job = (AesMbJob*) malloc(sizeof(AesMbJob));
+  if (NULL == job) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the job");
+    return 0;
+  }
+  job->input = input + start;
+  job->output = output + begin;
+  job->inputLength = inputLength;
+  (*env)->GetByteArrayRegion(env, iv, 0, 16, (jbyte *) job->iv);
+  job->keysched = NULL;
+  if (key != NULL) {
+    int keyLength = (*env)->GetArrayLength(env, key);
+    uint8_t nativeKey[32];
+    int result = -1;
+    if (keyLength <= 32) {
+      (*env)->GetByteArrayRegion(env, key, 0, keyLength, (jbyte *) nativeKey);
+      result = aesmb_mgr_set_job_key(mgr, job, nativeKey, keyLength);
+      memset(nativeKey, 0, sizeof(nativeKey));
+    }
+    if (result != 0) {
+      free(job);
+      if (result == -2) {
+        THROW(env, "java/lang/UnsupportedOperationException",
+            "Per-job keys are not supported by the multi-buffer library");
+      } else {
+        THROW(env, "java/lang/IllegalArgumentException",
+            "The job key size differs from the manager key size");
+      }
+      return 0;
+    }
+  }
+
+  if (aesmb_mgr_submit(mgr, job) != 0) {
+    if (job->keysched != NULL) {
+      memset(job->keysched, 0, sizeof(job->keyschedStorage));
+    }
+    free(job);
+    THROW(env, "javax/crypto/IllegalBlockSizeException",
+        "Input length not multiple of 16 bytes");
+    return 0;
+  }
+
+  return (jlong) job;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferJobManager_waitFor(
+    JNIEnv *env, jclass clazz, jlong manager, jlong jobHandle) {
+  AesMbJob* job = (AesMbJob*) jobHandle;
+  if (0 == manager || NULL == job) {
+    THROW(env, "java/lang/IllegalStateException", "Job manager is closed");
+    return 0;
+  }
+  int outputLength = aesmb_mgr_wait((AesMbJobManager*) manager, job);
+  free(job);
+  if (outputLength < 0) {
+    THROW(env, "java/security/GeneralSecurityException",
+        "Multi-buffer job failed");
+    return 0;
+  }
+  return outputLength;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESMultiBufferJobManager_flush(
+    JNIEnv *env, jclass clazz, jlong manager) {
+  if (0 == manager) {
+    THROW(env, "java/lang/IllegalStateException", "Job manager is closed");
+    return;
+  }
+  aesmb_mgr_flush((AesMbJobManager*) manager);
+}
@@ -25,12 +25,14 @@
 #include "com_intel_diceros.h"
 #include "com_intel_diceros_crypto_engines_AESMutliBufferEngine.h"
 #include "aes_multibuffer.h"
+#include "aes_multibuffer_stream.h"
+#include "aes_dispatch.h"
 
 //-------- begin dlerror handling functions -----
 void throwDLError(JNIEnv* env, const char* lib)
 {
   char msg[1000];
-  snprintf(msg, 1000, "Cannot load %s (%s)!", lib, dlerror());
+  snprintf(msg, 1000, "Cannot load %s (%s)!", lib, aesmb_dispatch()->loadError);
   THROW(env, "java/lang/UnsatisfiedLinkError", msg);
 }
 //-------- end dlerror handling functions -----
@@ -63,7 +65,8 @@ JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESMutliBufferEngi
      throwDLError(env, HADOOP_CRYPTO_LIBRARY);
      return 0;
   } else if (loadLibraryResult == -2) {
-     traceDLError(HADOOP_AESMB_LIBRARY);
+     DTRACE("Cannot load %s (%s)!\n", HADOOP_AESMB_LIBRARY,
+         aesmb_dispatch()->loadError);
   }
 
   return ctx;
@@ -76,35 +79,91 @@ JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMutliBufferEngin
   return 0;
 }
 
+/*
+ * Throw for a failed update or final, a decryption failure is reported as bad
+ * padding.
+ */
+static void throwCryptError(JNIEnv *env, CipherContext* cipherContext) {
+  if (cipherContext->opensslCtx->encrypt == ENCRYPTION) {
+    THROW(env, "java/security/GeneralSecurityException", "Error in encryption");
+  } else {
+    THROW(env, "javax/crypto/BadPaddingException", "Bad padding or corrupted data");
+  }
+}
+
 /*
  * Class:     com_intel_diceros_crypto_engines_AESMutliBufferEngine
- * Method:    doFinal
+ * Method:    processByteBuffer
  */
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMutliBufferEngine_processByteBuffer(JNIEnv * env,
     jobject object, jlong context, jobject inputDirectBuffer, jint start, jint inputLength,
     jobject outputDirectBuffer, jint begin, jboolean isUpdate) {
   unsigned char * input = (unsigned char *)(*env)->GetDirectBufferAddress(env, inputDirectBuffer) + start;
   unsigned char * output = (unsigned char *)(*env)->GetDirectBufferAddress(env, outputDirectBuffer) + begin;
+  jlong outputCapacity = (*env)->GetDirectBufferCapacity(env, outputDirectBuffer) - begin;
 
   CipherContext* cipherContext = (CipherContext*) context;
-  int encrypt_length = bufferCrypt(cipherContext, input, inputLength, output);
-  reset(cipherContext, NULL, NULL);
-  return encrypt_length;
+  int bound = isUpdate ? aesmb_stream_update_bound(cipherContext, inputLength) :
+      aesmb_stream_final_bound(cipherContext, inputLength);
+  if (bound > outputCapacity) {
+    THROW(env, "javax/crypto/ShortBufferException", "Output buffer too short");
+    return 0;
+  }
+
+  int length = isUpdate ?
+      aesmb_stream_update(cipherContext, input, inputLength, output) :
+      aesmb_stream_final(cipherContext, input, inputLength, output);
+  if (length < 0) {
+    throwCryptError(env, cipherContext);
+    return 0;
+  }
+  return length;
 }
 
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMutliBufferEngine_processBlock(JNIEnv *env,
     jobject object, jlong context, jbyteArray in, jint inOff, jint inputLength, jbyteArray out, jint outOff) {
+  CipherContext* cipherContext = (CipherContext*) context;
+  if (inputLength == 0) {
+    return 0;
+  }
+  int bound = aesmb_stream_update_bound(cipherContext, inputLength);
+  if (NULL == out || outOff + bound > (*env)->GetArrayLength(env, out)) {
+    THROW(env, "com/intel/diceros/crypto/OutputLengthException", "Output buffer too short");
+    return 0;
+  }
+
   unsigned char * inputTmp = (unsigned char *) (*env)->GetByteArrayElements(env, in, 0);
   unsigned char * outputTmp = (unsigned char *) (*env)->GetByteArrayElements(env, out, 0);
-  unsigned char * input = inputTmp;
-  unsigned char * output = outputTmp;
 
+  int length = aesmb_stream_update(cipherContext, inputTmp + inOff, inputLength,
+      outputTmp + outOff);
+
+  (*env)->ReleaseByteArrayElements(env, in, (jbyte *) inputTmp, JNI_ABORT);
+  (*env)->ReleaseByteArrayElements(env, out, (jbyte *) outputTmp, 0);
+
+  if (length < 0) {
+    throwCryptError(env, cipherContext);
+    return 0;
+  }
+  return length;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESMutliBufferEngine_doFinal(JNIEnv *env,
+    jobject object, jlong context, jbyteArray out, jint outOff) {
   CipherContext* cipherContext = (CipherContext*) context;
-  int encrypt_length = bufferCrypt(cipherContext, input, inputLength, output);
+  int bound = aesmb_stream_final_bound(cipherContext, 0);
+  if (outOff + bound > (*env)->GetArrayLength(env, out)) {
+    THROW(env, "com/intel/diceros/crypto/OutputLengthException", "Output buffer too short");
+    return 0;
+  }
 
-  (*env)->ReleaseByteArrayElements(env, in, (jbyte *) inputTmp, 0);
+  unsigned char * outputTmp = (unsigned char *) (*env)->GetByteArrayElements(env, out, 0);
+  int length = aesmb_stream_final(cipherContext, NULL, 0, outputTmp + outOff);
   (*env)->ReleaseByteArrayElements(env, out, (jbyte *) outputTmp, 0);
 
-  reset(cipherContext, NULL, NULL);
-  return encrypt_length;
+  if (length < 0) {
+    throwCryptError(env, cipherContext);
+    return 0;
+  }
+  return length;
 }
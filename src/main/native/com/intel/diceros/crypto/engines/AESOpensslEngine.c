@@ -21,46 +21,63 @@
 #include <openssl/err.h>
 #include "com_intel_diceros.h"
 #include "aes_utils.h"
+#include "aes_openssl.h"
+#include "work_pool.h"
+#include "crc32c.h"
 #include "com_intel_diceros_crypto_engines_AESOpensslEngine.h"
 
+#ifndef AES_BLOCK_SIZE
+#define AES_BLOCK_SIZE 16
+#endif
+
+// max bytes processed per GetPrimitiveArrayCritical section
+#define CRITICAL_CHUNK_SIZE (256 * 1024)
+// input staged per piece when a GCM decryption runs in place
+#define GCM_STAGE_SIZE 4096
+
+// bytes encrypted and checksummed together while they are in L1
+#define FUSED_TILE_SIZE (8 * 1024)
+// checksums copied to the java array per SetIntArrayRegion call
+#define CHECKSUMS_PER_CHUNK 64
+
 CipherContext* preInitContext(JNIEnv *env, CipherContext* cipherCtx, jint mode,
     jbyteArray key, jbyteArray IV) {
+  CipherContext* created = NULL;
   if (cipherCtx != NULL) {
-    if (cipherCtx->opensslCtx != NULL && mode == MODE_CBC) {
+    if (mode == MODE_CBC) {
+      // the openssl context is inline, reset it in place
       EVP_CIPHER_CTX_cleanup(cipherCtx->opensslCtx);
-      free(cipherCtx->opensslCtx);
-      cipherCtx->opensslCtx = (EVP_CIPHER_CTX *) malloc(
-          sizeof(EVP_CIPHER_CTX));
       EVP_CIPHER_CTX_init(cipherCtx->opensslCtx);
     }
   } else {
-    cipherCtx = (CipherContext*)malloc(sizeof(CipherContext));
-    cipherCtx->opensslCtx = (EVP_CIPHER_CTX *) malloc(
-        sizeof(EVP_CIPHER_CTX));
-    EVP_CIPHER_CTX_init(cipherCtx->opensslCtx);
-    cipherCtx->key = NULL;
-    cipherCtx->keyLength = 0;
-    cipherCtx->iv = NULL;
-    cipherCtx->ivLength = 0;
-    cipherCtx->aesmbCtx = NULL;
+    cipherCtx = created = createCipherContext();
+    if (cipherCtx == NULL) {
+      return NULL;
+    }
   }
+  cipherCtx->tagBuffered = 0;
   int keyLength = (*env)->GetArrayLength(env, key);
   if (cipherCtx->key == NULL || cipherCtx->keyLength != keyLength) {
     cipherCtx->keyLength = keyLength;
-    if (cipherCtx->key != NULL) {
-      free(cipherCtx->key);
+    if (!resizeContextKey(cipherCtx, keyLength)) {
+      goto error;
     }
-    cipherCtx->key = (jbyte*) malloc(cipherCtx->keyLength);
   }
   int ivLength = (*env)->GetArrayLength(env, IV);
   if (cipherCtx->iv == NULL || cipherCtx->ivLength != ivLength) {
     cipherCtx->ivLength =  ivLength;
-    if (cipherCtx->iv != NULL) {
-      free(cipherCtx->iv);
+    if (!resizeContextIv(cipherCtx, ivLength)) {
+      goto error;
     }
-    cipherCtx->iv = (jbyte*) malloc(cipherCtx->ivLength);
   }
   return cipherCtx;
+
+error:
+  // a context owned by the java side stays valid and is resized next time
+  if (created != NULL) {
+    destroyCipherContext(created);
+  }
+  return NULL;
 }
 
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_destoryCipherContext(
@@ -75,6 +92,10 @@ JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_i
     jint mode, jint padding, jbyteArray IV, jlong cipherContext) {
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   cipherCtx = preInitContext(env, cipherCtx, mode, key, IV);
+  if (cipherCtx == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
 
   (*env)->GetByteArrayRegion(env, key, 0, cipherCtx->keyLength, cipherCtx->key);
   (*env)->GetByteArrayRegion(env, IV, 0, cipherCtx->ivLength, cipherCtx->iv);
@@ -97,24 +118,315 @@ JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_i
   return (long) cipherCtx;
 }
 
+/*
+ * Run cryptUpdateFunc over in[inOff, inOff + inLen) and write the result
+ * to out[outOff, ...) without copying the java arrays. The arrays are pinned
+ * with GetPrimitiveArrayCritical, at most CRITICAL_CHUNK_SIZE input bytes at
+ * a time, so that a single large update can not stall the GC for long.
+ *
+ * Returns 0 on success, -1 if the arrays could not be pinned and -2 if the
+ * openssl update failed. *outLength holds the number of bytes written.
+ */
+static int cryptUpdateArray(JNIEnv *env, EVP_CIPHER_CTX * ctx,
+    cryptUpdate cryptUpdateFunc, jbyteArray in, jint inOff, jint inLen,
+    jbyteArray out, jint outOff, int* outLength) {
+  *outLength = 0;
+  do {
+    int chunk = inLen > CRITICAL_CHUNK_SIZE ? CRITICAL_CHUNK_SIZE : inLen;
+    int chunkOutLength = 0;
+
+    unsigned char * input = (unsigned char *)
+        (*env)->GetPrimitiveArrayCritical(env, in, 0);
+    if (NULL == input) {
+      return -1;
+    }
+    unsigned char * output = NULL;
+    if (out != NULL) {
+      output = (unsigned char *) (*env)->GetPrimitiveArrayCritical(env, out, 0);
+      if (NULL == output) {
+        (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+        return -1;
+      }
+    }
+
+    int rc = cryptUpdateFunc(ctx, output == NULL ? NULL : output + outOff,
+        &chunkOutLength, input + inOff, chunk);
+
+    if (output != NULL) {
+      (*env)->ReleasePrimitiveArrayCritical(env, out, output, 0);
+    }
+    (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+    if (!rc) {
+      return -2;
+    }
+
+    inOff += chunk;
+    inLen -= chunk;
+    outOff += chunkOutLength;
+    *outLength += chunkOutLength;
+  } while (inLen > 0);
+
+  return 0;
+}
+
+/*
+ * GCM decryption with tag withholding: the last tagLength bytes seen so far
+ * may be the tag, so they stay in cipherCtx->tag until more input shows that
+ * they are ciphertext. For an update of inLen bytes, *fromTag is the number
+ * of buffered bytes to decrypt first and *fromInput the number of input bytes
+ * to decrypt after them, the rest of the input is buffered.
+ */
+static void gcmWithholdTag(CipherContext* cipherCtx, int inLen, int* fromTag,
+    int* fromInput) {
+  int release = cipherCtx->tagBuffered + inLen - cipherCtx->tagLength;
+  *fromTag = 0;
+  *fromInput = 0;
+  if (release > 0) {
+    *fromTag = release < cipherCtx->tagBuffered ? release : cipherCtx->tagBuffered;
+    *fromInput = release - *fromTag;
+  }
+}
+
+static void gcmKeepTag(CipherContext* cipherCtx, int fromTag,
+    const unsigned char* tail, int tailLength) {
+  memmove(cipherCtx->tag, cipherCtx->tag + fromTag,
+      cipherCtx->tagBuffered - fromTag);
+  cipherCtx->tagBuffered -= fromTag;
+  memcpy(cipherCtx->tag + cipherCtx->tagBuffered, tail, tailLength);
+  cipherCtx->tagBuffered += tailLength;
+}
+
+static int overlaps(jlong a, jlong aLength, jlong b, jlong bLength) {
+  return a < b + bLength && b < a + aLength;
+}
+
+/*
+ * The released tag bytes go to the output ahead of the input, so when the
+ * output overlaps the input, out[i] is written before in[i] is read. Here
+ * the input is staged in GCM_STAGE_SIZE pieces: the fromTag bytes not yet
+ * decrypted are carried at the front of the stage, and a piece of input is
+ * read before the output it lands on is written. GCM keeps the lengths, the
+ * output is fromTag + fromInput bytes.
+ */
+static int gcmDecryptStaged(CipherContext* cipherCtx, unsigned char* out,
+    const unsigned char* in, int fromTag, int fromInput) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  unsigned char stage[GCM_STAGE_SIZE + AES_BLOCK_SIZE];
+  int done = 0;
+  int length;
+
+  memcpy(stage, cipherCtx->tag, fromTag);
+  while (done < fromInput) {
+    int piece = fromInput - done < GCM_STAGE_SIZE ? fromInput - done :
+        GCM_STAGE_SIZE;
+    memcpy(stage + fromTag, in + done, piece);
+    if (!EVP_DecryptUpdate(ctx, out + done, &length, stage, piece)) {
+      return -2;
+    }
+    memmove(stage, stage + piece, fromTag);
+    done += piece;
+  }
+  if (!EVP_DecryptUpdate(ctx, out + done, &length, stage, fromTag)) {
+    return -2;
+  }
+  return 0;
+}
+
+/*
+ * Tag withholding decryption update for native memory, the output may
+ * overlap the input. Returns 0 on success and -2 if the openssl update
+ * failed.
+ */
+static int gcmDecryptUpdate(CipherContext* cipherCtx, unsigned char* out,
+    const unsigned char* in, int inLen, int* outLength) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  unsigned char tail[AES_BLOCK_SIZE];
+  int fromTag, fromInput;
+  int tagOutLength = 0;
+  int inputOutLength = 0;
+
+  gcmWithholdTag(cipherCtx, inLen, &fromTag, &fromInput);
+  // save the tail first, the output may overlap the input
+  memcpy(tail, in + fromInput, inLen - fromInput);
+  if (fromTag > 0 && fromInput > 0 && overlaps((jlong) in, inLen,
+      (jlong) out, fromTag + fromInput)) {
+    if (gcmDecryptStaged(cipherCtx, out, in, fromTag, fromInput) != 0) {
+      return -2;
+    }
+    gcmKeepTag(cipherCtx, fromTag, tail, inLen - fromInput);
+    *outLength = fromTag + fromInput;
+    return 0;
+  }
+  if (fromTag > 0 && !EVP_DecryptUpdate(ctx, out, &tagOutLength,
+      cipherCtx->tag, fromTag)) {
+    return -2;
+  }
+  if (fromInput > 0 && !EVP_DecryptUpdate(ctx, out + tagOutLength,
+      &inputOutLength, in, fromInput)) {
+    return -2;
+  }
+  gcmKeepTag(cipherCtx, fromTag, tail, inLen - fromInput);
+
+  *outLength = tagOutLength + inputOutLength;
+  return 0;
+}
+
+/*
+ * gcmDecryptStaged for an update in place in one java array, the pieces
+ * are copied in and out of the array.
+ */
+static int gcmDecryptStagedArray(JNIEnv *env, CipherContext* cipherCtx,
+    jbyteArray in, jint inOff, jbyteArray out, jint outOff, int fromTag,
+    int fromInput) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  unsigned char stage[GCM_STAGE_SIZE + AES_BLOCK_SIZE];
+  unsigned char plain[GCM_STAGE_SIZE + AES_BLOCK_SIZE];
+  int done = 0;
+  int length;
+
+  memcpy(stage, cipherCtx->tag, fromTag);
+  while (done < fromInput) {
+    int piece = fromInput - done < GCM_STAGE_SIZE ? fromInput - done :
+        GCM_STAGE_SIZE;
+    (*env)->GetByteArrayRegion(env, in, inOff + done, piece,
+        (jbyte *) stage + fromTag);
+    if (!EVP_DecryptUpdate(ctx, plain, &length, stage, piece)) {
+      return -2;
+    }
+    (*env)->SetByteArrayRegion(env, out, outOff + done, length,
+        (jbyte *) plain);
+    memmove(stage, stage + piece, fromTag);
+    done += piece;
+  }
+  if (!EVP_DecryptUpdate(ctx, plain, &length, stage, fromTag)) {
+    return -2;
+  }
+  (*env)->SetByteArrayRegion(env, out, outOff + done, length, (jbyte *) plain);
+  return 0;
+}
+
+/*
+ * Tag withholding decryption update for java arrays, the bulk of the input
+ * goes through cryptUpdateArray and only the at most 16 withheld bytes are
+ * copied, unless the output overlaps the input in the same array. Returns
+ * the same codes as cryptUpdateArray.
+ */
+static int gcmDecryptUpdateArray(JNIEnv *env, CipherContext* cipherCtx,
+    jbyteArray in, jint inOff, jint inLen, jbyteArray out, jint outOff,
+    int* outLength) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  unsigned char tail[AES_BLOCK_SIZE];
+  unsigned char released[AES_BLOCK_SIZE];
+  int fromTag, fromInput;
+  int tagOutLength = 0;
+  int inputOutLength = 0;
+
+  gcmWithholdTag(cipherCtx, inLen, &fromTag, &fromInput);
+  (*env)->GetByteArrayRegion(env, in, inOff + fromInput, inLen - fromInput,
+      (jbyte *) tail);
+  if (fromTag > 0 && fromInput > 0 && (*env)->IsSameObject(env, in, out)
+      && overlaps(inOff, inLen, outOff, fromTag + fromInput)) {
+    int rc = gcmDecryptStagedArray(env, cipherCtx, in, inOff, out, outOff,
+        fromTag, fromInput);
+    if (rc != 0) {
+      return rc;
+    }
+    gcmKeepTag(cipherCtx, fromTag, tail, inLen - fromInput);
+    *outLength = fromTag + fromInput;
+    return 0;
+  }
+  if (fromTag > 0) {
+    if (!EVP_DecryptUpdate(ctx, released, &tagOutLength, cipherCtx->tag,
+        fromTag)) {
+      return -2;
+    }
+    (*env)->SetByteArrayRegion(env, out, outOff, tagOutLength,
+        (jbyte *) released);
+  }
+  if (fromInput > 0) {
+    int rc = cryptUpdateArray(env, ctx, EVP_DecryptUpdate, in, inOff,
+        fromInput, out, outOff + tagOutLength, &inputOutLength);
+    if (rc != 0) {
+      return rc;
+    }
+  }
+  gcmKeepTag(cipherCtx, fromTag, tail, inLen - fromInput);
+
+  *outLength = tagOutLength + inputOutLength;
+  return 0;
+}
+
+/*
+ * Finish a GCM context which owns its tag: on encryption the tag is appended
+ * to the output, on decryption the withheld bytes are verified as the tag.
+ * Returns 0 on success or one of the CRYPT_ERROR_* codes.
+ */
+static int gcmFinalNative(CipherContext* cipherCtx, unsigned char* out,
+    int* outLength) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  if (ctx->encrypt == ENCRYPTION) {
+    if (!EVP_EncryptFinal_ex(ctx, out, outLength)) {
+      return CRYPT_ERROR_FINAL;
+    }
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, cipherCtx->tagLength,
+        out + *outLength);
+    *outLength += cipherCtx->tagLength;
+    return 0;
+  }
+
+  if (cipherCtx->tagBuffered != cipherCtx->tagLength) {
+    return CRYPT_ERROR_SHORT_INPUT;
+  }
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, cipherCtx->tagLength,
+      cipherCtx->tag);
+  cipherCtx->tagBuffered = 0;
+  if (!EVP_DecryptFinal_ex(ctx, out, outLength)) {
+    return CRYPT_ERROR_TAG;
+  }
+  return 0;
+}
+
+/*
+ * gcmFinalNative for the java side, returns 0 on success, otherwise an
+ * exception is pending.
+ */
+static int gcmFinal(JNIEnv *env, CipherContext* cipherCtx, unsigned char* out,
+    int* outLength) {
+  int rc = gcmFinalNative(cipherCtx, out, outLength);
+  if (rc == CRYPT_ERROR_FINAL) {
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in EVP_EncryptFinal_ex");
+    ERR_print_errors_fp(stderr);
+  } else if (rc == CRYPT_ERROR_SHORT_INPUT) {
+    THROW(env, "java/security/ProviderException", "input is too short");
+  } else if (rc == CRYPT_ERROR_TAG) {
+    THROW(env, "javax/crypto/AEADBadTagException", "Tag mismatch!");
+  }
+  return rc == 0 ? 0 : -1;
+}
+
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_processBlock(
     JNIEnv *env, jobject object, jlong cipherContext, jbyteArray in, jint inOff,
     jint inLen, jbyteArray out, jint outOff) {
-  unsigned char * input = (unsigned char *) (*env)->GetByteArrayElements(env,
-      in, 0);
-  unsigned char * output = (unsigned char *) (*env)->GetByteArrayElements(env,
-      out, 0);
-
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
 
   int outLength = 0;
 
-  cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(
-      ctx->encrypt == ENCRYPTION);
-
-  if (!cryptUpdateFunc(ctx, output + outOff, &outLength, input + inOff,
-      inLen)) {
+  int rc;
+  if (cipherCtx->tagLength > 0 && ctx->encrypt == DECRYPTION) {
+    rc = gcmDecryptUpdateArray(env, cipherCtx, in, inOff, inLen, out, outOff,
+        &outLength);
+  } else {
+    cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(
+        ctx->encrypt == ENCRYPTION);
+    rc = cryptUpdateArray(env, ctx, cryptUpdateFunc, in, inOff, inLen,
+        out, outOff, &outLength);
+  }
+  if (rc == -1) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the java arrays");
+    return 0;
+  } else if (rc != 0) {
     fprintf(stderr, "inLen: %d, outLen: %d\n", inLen, outLength);
     THROW(env, "java/security/GeneralSecurityException",
         "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
@@ -122,22 +434,25 @@ JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_pr
     return 0;
   }
 
-  (*env)->ReleaseByteArrayElements(env, in, (jbyte *) input, 0);
-  (*env)->ReleaseByteArrayElements(env, out, (jbyte *) output, 0);
-
   return outLength;
 }
 
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_doFinal(
     JNIEnv *env, jobject object, jlong cipherContext, jbyteArray out, jint outOff) {
-  unsigned char * output = (unsigned char *) (*env)->GetByteArrayElements(env,
-      out, 0);
+  // the final call produces at most one block (plus the GCM tag), so stage
+  // it on the stack and copy only that region back instead of pinning the
+  // whole output array
+  unsigned char output[2 * AES_BLOCK_SIZE];
 
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
   cryptFinal cryptFinalFunc = getCryptFinalFunc(ctx->encrypt == ENCRYPTION);
   int outLength = 0;
-  if (!cryptFinalFunc(ctx, (unsigned char *) output + outOff, &outLength)) {
+  if (cipherCtx->tagLength > 0) {
+    if (gcmFinal(env, cipherCtx, output, &outLength) != 0) {
+      return 0;
+    }
+  } else if (!cryptFinalFunc(ctx, output, &outLength)) {
     THROW(env, "javax/crypto/IllegalBlockSizeException",
         "Input length not multiple of 16 bytes");
     //THROW(env, "java/security/GeneralSecurityException",
@@ -146,10 +461,131 @@ JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_do
     return 0;
   }
 
-  (*env)->ReleaseByteArrayElements(env, out, (jbyte *) output, 0);
+  if (outLength > 0) {
+    (*env)->SetByteArrayRegion(env, out, outOff, outLength, (jbyte *) output);
+  }
   return outLength;
 }
 
+/*
+ * Add blocks to a CTR counter block, as a 128 bit big endian number.
+ */
+static void addCounter(unsigned char * counter, uint64_t blocks) {
+  int i;
+  for (i = AES_BLOCK_SIZE - 1; i >= 0 && blocks != 0; i--) {
+    blocks += counter[i];
+    counter[i] = (unsigned char) blocks;
+    blocks >>= 8;
+  }
+}
+
+/*
+ * A CTR update split over the worker pool: chunk k starts at counter
+ * + k * chunkSize / 16 and runs on its own copy of the keyed context.
+ */
+typedef struct _CtrJob {
+  EVP_CIPHER_CTX * ctx;
+  const unsigned char * input;
+  unsigned char * output;
+  int length;
+  int chunkSize;
+  unsigned char counter[AES_BLOCK_SIZE];
+} CtrJob;
+
+static int ctrProcessChunk(void* arg, int index) {
+  CtrJob* job = (CtrJob*) arg;
+  int offset = index * job->chunkSize;
+  int length = job->length - offset < job->chunkSize ? job->length - offset :
+      job->chunkSize;
+  int forEncryption = job->ctx->encrypt == ENCRYPTION;
+  unsigned char counter[AES_BLOCK_SIZE];
+  EVP_CIPHER_CTX chunkCtx;
+  int outLength = 0;
+
+  memcpy(counter, job->counter, AES_BLOCK_SIZE);
+  addCounter(counter, offset / AES_BLOCK_SIZE);
+  EVP_CIPHER_CTX_init(&chunkCtx);
+  int ok = EVP_CIPHER_CTX_copy(&chunkCtx, job->ctx)
+      && getCryptInitFunc(forEncryption)(&chunkCtx, NULL, NULL, NULL, counter)
+      && getCryptUpdateFunc(forEncryption)(&chunkCtx, job->output + offset,
+          &outLength, job->input + offset, length);
+  EVP_CIPHER_CTX_cleanup(&chunkCtx);
+  return ok ? 0 : -1;
+}
+
+/*
+ * Run the whole blocks of a large CTR update on the worker pool and move
+ * ctx past them. Returns the bytes processed, 0 if the update is too small
+ * or the context is inside a keystream block, or -1 on error.
+ */
+static int ctrParallelUpdate(EVP_CIPHER_CTX * ctx, unsigned char * output,
+    const unsigned char * input, int length) {
+  if (EVP_CIPHER_CTX_mode(ctx) != EVP_CIPH_CTR_MODE || ctx->num != 0) {
+    return 0;
+  }
+  int chunkSize = work_pool_chunk_size(length);
+  if (chunkSize == 0) {
+    return 0;
+  }
+
+  CtrJob job;
+  job.ctx = ctx;
+  job.input = input;
+  job.output = output;
+  job.length = length - length % AES_BLOCK_SIZE;
+  job.chunkSize = chunkSize;
+  memcpy(job.counter, ctx->iv, AES_BLOCK_SIZE);
+  if (work_pool_run(ctrProcessChunk, &job,
+      (job.length + chunkSize - 1) / chunkSize) != 0) {
+    return -1;
+  }
+
+  addCounter(job.counter, job.length / AES_BLOCK_SIZE);
+  if (!getCryptInitFunc(ctx->encrypt == ENCRYPTION)(ctx, NULL, NULL, NULL,
+      job.counter)) {
+    return -1;
+  }
+  return job.length;
+}
+
+int opensslProcess(CipherContext* cipherCtx, unsigned char* output,
+    const unsigned char* input, int inputLength, int isFinal) {
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+
+  cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(
+      ctx->encrypt == ENCRYPTION);
+  cryptFinal cryptFinalFunc = getCryptFinalFunc(ctx->encrypt == ENCRYPTION);
+
+  int outLenUpdate = 0;
+  int outLengthFinal = 0;
+
+  int rc;
+  if (cipherCtx->tagLength > 0 && ctx->encrypt == DECRYPTION) {
+    rc = gcmDecryptUpdate(cipherCtx, output, input, inputLength,
+        &outLenUpdate);
+  } else {
+    // large CTR updates are split over the worker pool, if it is enabled
+    int parallel = ctrParallelUpdate(ctx, output, input, inputLength);
+    rc = parallel < 0 || !cryptUpdateFunc(ctx, output + parallel,
+        &outLenUpdate, input + parallel, inputLength - parallel) ? -2 : 0;
+    outLenUpdate += parallel;
+  }
+  if (rc != 0) {
+    return CRYPT_ERROR_UPDATE;
+  }
+  if (isFinal && cipherCtx->tagLength > 0) {
+    rc = gcmFinalNative(cipherCtx, output + outLenUpdate, &outLengthFinal);
+    if (rc != 0) {
+      return rc;
+    }
+  } else if (isFinal) {
+    if (!cryptFinalFunc(ctx, output + outLenUpdate, &outLengthFinal)) {
+      return CRYPT_ERROR_FINAL;
+    }
+  }
+  return outLenUpdate + outLengthFinal;
+}
+
 JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_processByteBuffer(
     JNIEnv *env, jobject object, jlong cipherContext, jobject input,
     jint inputPos, jint inputLimit, jobject output, jint outputPos,
@@ -160,84 +596,444 @@ JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_pr
   if (NULL == bInput || NULL == bOutput) {
     return 0;
   }
-  //EVP_CIPHER_CTX_set_padding(context, 0);
+  CipherContext* cipherCtx = (CipherContext*) cipherContext;
+  int rc = opensslProcess(cipherCtx, (unsigned char *) bOutput + outputPos,
+      (const unsigned char *) bInput + inputPos, inputLimit - inputPos,
+      isUpdate == JNI_FALSE);
+  if (rc >= 0) {
+    return rc;
+  }
+  if (rc == CRYPT_ERROR_UPDATE) {
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
+    ERR_print_errors_fp(stderr);
+  } else if (rc == CRYPT_ERROR_FINAL && cipherCtx->tagLength > 0) {
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in EVP_EncryptFinal_ex");
+    ERR_print_errors_fp(stderr);
+  } else if (rc == CRYPT_ERROR_FINAL) {
+    //THROW(env, "javax/crypto/IllegalBlockSizeException",
+    //               "Input length not multiple of 16 bytes...");
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in EVP_EncryptFinal_ex or EVP_DecryptFinal_ex");
+    ERR_print_errors_fp(stderr);
+  } else if (rc == CRYPT_ERROR_SHORT_INPUT) {
+    THROW(env, "java/security/ProviderException", "input is too short");
+  } else {
+    THROW(env, "javax/crypto/AEADBadTagException", "Tag mismatch!");
+  }
+  return 0;
+}
+
+/*
+ * CTR encrypt or decrypt length bytes and compute the CRC32C of every
+ * bytesPerChecksum bytes of the ciphertext in the same pass: each tile is
+ * checksummed right before (decryption) or after (encryption) it is
+ * processed, while it is still in L1. Decrypting in place works as the
+ * ciphertext is checksummed first. Returns 0 or -1 on an openssl error.
+ */
+static int ctrCrc32c(EVP_CIPHER_CTX * ctx, unsigned char * output,
+    const unsigned char * input, int length, int bytesPerChecksum,
+    jint * checksums) {
+  int encrypt = ctx->encrypt == ENCRYPTION;
+  cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(encrypt);
+  int done = 0;
+  while (done < length) {
+    int chunk = length - done < bytesPerChecksum ? length - done :
+        bytesPerChecksum;
+    uint32_t crc = 0;
+    int offset = 0;
+    while (offset < chunk) {
+      int tile = chunk - offset < FUSED_TILE_SIZE ? chunk - offset :
+          FUSED_TILE_SIZE;
+      int outLength;
+      if (!encrypt) {
+        crc = crc32c_update(crc, input + done + offset, tile);
+      }
+      if (!cryptUpdateFunc(ctx, output + done + offset, &outLength,
+          input + done + offset, tile)) {
+        return -1;
+      }
+      if (encrypt) {
+        crc = crc32c_update(crc, output + done + offset, tile);
+      }
+      offset += tile;
+    }
+    *checksums++ = (jint) crc;
+    done += chunk;
+  }
+  return 0;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_processChecksummed(
+    JNIEnv *env, jobject object, jlong cipherContext, jobject input,
+    jint inputPos, jint inputLength, jobject output, jint outputPos,
+    jint bytesPerChecksum, jintArray checksums, jint checksumOff) {
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+  unsigned char * bInput = (*env)->GetDirectBufferAddress(env, input);
+  unsigned char * bOutput = (*env)->GetDirectBufferAddress(env, output);
+  jint sums[CHECKSUMS_PER_CHUNK];
 
-  cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(
-      ctx->encrypt == ENCRYPTION);
-  cryptFinal cryptFinalFunc = getCryptFinalFunc(ctx->encrypt == ENCRYPTION);
+  if (NULL == bInput || NULL == bOutput) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Checksummed processing needs direct buffers");
+    return 0;
+  }
+  if (EVP_CIPHER_CTX_mode(ctx) != EVP_CIPH_CTR_MODE) {
+    THROW(env, "java/lang/UnsupportedOperationException",
+        "Checksummed processing needs CTR mode");
+    return 0;
+  }
+  if (bytesPerChecksum <= 0) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Invalid bytes per checksum");
+    return 0;
+  }
+  jlong total = ((jlong) inputLength + bytesPerChecksum - 1) / bytesPerChecksum;
+  if (inputPos < 0 || inputLength < 0 || outputPos < 0 || checksumOff < 0
+      || (jlong) inputPos + inputLength
+          > (*env)->GetDirectBufferCapacity(env, input)
+      || (jlong) outputPos + inputLength
+          > (*env)->GetDirectBufferCapacity(env, output)
+      || checksumOff + total > (*env)->GetArrayLength(env, checksums)) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Checksummed range out of the buffer or array bounds");
+    return 0;
+  }
 
-  int outLenUpdate = 0;
-  int outLengthFinal = 0;
-  int inputLength = inputLimit - inputPos;
+  // a batch of checksums per SetIntArrayRegion call
+  jlong batch = (jlong) CHECKSUMS_PER_CHUNK * bytesPerChecksum;
+  int done = 0;
+  while (done < inputLength) {
+    int length = inputLength - done < batch ? inputLength - done : (int) batch;
+    int count = (int) (((jlong) length + bytesPerChecksum - 1)
+        / bytesPerChecksum);
+    if (ctrCrc32c(ctx, bOutput + outputPos + done, bInput + inputPos + done,
+        length, bytesPerChecksum, sums) != 0) {
+      THROW(env, "java/security/GeneralSecurityException",
+          "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
+      ERR_print_errors_fp(stderr);
+      return 0;
+    }
+    (*env)->SetIntArrayRegion(env, checksums, checksumOff, count, sums);
+    checksumOff += count;
+    done += length;
+  }
+  return inputLength;
+}
+
+/*
+ * Position a CTR context at an absolute byte offset of the stream started
+ * with the IV given at init: the counter becomes IV + position / 16 (as a
+ * 128 bit big endian add) and only the IV is reloaded, the key schedule is
+ * kept. For an offset inside a block, one block of keystream is generated
+ * and the first position % 16 bytes of it are skipped.
+ */
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_seek(
+    JNIEnv *env, jobject object, jlong cipherContext, jlong position) {
+  CipherContext* cipherCtx = (CipherContext*) cipherContext;
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
 
-  if (!cryptUpdateFunc(ctx, (unsigned char *) bOutput + outputPos,
-      &outLenUpdate, (const unsigned char *) bInput + inputPos,
-      inputLength)) {
+  if (position < 0 || cipherCtx->ivLength != AES_BLOCK_SIZE) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid seek position");
+    return;
+  }
+
+  unsigned char counter[AES_BLOCK_SIZE];
+  memcpy(counter, cipherCtx->iv, AES_BLOCK_SIZE);
+  addCounter(counter, (uint64_t) position / AES_BLOCK_SIZE);
+
+  int forEncryption = ctx->encrypt == ENCRYPTION;
+  cryptInit cryptInitFunc = getCryptInitFunc(forEncryption);
+  if (!cryptInitFunc(ctx, NULL, NULL, NULL, counter)) {
     THROW(env, "java/security/GeneralSecurityException",
-        "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
-    ERR_print_errors_fp(stderr);
+        "Error in EVP_EncryptInit_ex or EVP_DecryptInit_ex");
+    return;
+  }
+
+  int skip = (int) (position % AES_BLOCK_SIZE);
+  if (skip > 0) {
+    unsigned char discard[AES_BLOCK_SIZE] = { 0 };
+    int outLength = 0;
+    cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(forEncryption);
+    if (!cryptUpdateFunc(ctx, discard, &outLength, discard, skip)) {
+      THROW(env, "java/security/GeneralSecurityException",
+          "Error in EVP_EncryptUpdate or EVP_DecryptUpdate");
+    }
+  }
+}
+
+/*
+ * XTS over a run of data units: unit i is processed with the tweak of sector
+ * startSector + i, encoded as a 128 bit little endian number. Only the IV of
+ * the context is reloaded per unit. The last unit may be shorter than
+ * unitSize, but every unit must hold at least one block.
+ *
+ * Returns the number of bytes processed, or -1 on error.
+ */
+static int xtsProcessUnits(EVP_CIPHER_CTX * ctx, const unsigned char * input,
+    unsigned char * output, int length, int unitSize, uint64_t startSector) {
+  int forEncryption = ctx->encrypt == ENCRYPTION;
+  cryptInit cryptInitFunc = getCryptInitFunc(forEncryption);
+  cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(forEncryption);
+  unsigned char tweak[AES_BLOCK_SIZE];
+  int processed = 0;
+
+  while (processed < length) {
+    int unit = length - processed < unitSize ? length - processed : unitSize;
+    if (unit < AES_BLOCK_SIZE) {
+      return -1;
+    }
+
+    uint64_t sector = startSector++;
+    int i;
+    for (i = 0; i < 8; i++) {
+      tweak[i] = (unsigned char) (sector >> (8 * i));
+    }
+    memset(tweak + 8, 0, AES_BLOCK_SIZE - 8);
+
+    int outLength = 0;
+    if (!cryptInitFunc(ctx, NULL, NULL, NULL, tweak)
+        || !cryptUpdateFunc(ctx, output + processed, &outLength,
+            input + processed, unit)) {
+      return -1;
+    }
+    processed += unit;
+  }
+
+  return processed;
+}
+
+/*
+ * XTS data units split over the worker pool, each chunk of whole units runs
+ * on its own copy of the keyed context.
+ */
+typedef struct _XtsJob {
+  EVP_CIPHER_CTX * ctx;
+  const unsigned char * input;
+  unsigned char * output;
+  int length;
+  int unitSize;
+  int unitsPerChunk;
+  uint64_t startSector;
+} XtsJob;
+
+static int xtsProcessChunk(void* arg, int index) {
+  XtsJob* job = (XtsJob*) arg;
+  int offset = index * job->unitsPerChunk * job->unitSize;
+  int length = job->length - offset;
+  EVP_CIPHER_CTX chunkCtx;
+
+  if (length > job->unitsPerChunk * job->unitSize) {
+    length = job->unitsPerChunk * job->unitSize;
+  }
+  EVP_CIPHER_CTX_init(&chunkCtx);
+  int rc = EVP_CIPHER_CTX_copy(&chunkCtx, job->ctx) ? xtsProcessUnits(
+      &chunkCtx, job->input + offset, job->output + offset, length,
+      job->unitSize, job->startSector + (uint64_t) index * job->unitsPerChunk)
+      : -1;
+  EVP_CIPHER_CTX_cleanup(&chunkCtx);
+  return rc < 0 ? -1 : 0;
+}
+
+/*
+ * xtsProcessUnits on the worker pool when the run is large enough, a single
+ * data unit is one XTS message and is never split.
+ */
+static int xtsParallelUnits(EVP_CIPHER_CTX * ctx, const unsigned char * input,
+    unsigned char * output, int length, int unitSize, uint64_t startSector) {
+  int chunkSize = work_pool_chunk_size(length);
+  if (chunkSize == 0 || length / unitSize < 2) {
+    return xtsProcessUnits(ctx, input, output, length, unitSize, startSector);
+  }
+
+  XtsJob job;
+  job.ctx = ctx;
+  job.input = input;
+  job.output = output;
+  job.length = length;
+  job.unitSize = unitSize;
+  job.unitsPerChunk = chunkSize / unitSize > 0 ? chunkSize / unitSize : 1;
+  job.startSector = startSector;
+  int units = (length + unitSize - 1) / unitSize;
+  if (work_pool_run(xtsProcessChunk, &job,
+      (units + job.unitsPerChunk - 1) / job.unitsPerChunk) != 0) {
+    return -1;
+  }
+  return length;
+}
+
+/*
+ * Returns 1 if the data unit size is a positive multiple of the block size
+ * and [inOff, inOff + inLen) and [outOff, outOff + inLen) lie within inSize
+ * and outSize bytes, otherwise throws IllegalArgumentException.
+ */
+static int checkSectors(JNIEnv *env, jlong inSize, jint inOff, jint inLen,
+    jlong outSize, jint outOff, jint unitSize) {
+  if (unitSize < AES_BLOCK_SIZE || unitSize % AES_BLOCK_SIZE != 0) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid data unit size");
     return 0;
   }
-  if (isUpdate == JNI_FALSE) {
-    if (!cryptFinalFunc(ctx,
-        (unsigned char *) bOutput + outputPos + outLenUpdate,
-        &outLengthFinal)) {
-      //THROW(env, "javax/crypto/IllegalBlockSizeException",
-      //               "Input length not multiple of 16 bytes...");
+  if (inOff < 0 || inLen < 0 || outOff < 0
+      || (jlong) inOff + inLen > inSize || (jlong) outOff + inLen > outSize) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Data units out of the buffer bounds");
+    return 0;
+  }
+  return 1;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_processSectors(
+    JNIEnv *env, jobject object, jlong cipherContext, jbyteArray in, jint inOff,
+    jint inLen, jbyteArray out, jint outOff, jint unitSize, jlong startSector) {
+  CipherContext* cipherCtx = (CipherContext*) cipherContext;
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+
+  if (!checkSectors(env, (*env)->GetArrayLength(env, in), inOff, inLen,
+      (*env)->GetArrayLength(env, out), outOff, unitSize)) {
+    return 0;
+  }
+
+  // pin whole data units only, at most about CRITICAL_CHUNK_SIZE at a time.
+  // A run the worker pool takes is pinned at once instead: the workers make
+  // no JNI calls and shorten the pinned time by the parallelism.
+  int unitsPerChunk = CRITICAL_CHUNK_SIZE / unitSize;
+  if (work_pool_chunk_size(inLen) > 0) {
+    unitsPerChunk = inLen / unitSize + 1;
+  }
+  if (unitsPerChunk == 0) {
+    unitsPerChunk = 1;
+  }
+
+  int processed = 0;
+  while (processed < inLen) {
+    int chunk = inLen - processed;
+    if (chunk / unitSize > unitsPerChunk) {
+      chunk = unitsPerChunk * unitSize;
+    }
+
+    unsigned char * input = (unsigned char *)
+        (*env)->GetPrimitiveArrayCritical(env, in, 0);
+    if (NULL == input) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the java arrays");
+      return 0;
+    }
+    unsigned char * output = (unsigned char *)
+        (*env)->GetPrimitiveArrayCritical(env, out, 0);
+    if (NULL == output) {
+      (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the java arrays");
+      return 0;
+    }
+
+    int rc = xtsParallelUnits(ctx, input + inOff + processed,
+        output + outOff + processed, chunk, unitSize,
+        (uint64_t) startSector + processed / unitSize);
+
+    (*env)->ReleasePrimitiveArrayCritical(env, out, output, 0);
+    (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+    if (rc < 0) {
       THROW(env, "java/security/GeneralSecurityException",
-          "Error in EVP_EncryptFinal_ex or EVP_DecryptFinal_ex");
+          "Error in XTS data unit processing");
       ERR_print_errors_fp(stderr);
       return 0;
     }
+    processed += chunk;
   }
-  return outLenUpdate + outLengthFinal;
+
+  return processed;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_processSectorsByteBuffer(
+    JNIEnv *env, jobject object, jlong cipherContext, jobject in, jint inputPos,
+    jint inLen, jobject out, jint outputPos, jint unitSize, jlong startSector) {
+  CipherContext* cipherCtx = (CipherContext*) cipherContext;
+  EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
+
+  unsigned char * input = (unsigned char *) (*env)->GetDirectBufferAddress(env, in);
+  unsigned char * output = (unsigned char *) (*env)->GetDirectBufferAddress(env, out);
+  if (NULL == input || NULL == output) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Only direct buffers are supported");
+    return 0;
+  }
+  if (!checkSectors(env, (*env)->GetDirectBufferCapacity(env, in), inputPos,
+      inLen, (*env)->GetDirectBufferCapacity(env, out), outputPos, unitSize)) {
+    return 0;
+  }
+
+  int rc = xtsParallelUnits(ctx, input + inputPos, output + outputPos, inLen,
+      unitSize, (uint64_t) startSector);
+  if (rc < 0) {
+    THROW(env, "java/security/GeneralSecurityException",
+        "Error in XTS data unit processing");
+    ERR_print_errors_fp(stderr);
+    return 0;
+  }
+  return rc;
 }
 
 JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_setTag(
     JNIEnv *env, jobject object, jlong cipherContext, jbyteArray tag, jint tagOff, jint tLen) {
-  unsigned char * input = (unsigned char *) (*env)->GetByteArrayElements(env,
-      tag, 0);
+  unsigned char input[AES_BLOCK_SIZE];
+  if (tLen < 0 || tLen > AES_BLOCK_SIZE) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid tag length");
+    return;
+  }
+  (*env)->GetByteArrayRegion(env, tag, tagOff, tLen, (jbyte *) input);
+  PASS_EXCEPTIONS(env);
 
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
 
-  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, tLen, input + tagOff);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, tLen, input);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_setTagLen(
+    JNIEnv *env, jobject object, jlong cipherContext, jint tLen) {
+  if (tLen < 0 || tLen > AES_BLOCK_SIZE) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid tag length");
+    return;
+  }
 
-  (*env)->ReleaseByteArrayElements(env, tag, (jbyte *) input, 0);
+  CipherContext* cipherCtx = (CipherContext*) cipherContext;
+  cipherCtx->tagLength = tLen;
+  cipherCtx->tagBuffered = 0;
 }
 
 JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_getTag(
     JNIEnv *env, jobject object, jlong cipherContext, jbyteArray out, jint outOff, jint tLen) {
-  unsigned char * tagOut = (unsigned char *) (*env)->GetByteArrayElements(env,
-        out, 0);
+  unsigned char tagOut[AES_BLOCK_SIZE];
+  if (tLen < 0 || tLen > AES_BLOCK_SIZE) {
+    THROW(env, "java/lang/IllegalArgumentException", "Invalid tag length");
+    return;
+  }
 
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
 
-  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tLen, tagOut + outOff);
+  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tLen, tagOut);
 
-  (*env)->ReleaseByteArrayElements(env, out, (jbyte *) tagOut, 0);
+  (*env)->SetByteArrayRegion(env, out, outOff, tLen, (jbyte *) tagOut);
 }
 
 JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_updateAADFromByteArray(
     JNIEnv *env, jobject object, jlong cipherContext, jbyteArray src, jint offset, jint len) {
-  unsigned char * aad = (unsigned char *) (*env)->GetByteArrayElements(env,
-      src, 0);
-
   CipherContext* cipherCtx = (CipherContext*) cipherContext;
   EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *) cipherCtx->opensslCtx;
 
   int outlen;
   cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(
         ctx->encrypt == ENCRYPTION);
-  if (!cryptUpdateFunc(ctx, NULL, &outlen, aad + offset, len)) {
+  int rc = cryptUpdateArray(env, ctx, cryptUpdateFunc, src, offset, len,
+      NULL, 0, &outlen);
+  if (rc == -1) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the java arrays");
+  } else if (rc != 0) {
     THROW(env, "java/security/GeneralSecurityException",
             "Error in updateAAD");
   }
-
-  (*env)->ReleaseByteArrayElements(env, src, (jbyte *) aad, 0);
 }
 
 JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AESOpensslEngine_updateAADFromByteBuffer(
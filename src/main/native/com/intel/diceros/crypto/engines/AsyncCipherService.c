@@ -0,0 +1,153 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include "com_intel_diceros.h"
+#include "aes_async.h"
+#include "com_intel_diceros_crypto_engines_AsyncCipherService.h"
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_create(
+    JNIEnv *env, jclass clazz, jint threads) {
+  AsyncQueue* queue = async_queue_create(threads);
+  if (NULL == queue) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot start the worker threads");
+    return 0;
+  }
+  return (jlong) queue;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_shutdown(
+    JNIEnv *env, jclass clazz, jlong queue) {
+  async_queue_shutdown((AsyncQueue*) queue);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_destroy(
+    JNIEnv *env, jclass clazz, jlong queue) {
+  async_queue_destroy((AsyncQueue*) queue);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_openSession(
+    JNIEnv *env, jclass clazz, jlong queue, jlong context) {
+  AsyncSession* session = async_session_create((AsyncQueue*) queue,
+      (CipherContext*) context);
+  if (NULL == session) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the session");
+    return 0;
+  }
+  return (jlong) session;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_closeSession(
+    JNIEnv *env, jclass clazz, jlong queue, jlong session) {
+  async_session_destroy((AsyncSession*) session);
+}
+
+static void freeJobs(AsyncJob** jobs, int count) {
+  int i;
+  for (i = 0; i < count; i++) {
+    free(jobs[i]);
+  }
+  free(jobs);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_submit(
+    JNIEnv *env, jclass clazz, jlong queue, jlong session, jlongArray ids,
+    jobjectArray inputs, jobjectArray outputs, jintArray ranges,
+    jbooleanArray isFinal, jint count) {
+  AsyncJob** jobs = (AsyncJob**) calloc(count > 0 ? count : 1,
+      sizeof(AsyncJob*));
+  jlong* jobIds = (*env)->GetLongArrayElements(env, ids, NULL);
+  jint* range = (*env)->GetIntArrayElements(env, ranges, NULL);
+  jboolean* final = (*env)->GetBooleanArrayElements(env, isFinal, NULL);
+  int built = 0;
+  int queued = -1;
+
+  if (NULL == jobs || NULL == jobIds || NULL == range || NULL == final) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the jobs");
+    goto cleanup;
+  }
+  for (built = 0; built < count; built++) {
+    jobject input = (*env)->GetObjectArrayElement(env, inputs, built);
+    jobject output = (*env)->GetObjectArrayElement(env, outputs, built);
+    uint8_t* in = (uint8_t*) (*env)->GetDirectBufferAddress(env, input);
+    uint8_t* out = (uint8_t*) (*env)->GetDirectBufferAddress(env, output);
+    (*env)->DeleteLocalRef(env, input);
+    (*env)->DeleteLocalRef(env, output);
+    if (NULL == in || NULL == out) {
+      THROW(env, "java/lang/IllegalArgumentException",
+          "Only direct buffers are supported");
+      goto cleanup;
+    }
+    AsyncJob* job = (AsyncJob*) calloc(1, sizeof(AsyncJob));
+    if (NULL == job) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the jobs");
+      goto cleanup;
+    }
+    job->id = jobIds[built];
+    job->input = in + range[3 * built];
+    job->inputLength = range[3 * built + 1];
+    job->output = out + range[3 * built + 2];
+    job->isFinal = final[built];
+    jobs[built] = job;
+  }
+  queued = async_submit((AsyncSession*) session, jobs, count);
+
+cleanup:
+  if (NULL != final) {
+    (*env)->ReleaseBooleanArrayElements(env, isFinal, final, JNI_ABORT);
+  }
+  if (NULL != range) {
+    (*env)->ReleaseIntArrayElements(env, ranges, range, JNI_ABORT);
+  }
+  if (NULL != jobIds) {
+    (*env)->ReleaseLongArrayElements(env, ids, jobIds, JNI_ABORT);
+  }
+  if (queued == 0) {
+    // the queue owns the jobs now
+    free(jobs);
+  } else if (NULL != jobs) {
+    freeJobs(jobs, built);
+  }
+  return queued == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_AsyncCipherService_poll(
+    JNIEnv *env, jclass clazz, jlong queue, jlongArray ids, jintArray results) {
+  int max = (*env)->GetArrayLength(env, ids);
+  AsyncJob* done[64];
+  jlong doneIds[64];
+  jint doneResults[64];
+  int i;
+
+  if (max > 64) {
+    max = 64;
+  }
+  // blocks without holding any JVM resource
+  int count = async_queue_poll((AsyncQueue*) queue, done, max);
+  if (count < 0) {
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    doneIds[i] = done[i]->id;
+    doneResults[i] = done[i]->result;
+    free(done[i]);
+  }
+  (*env)->SetLongArrayRegion(env, ids, 0, count, doneIds);
+  (*env)->SetIntArrayRegion(env, results, 0, count, doneResults);
+  return count;
+}
@@ -0,0 +1,60 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_crypto_engines_KernelDispatch.h"
+#include "aes_dispatch.h"
+#include "cpu_features.h"
+
+/*
+ * Probe the CPU and bind the kernels while the library is loaded, so that
+ * no cipher init pays for it.
+ */
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+  aesmb_dispatch();
+  return JNI_VERSION_1_6;
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_KernelDispatch_getCpuFeatures(
+    JNIEnv *env, jclass clazz) {
+  return cpu_features();
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_KernelDispatch_getLanes(
+    JNIEnv *env, jclass clazz) {
+  return aesmb_dispatch()->lanes;
+}
+
+JNIEXPORT jstring JNICALL Java_com_intel_diceros_crypto_engines_KernelDispatch_getKernelName(
+    JNIEnv *env, jclass clazz, jint mode, jboolean forEncryption, jint keyLength) {
+  const char* name = aesmb_kernel_name(mode, forEncryption, keyLength);
+  if (NULL == name) {
+    return NULL;
+  }
+  return (*env)->NewStringUTF(env, name);
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_KernelDispatch_setWideOutput(
+    JNIEnv *env, jclass clazz, jboolean enabled) {
+  aesmb_set_wide_output(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_intel_diceros_crypto_engines_KernelDispatch_isWideOutput(
+    JNIEnv *env, jclass clazz) {
+  return aesmb_wide_output() ? JNI_TRUE : JNI_FALSE;
+}
@@ -0,0 +1,35 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_crypto_engines_WorkerPool.h"
+#include "work_pool.h"
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_engines_WorkerPool_configurePool(
+    JNIEnv *env, jclass clazz, jint threads, jint threshold, jint chunkSize,
+    jboolean strict) {
+  if (work_pool_configure(threads, threshold, chunkSize) != 0 && strict) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Invalid worker pool configuration");
+  }
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_engines_WorkerPool_getThreads(
+    JNIEnv *env, jclass clazz) {
+  return work_pool_threads();
+}
@@ -0,0 +1,207 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "aes_async.h"
+#include "aes_openssl.h"
+
+struct _AsyncQueue {
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t done;
+  AsyncSession* readyHead;
+  AsyncSession* readyTail;
+  AsyncJob* doneHead;
+  AsyncJob* doneTail;
+  int outstanding; // submitted jobs not on the done list yet
+  int shutdown;
+  int threads;
+  pthread_t workers[];
+};
+
+static void pushReady(AsyncQueue* queue, AsyncSession* session) {
+  session->scheduled = 1;
+  session->nextReady = NULL;
+  if (queue->readyTail != NULL) {
+    queue->readyTail->nextReady = session;
+  } else {
+    queue->readyHead = session;
+  }
+  queue->readyTail = session;
+}
+
+static void* workerMain(void* arg) {
+  AsyncQueue* queue = (AsyncQueue*) arg;
+
+  pthread_mutex_lock(&queue->lock);
+  for (;;) {
+    while (queue->readyHead == NULL && !queue->shutdown) {
+      pthread_cond_wait(&queue->work, &queue->lock);
+    }
+    if (queue->readyHead == NULL) {
+      break;
+    }
+    AsyncSession* session = queue->readyHead;
+    queue->readyHead = session->nextReady;
+    if (queue->readyHead == NULL) {
+      queue->readyTail = NULL;
+    }
+    AsyncJob* job = session->head;
+    session->head = job->next;
+    if (session->head == NULL) {
+      session->tail = NULL;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    job->result = opensslProcess(session->ctx, job->output, job->input,
+        job->inputLength, job->isFinal);
+
+    pthread_mutex_lock(&queue->lock);
+    job->next = NULL;
+    if (queue->doneTail != NULL) {
+      queue->doneTail->next = job;
+    } else {
+      queue->doneHead = job;
+    }
+    queue->doneTail = job;
+    queue->outstanding--;
+    pthread_cond_broadcast(&queue->done);
+    // one job per turn, so a long session does not starve the others
+    if (session->head != NULL) {
+      pushReady(queue, session);
+      pthread_cond_signal(&queue->work);
+    } else {
+      session->scheduled = 0;
+    }
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return NULL;
+}
+
+AsyncQueue* async_queue_create(int threads) {
+  AsyncQueue* queue = (AsyncQueue*) calloc(1,
+      sizeof(AsyncQueue) + threads * sizeof(pthread_t));
+  int i;
+  if (NULL == queue) {
+    return NULL;
+  }
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->work, NULL);
+  pthread_cond_init(&queue->done, NULL);
+  for (i = 0; i < threads; i++) {
+    if (pthread_create(&queue->workers[i], NULL, workerMain, queue) != 0) {
+      break;
+    }
+    queue->threads++;
+  }
+  if (queue->threads < threads) {
+    async_queue_shutdown(queue);
+    async_queue_destroy(queue);
+    return NULL;
+  }
+  return queue;
+}
+
+void async_queue_shutdown(AsyncQueue* queue) {
+  int i;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->shutdown) {
+    pthread_mutex_unlock(&queue->lock);
+    return;
+  }
+  queue->shutdown = 1;
+  pthread_cond_broadcast(&queue->work);
+  pthread_cond_broadcast(&queue->done);
+  pthread_mutex_unlock(&queue->lock);
+  for (i = 0; i < queue->threads; i++) {
+    pthread_join(queue->workers[i], NULL);
+  }
+}
+
+void async_queue_destroy(AsyncQueue* queue) {
+  while (queue->doneHead != NULL) {
+    AsyncJob* job = queue->doneHead;
+    queue->doneHead = job->next;
+    free(job);
+  }
+  pthread_cond_destroy(&queue->done);
+  pthread_cond_destroy(&queue->work);
+  pthread_mutex_destroy(&queue->lock);
+  free(queue);
+}
+
+AsyncSession* async_session_create(AsyncQueue* queue, CipherContext* ctx) {
+  AsyncSession* session = (AsyncSession*) calloc(1, sizeof(AsyncSession));
+  if (NULL != session) {
+    session->queue = queue;
+    session->ctx = ctx;
+  }
+  return session;
+}
+
+void async_session_destroy(AsyncSession* session) {
+  free(session);
+}
+
+int async_submit(AsyncSession* session, AsyncJob** jobs, int count) {
+  AsyncQueue* queue = session->queue;
+  int i;
+
+  pthread_mutex_lock(&queue->lock);
+  if (queue->shutdown) {
+    pthread_mutex_unlock(&queue->lock);
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    jobs[i]->session = session;
+    jobs[i]->next = NULL;
+    if (session->tail != NULL) {
+      session->tail->next = jobs[i];
+    } else {
+      session->head = jobs[i];
+    }
+    session->tail = jobs[i];
+  }
+  queue->outstanding += count;
+  if (count > 0 && !session->scheduled) {
+    pushReady(queue, session);
+    pthread_cond_signal(&queue->work);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return 0;
+}
+
+int async_queue_poll(AsyncQueue* queue, AsyncJob** jobs, int max) {
+  int count = 0;
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->doneHead == NULL
+      && !(queue->shutdown && queue->outstanding == 0)) {
+    pthread_cond_wait(&queue->done, &queue->lock);
+  }
+  while (count < max && queue->doneHead != NULL) {
+    jobs[count++] = queue->doneHead;
+    queue->doneHead = queue->doneHead->next;
+  }
+  if (queue->doneHead == NULL) {
+    queue->doneTail = NULL;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return count > 0 ? count : -1;
+}
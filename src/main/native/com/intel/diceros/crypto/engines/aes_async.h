@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_ASYNC_H
+#define __AES_ASYNC_H
+
+#include <stdint.h>
+#include "aes_utils.h"
+
+/*
+ * Asynchronous cipher jobs run by native worker threads.
+ *
+ * Jobs are submitted against a session, which wraps one AESOpensslEngine
+ * context. The jobs of a session run one at a time in submission order, the
+ * sessions of a queue run in parallel. Finished jobs are collected with
+ * async_queue_poll. The workers never call into the JVM.
+ */
+typedef struct _AsyncJob {
+  struct _AsyncJob* next;
+  struct _AsyncSession* session;
+  int64_t id;
+  const uint8_t* input;
+  int inputLength;
+  uint8_t* output;
+  int isFinal;
+  int result; // the bytes written or a CRYPT_ERROR_* code
+} AsyncJob;
+
+typedef struct _AsyncSession {
+  struct _AsyncQueue* queue;
+  CipherContext* ctx;
+  AsyncJob* head; // pending jobs, in submission order
+  AsyncJob* tail;
+  int scheduled;  // on the ready list or running
+  struct _AsyncSession* nextReady;
+} AsyncSession;
+
+typedef struct _AsyncQueue AsyncQueue;
+
+/*
+ * Start threads workers, returns NULL on failure.
+ */
+AsyncQueue* async_queue_create(int threads);
+
+/*
+ * Finish the jobs already submitted and stop the workers. Finished jobs
+ * can still be polled until async_queue_destroy.
+ */
+void async_queue_shutdown(AsyncQueue* queue);
+
+void async_queue_destroy(AsyncQueue* queue);
+
+AsyncSession* async_session_create(AsyncQueue* queue, CipherContext* ctx);
+
+/*
+ * The session must have no unfinished jobs.
+ */
+void async_session_destroy(AsyncSession* session);
+
+/*
+ * Queue count jobs of one session with a single lock, the queue takes
+ * ownership of the jobs. Returns -1 if the queue is shut down.
+ */
+int async_submit(AsyncSession* session, AsyncJob** jobs, int count);
+
+/*
+ * Move up to max finished jobs to jobs, the caller frees them. Blocks while
+ * no job is finished. Returns the number of jobs, or -1 once the queue is
+ * shut down and every job was returned.
+ */
+int async_queue_poll(AsyncQueue* queue, AsyncJob** jobs, int max);
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "aes_dispatch.h"
+#include "cpu_features.h"
+#include "config.h"
+
+static pthread_once_t bindOnce = PTHREAD_ONCE_INIT;
+static AesMbDispatch dispatch;
+static volatile int wideOutput = 0;
+
+static const char* encryptX8Names[AES_KEY_SIZES] = {
+  "aes_cbc_enc_128_x8", "aes_cbc_enc_192_x8", "aes_cbc_enc_256_x8"
+};
+static const char* encryptX16Names[AES_KEY_SIZES] = {
+  "aes_cbc_enc_128_x16", "aes_cbc_enc_192_x16", "aes_cbc_enc_256_x16"
+};
+static const char* encryptX8KeysNames[AES_KEY_SIZES] = {
+  "aes_cbc_enc_128_x8_keys", "aes_cbc_enc_192_x8_keys", "aes_cbc_enc_256_x8_keys"
+};
+static const char* decryptBy8Names[AES_KEY_SIZES] = {
+  "iDec128_CBC_by8", "iDec192_CBC_by8", "iDec256_CBC_by8"
+};
+static const char* decryptBy16Names[AES_KEY_SIZES] = {
+  "iDec128_CBC_by16", "iDec192_CBC_by16", "iDec256_CBC_by16"
+};
+static const char* encryptKeyexpNames[AES_KEY_SIZES] = {
+  "aes_keyexp_128_enc", "aes_keyexp_192_enc", "aes_keyexp_256_enc"
+};
+static const char* decryptKeyexpNames[AES_KEY_SIZES] = {
+  "aes_keyexp_128_dec", "aes_keyexp_192_dec", "aes_keyexp_256_dec"
+};
+static const char* gcmPrecompNames[AES_KEY_SIZES] = {
+  "aes_gcm_precomp_128", "aes_gcm_precomp_192", "aes_gcm_precomp_256"
+};
+static const char* gcmInitNames[AES_KEY_SIZES] = {
+  "aes_gcm_init_128", "aes_gcm_init_192", "aes_gcm_init_256"
+};
+static const char* gcmEncryptNames[AES_KEY_SIZES] = {
+  "aes_gcm_enc_128_update", "aes_gcm_enc_192_update", "aes_gcm_enc_256_update"
+};
+static const char* gcmDecryptNames[AES_KEY_SIZES] = {
+  "aes_gcm_dec_128_update", "aes_gcm_dec_192_update", "aes_gcm_dec_256_update"
+};
+
+static void bindGcmKernels() {
+  int i;
+  if (!cpu_has(CPU_FEATURE_PCLMUL)) {
+    return;
+  }
+
+  dispatch.gcmAad = dlsym(dispatch.handle, "aes_gcm_aad");
+  dispatch.gcmFinalize = dlsym(dispatch.handle, "aes_gcm_finalize");
+  for (i = 0; i < AES_KEY_SIZES; i++) {
+    dispatch.gcmPrecomp[i] = dlsym(dispatch.handle, gcmPrecompNames[i]);
+    dispatch.gcmInit[i] = dlsym(dispatch.handle, gcmInitNames[i]);
+    dispatch.gcmEncrypt[i] = dlsym(dispatch.handle, gcmEncryptNames[i]);
+    dispatch.gcmDecrypt[i] = dlsym(dispatch.handle, gcmDecryptNames[i]);
+  }
+}
+
+static void bindKernels() {
+  memset(&dispatch, 0, sizeof(dispatch));
+  dispatch.lanes = PARALLEL_LEVEL;
+
+  dispatch.cryptoHandle = loadLibrary(HADOOP_CRYPTO_LIBRARY);
+  if (NULL == dispatch.cryptoHandle) {
+    snprintf(dispatch.loadError, sizeof(dispatch.loadError), "%s", dlerror());
+    return;
+  }
+
+  dispatch.handle = loadLibrary(HADOOP_AESMB_LIBRARY);
+  if (NULL == dispatch.handle) {
+    snprintf(dispatch.loadError, sizeof(dispatch.loadError), "%s", dlerror());
+    return;
+  }
+
+  // every kernel of libaesmb needs AES-NI
+  if (!cpu_has(CPU_FEATURE_AESNI)) {
+    return;
+  }
+
+  int wide = cpu_has(CPU_FEATURE_VAES | CPU_FEATURE_AVX512F);
+  int i;
+  for (i = 0; i < AES_KEY_SIZES; i++) {
+    dispatch.encryptKeyexp[i] = dlsym(dispatch.handle, encryptKeyexpNames[i]);
+    dispatch.decryptKeyexp[i] = dlsym(dispatch.handle, decryptKeyexpNames[i]);
+    dispatch.encryptX8[i] = dlsym(dispatch.handle, encryptX8Names[i]);
+    dispatch.encryptName[i] = encryptX8Names[i];
+    dispatch.encryptX8Keys[i] = dlsym(dispatch.handle, encryptX8KeysNames[i]);
+    dispatch.decrypt[i] = dlsym(dispatch.handle, decryptBy8Names[i]);
+    dispatch.decryptName[i] = decryptBy8Names[i];
+
+    if (wide) {
+      dispatch.encryptX16[i] = dlsym(dispatch.handle, encryptX16Names[i]);
+      DecryptX1 by16 = dlsym(dispatch.handle, decryptBy16Names[i]);
+      if (NULL != by16) {
+        dispatch.decrypt[i] = by16;
+        dispatch.decryptName[i] = decryptBy16Names[i];
+      }
+    }
+  }
+
+  // only go wide if the kernels exist for every key size
+  if (wide && dispatch.encryptX16[0] && dispatch.encryptX16[1]
+      && dispatch.encryptX16[2]) {
+    dispatch.lanes = AESMB_MAX_LANES;
+    for (i = 0; i < AES_KEY_SIZES; i++) {
+      dispatch.encryptName[i] = encryptX16Names[i];
+    }
+  } else {
+    for (i = 0; i < AES_KEY_SIZES; i++) {
+      dispatch.encryptX16[i] = NULL;
+    }
+  }
+
+  bindGcmKernels();
+
+  // clean up the errors of the missing optional symbols
+  dlerror();
+}
+
+const AesMbDispatch* aesmb_dispatch() {
+  pthread_once(&bindOnce, bindKernels);
+  return &dispatch;
+}
+
+int aesmb_key_index(int keyLength) {
+  switch (keyLength) {
+  case 16:
+    return 0;
+  case 24:
+    return 1;
+  case 32:
+    return 2;
+  default:
+    return -1;
+  }
+}
+
+const char* aesmb_kernel_name(int mode, int forEncryption, int keyLength) {
+  const AesMbDispatch* table = aesmb_dispatch();
+  int index = aesmb_key_index(keyLength);
+  if (index < 0) {
+    return NULL;
+  }
+
+  switch (mode) {
+  case MODE_CBC:
+    if (forEncryption) {
+      return table->encryptX8[index] ? table->encryptName[index] : NULL;
+    }
+    return table->decrypt[index] ? table->decryptName[index] : NULL;
+  case MODE_GCM:
+    if (!aesmb_gcm_available(keyLength)) {
+      return NULL;
+    }
+    return forEncryption ? gcmEncryptNames[index] : gcmDecryptNames[index];
+  default:
+    return NULL;
+  }
+}
+
+int aesmb_gcm_available(int keyLength) {
+  const AesMbDispatch* table = aesmb_dispatch();
+  int index = aesmb_key_index(keyLength);
+  if (index < 0) {
+    return 0;
+  }
+  return table->encryptKeyexp[index] && table->gcmPrecomp[index]
+      && table->gcmInit[index] && table->gcmEncrypt[index]
+      && table->gcmDecrypt[index] && table->gcmAad && table->gcmFinalize;
+}
+
+void aesmb_set_wide_output(int enabled) {
+  wideOutput = enabled ? 1 : 0;
+}
+
+int aesmb_wide_output() {
+  return wideOutput;
+}
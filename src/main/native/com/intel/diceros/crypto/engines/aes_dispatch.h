@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_DISPATCH_H
+#define __AES_DISPATCH_H
+
+#include "aes_utils.h"
+
+// number of supported AES key sizes: 128, 192 and 256 bits
+#define AES_KEY_SIZES 3
+
+/*
+ * The kernels of libaesmb bound for this CPU, indexed by aesmb_key_index.
+ * A NULL entry means the kernel is not available, either because the CPU
+ * lacks the instructions or because the library does not export it.
+ */
+typedef struct _AesMbDispatch {
+  void* cryptoHandle;  // libcrypto
+  void* handle;        // libaesmb
+  char loadError[256]; // dlerror of the failed dlopen, if any
+  int lanes;           // lanes of the widest CBC encryption kernel
+  EncryptX8 encryptX8[AES_KEY_SIZES];
+  EncryptX16 encryptX16[AES_KEY_SIZES];
+  EncryptX8Keys encryptX8Keys[AES_KEY_SIZES]; // one key schedule per lane
+  DecryptX1 decrypt[AES_KEY_SIZES];
+  KeySched encryptKeyexp[AES_KEY_SIZES];
+  KeySched decryptKeyexp[AES_KEY_SIZES];
+  const char* encryptName[AES_KEY_SIZES];
+  const char* decryptName[AES_KEY_SIZES];
+  // AES-GCM, bound only with PCLMULQDQ
+  GcmPrecomp gcmPrecomp[AES_KEY_SIZES];
+  GcmInit gcmInit[AES_KEY_SIZES];
+  GcmUpdate gcmEncrypt[AES_KEY_SIZES];
+  GcmUpdate gcmDecrypt[AES_KEY_SIZES];
+  GcmAad gcmAad;
+  GcmFinalize gcmFinalize;
+} AesMbDispatch;
+
+/*
+ * Returns the process wide dispatch table. The libraries are loaded and
+ * the kernels are bound on the first call only, the call is thread safe.
+ */
+const AesMbDispatch* aesmb_dispatch();
+
+// index of the key size in the dispatch table, -1 for invalid sizes
+int aesmb_key_index(int keyLength);
+
+// name of the kernel used for mode/direction/key size, NULL if EVP is used
+const char* aesmb_kernel_name(int mode, int forEncryption, int keyLength);
+
+// true if all the GCM kernels for the key size are bound
+int aesmb_gcm_available(int keyLength);
+
+/*
+ * Whether bufferCrypt may write the 16 lane one-shot format. Off by default:
+ * builds before the 16 lane kernels take any non-zero header for 8 lanes
+ * and cannot read such messages. Decryption reads both formats either way.
+ */
+void aesmb_set_wide_output(int enabled);
+int aesmb_wide_output();
+
+#endif
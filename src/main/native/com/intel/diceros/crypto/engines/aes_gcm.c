@@ -0,0 +1,220 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "aes_gcm.h"
+#include "aes_dispatch.h"
+
+#define GCM_TAG_SIZE 16
+
+typedef struct _AesGcmCipherData {
+  uint8_t keysched[16 * 15];
+  sGcmData gcm;
+  int keyIndex;
+  int keySet;
+  int ivSet;
+  int ivLength;
+  uint8_t ivBuffer[EVP_MAX_IV_LENGTH];
+  uint8_t* ivHeap;   // for IVs longer than ivBuffer
+  int ivCapacity;
+  int tagLength;     // -1 until the tag is known
+  uint8_t tag[GCM_TAG_SIZE];
+} AesGcmCipherData;
+
+static uint8_t* gcmIV(AesGcmCipherData* data) {
+  return data->ivLength > (int) sizeof(data->ivBuffer) ?
+      data->ivHeap : data->ivBuffer;
+}
+
+static void gcmSetIV(AesGcmCipherData* data) {
+  const AesMbDispatch* table = aesmb_dispatch();
+  data->gcm.keysched = data->keysched;
+  table->gcmInit[data->keyIndex](&data->gcm, gcmIV(data), data->ivLength);
+}
+
+/*
+ * Follows the openssl GCM cipher: a key without IV keeps the previous IV,
+ * an IV without key only reloads the IV and keeps the hash keys.
+ */
+static int gcmInitKey(EVP_CIPHER_CTX *ctx, const unsigned char *key,
+    const unsigned char *iv, int enc) {
+  AesGcmCipherData* data = (AesGcmCipherData*) ctx->cipher_data;
+  const AesMbDispatch* table = aesmb_dispatch();
+
+  if (key != NULL) {
+    table->encryptKeyexp[data->keyIndex]((uint8_t *) key, data->keysched);
+    data->gcm.keysched = data->keysched;
+    table->gcmPrecomp[data->keyIndex](&data->gcm);
+    data->keySet = 1;
+    if (iv == NULL && data->ivSet) {
+      gcmSetIV(data);
+    }
+  }
+  if (iv != NULL) {
+    memcpy(gcmIV(data), iv, data->ivLength);
+    if (data->keySet) {
+      gcmSetIV(data);
+    }
+    data->ivSet = 1;
+  }
+  return 1;
+}
+
+static int gcmTagEquals(const uint8_t* a, const uint8_t* b, int length) {
+  uint8_t diff = 0;
+  int i;
+  for (i = 0; i < length; i++) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
+
+/*
+ * Custom cipher: a NULL output means AAD, a NULL input means final.
+ * Returns the number of bytes written or -1 on error.
+ */
+static int gcmCipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+    const unsigned char *in, size_t len) {
+  AesGcmCipherData* data = (AesGcmCipherData*) ctx->cipher_data;
+  const AesMbDispatch* table = aesmb_dispatch();
+
+  if (!data->keySet || !data->ivSet) {
+    return -1;
+  }
+  data->gcm.keysched = data->keysched;
+
+  if (in != NULL) {
+    if (out == NULL) {
+      if (table->gcmAad(&data->gcm, in, len) != 0) {
+        return -1;
+      }
+    } else if (ctx->encrypt) {
+      table->gcmEncrypt[data->keyIndex](&data->gcm, out, in, len);
+    } else {
+      table->gcmDecrypt[data->keyIndex](&data->gcm, out, in, len);
+    }
+    return (int) len;
+  }
+
+  uint8_t tag[GCM_TAG_SIZE];
+  table->gcmFinalize(&data->gcm, tag);
+  // like openssl, a new IV is required for the next message
+  data->ivSet = 0;
+  if (ctx->encrypt) {
+    memcpy(data->tag, tag, GCM_TAG_SIZE);
+    data->tagLength = GCM_TAG_SIZE;
+    return 0;
+  }
+  if (data->tagLength < 0 || !gcmTagEquals(tag, data->tag, data->tagLength)) {
+    return -1;
+  }
+  return 0;
+}
+
+static int gcmCtrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr) {
+  AesGcmCipherData* data = (AesGcmCipherData*) ctx->cipher_data;
+
+  switch (type) {
+  case EVP_CTRL_INIT:
+    data->keyIndex = aesmb_key_index(ctx->key_len);
+    data->keySet = 0;
+    data->ivSet = 0;
+    data->ivLength = ctx->cipher->iv_len;
+    data->ivHeap = NULL;
+    data->ivCapacity = 0;
+    data->tagLength = -1;
+    return 1;
+  case EVP_CTRL_GCM_SET_IVLEN:
+    if (arg <= 0) {
+      return 0;
+    }
+    if (arg > (int) sizeof(data->ivBuffer) && arg > data->ivCapacity) {
+      uint8_t* iv = (uint8_t*) malloc(arg);
+      if (iv == NULL) {
+        return 0;
+      }
+      free(data->ivHeap);
+      data->ivHeap = iv;
+      data->ivCapacity = arg;
+    }
+    data->ivLength = arg;
+    return 1;
+  case EVP_CTRL_GCM_SET_TAG:
+    if (arg <= 0 || arg > GCM_TAG_SIZE || ctx->encrypt) {
+      return 0;
+    }
+    memcpy(data->tag, ptr, arg);
+    data->tagLength = arg;
+    return 1;
+  case EVP_CTRL_GCM_GET_TAG:
+    if (arg <= 0 || arg > GCM_TAG_SIZE || !ctx->encrypt
+        || data->tagLength < 0) {
+      return 0;
+    }
+    memcpy(ptr, data->tag, arg);
+    return 1;
+  case EVP_CTRL_COPY: {
+    // the copy shares the cipher data until its pointers are fixed here
+    EVP_CIPHER_CTX* out = (EVP_CIPHER_CTX*) ptr;
+    AesGcmCipherData* copy = (AesGcmCipherData*) out->cipher_data;
+    copy->gcm.keysched = copy->keysched;
+    if (data->ivHeap != NULL) {
+      copy->ivHeap = (uint8_t*) malloc(data->ivCapacity);
+      if (copy->ivHeap == NULL) {
+        copy->ivCapacity = 0;
+        return 0;
+      }
+      memcpy(copy->ivHeap, data->ivHeap, data->ivCapacity);
+    }
+    return 1;
+  }
+  default:
+    return -1;
+  }
+}
+
+static int gcmCleanup(EVP_CIPHER_CTX *ctx) {
+  AesGcmCipherData* data = (AesGcmCipherData*) ctx->cipher_data;
+  if (data != NULL) {
+    free(data->ivHeap);
+    data->ivHeap = NULL;
+  }
+  return 1;
+}
+
+#define AESMB_GCM_FLAGS (EVP_CIPH_GCM_MODE | EVP_CIPH_FLAG_AEAD_CIPHER \
+    | EVP_CIPH_FLAG_CUSTOM_CIPHER | EVP_CIPH_CUSTOM_IV \
+    | EVP_CIPH_ALWAYS_CALL_INIT | EVP_CIPH_CTRL_INIT | EVP_CIPH_CUSTOM_COPY)
+
+#define AESMB_GCM_CIPHER(nid, keyLength) { \
+  nid, 1, keyLength, 12, AESMB_GCM_FLAGS, gcmInitKey, gcmCipher, gcmCleanup, \
+  sizeof(AesGcmCipherData), NULL, NULL, gcmCtrl, NULL }
+
+static const EVP_CIPHER aesmbGcmCiphers[AES_KEY_SIZES] = {
+  AESMB_GCM_CIPHER(NID_aes_128_gcm, 16),
+  AESMB_GCM_CIPHER(NID_aes_192_gcm, 24),
+  AESMB_GCM_CIPHER(NID_aes_256_gcm, 32)
+};
+
+const EVP_CIPHER* aesmb_gcm_cipher(int keyLength) {
+  if (!aesmb_gcm_available(keyLength)) {
+    return NULL;
+  }
+  return &aesmbGcmCiphers[aesmb_key_index(keyLength)];
+}
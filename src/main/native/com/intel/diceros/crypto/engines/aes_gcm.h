@@ -0,0 +1,33 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_GCM_H
+#define __AES_GCM_H
+
+#include <openssl/evp.h>
+
+/*
+ * AES-GCM as an EVP_CIPHER backed by the stitched kernels of libaesmb. It
+ * behaves like EVP_aes_*_gcm (IV length, AAD updates with a NULL output,
+ * EVP_CTRL_GCM_SET_TAG/GET_TAG) so the callers of getCipher need no change.
+ *
+ * Returns NULL if the kernels are not bound for this CPU or key size.
+ */
+const EVP_CIPHER* aesmb_gcm_cipher(int keyLength);
+
+#endif
@@ -0,0 +1,310 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "aes_mb_job_manager.h"
+#include "aes_dispatch.h"
+#include "cpu_features.h"
+
+#define BLOCKSIZE 16
+
+// max blocks per kernel pass, the idle lanes run over a scratch area this big
+#define SCRATCH_BLOCKS 256
+
+AesMbJobManager* aesmb_mgr_create(uint8_t* key, int keyLength, int padding,
+    long flushTimeout, int* result) {
+  *result = 0;
+  const AesMbDispatch* dispatch = aesmb_dispatch();
+  if (NULL == dispatch->handle) {
+    *result = -1;
+    return NULL;
+  }
+
+  if (!cpu_has(CPU_FEATURE_AESNI)) {
+    *result = -3;
+    return NULL;
+  }
+
+  int index = aesmb_key_index(keyLength);
+  if (index < 0 || NULL == dispatch->encryptX8[index]
+      || NULL == dispatch->encryptKeyexp[index]) {
+    *result = -2;
+    return NULL;
+  }
+  EncryptX8 efunc = dispatch->encryptX8[index];
+  KeySched keySchedFunc = dispatch->encryptKeyexp[index];
+
+  AesMbJobManager* mgr = (AesMbJobManager*) malloc(sizeof(AesMbJobManager));
+  memset(mgr, 0, sizeof(AesMbJobManager));
+  if (posix_memalign((void**) &mgr->scratch, BLOCKSIZE,
+      SCRATCH_BLOCKS * BLOCKSIZE)) {
+    free(mgr);
+    *result = -4;
+    return NULL;
+  }
+
+  pthread_mutex_init(&mgr->lock, NULL);
+  pthread_cond_init(&mgr->completed, NULL);
+  if (NULL != key) {
+    keySchedFunc(key, mgr->keysched);
+    mgr->hasKey = 1;
+  }
+  mgr->keyLength = keyLength;
+  mgr->efunc = efunc;
+  mgr->kfunc = dispatch->encryptX8Keys[index];
+  mgr->keySchedFunc = keySchedFunc;
+  mgr->padding = padding;
+  mgr->flushTimeout = flushTimeout;
+  return mgr;
+}
+
+int aesmb_mgr_destroy(AesMbJobManager* mgr) {
+  if (NULL == mgr) {
+    return 0;
+  }
+
+  // a waiting thread may still be blocked on the lock and the condition
+  pthread_mutex_lock(&mgr->lock);
+  int outstanding = mgr->outstanding;
+  pthread_mutex_unlock(&mgr->lock);
+  if (outstanding > 0) {
+    return -1;
+  }
+
+  pthread_cond_destroy(&mgr->completed);
+  pthread_mutex_destroy(&mgr->lock);
+  // the key schedule must not outlive the manager
+  memset(mgr->keysched, 0, sizeof(mgr->keysched));
+  free(mgr->scratch);
+  free(mgr);
+  return 0;
+}
+
+int aesmb_mgr_set_job_key(AesMbJobManager* mgr, AesMbJob* job, uint8_t* key,
+    int keyLength) {
+  if (keyLength != mgr->keyLength) {
+    return -1;
+  }
+  if (NULL == mgr->kfunc) {
+    return -2;
+  }
+  mgr->keySchedFunc(key, job->keyschedStorage);
+  job->keysched = job->keyschedStorage;
+  return 0;
+}
+
+int aesmb_mgr_output_length(AesMbJobManager* mgr, int inputLength) {
+  if (mgr->padding == PADDING_PKCS5PADDING) {
+    return (inputLength / BLOCKSIZE + 1) * BLOCKSIZE;
+  }
+  return inputLength;
+}
+
+static void setLane(AesMbJobManager* mgr, AesMbJob* job, uint8_t** inbuf,
+    uint8_t** outbuf, uint8_t** iv, uint8_t* idleIv) {
+  if (job == NULL) {
+    *inbuf = mgr->scratch;
+    *outbuf = mgr->scratch;
+    *iv = idleIv;
+  } else {
+    *inbuf = job->phase == JOB_PHASE_DATA ?
+        job->input + job->outputLength : job->tail;
+    *outbuf = job->output + job->outputLength;
+    *iv = job->iv;
+  }
+}
+
+/*
+ * Run one kernel pass over all lanes, for as many blocks as the shortest busy
+ * lane still needs in its current phase. Must be called with the lock held.
+ */
+static void run_lanes(AesMbJobManager* mgr) {
+  if (mgr->busyLanes == 0) {
+    return;
+  }
+
+  uint64_t blocks = SCRATCH_BLOCKS;
+  int i;
+  for (i = 0; i < PARALLEL_LEVEL; i++) {
+    AesMbJob* job = mgr->lanes[i];
+    if (job != NULL) {
+      uint64_t remaining = job->phase == JOB_PHASE_DATA ? job->dataBlocks : 1;
+      if (remaining < blocks) {
+        blocks = remaining;
+      }
+    }
+  }
+
+  uint8_t idleIv[BLOCKSIZE];
+  int ownKeys = 0;
+  for (i = 0; i < PARALLEL_LEVEL; i++) {
+    if (mgr->lanes[i] != NULL && mgr->lanes[i]->keysched != NULL) {
+      ownKeys = 1;
+    }
+  }
+
+  if (ownKeys) {
+    // the idle lanes and the jobs without a key run with the manager key
+    sAesKeysData_x8 data;
+    data.numblocks = blocks;
+    for (i = 0; i < PARALLEL_LEVEL; i++) {
+      AesMbJob* job = mgr->lanes[i];
+      setLane(mgr, job, &data.inbuf[i], &data.outbuf[i], &data.iv[i], idleIv);
+      data.keysched[i] = job != NULL && job->keysched != NULL ?
+          job->keysched : mgr->keysched;
+    }
+    mgr->kfunc(&data);
+  } else {
+    sAesData_x8 data;
+    data.keysched = mgr->keysched;
+    data.numblocks = blocks;
+    for (i = 0; i < PARALLEL_LEVEL; i++) {
+      setLane(mgr, mgr->lanes[i], &data.inbuf[i], &data.outbuf[i],
+          &data.iv[i], idleIv);
+    }
+    mgr->efunc(&data);
+  }
+
+  int completed = 0;
+  for (i = 0; i < PARALLEL_LEVEL; i++) {
+    AesMbJob* job = mgr->lanes[i];
+    if (job == NULL) {
+      continue;
+    }
+
+    job->outputLength += blocks * BLOCKSIZE;
+    if (job->phase == JOB_PHASE_DATA) {
+      job->dataBlocks -= blocks;
+      if (job->dataBlocks == 0) {
+        job->phase = mgr->padding == PADDING_PKCS5PADDING ?
+            JOB_PHASE_TAIL : JOB_PHASE_DONE;
+      }
+    } else {
+      job->phase = JOB_PHASE_DONE;
+    }
+
+    if (job->phase == JOB_PHASE_DONE) {
+      if (job->keysched != NULL) {
+        memset(job->keysched, 0, sizeof(job->keyschedStorage));
+      }
+      job->status = JOB_STATUS_COMPLETED;
+      mgr->lanes[i] = NULL;
+      mgr->busyLanes--;
+      completed++;
+    }
+  }
+
+  if (completed) {
+    pthread_cond_broadcast(&mgr->completed);
+  }
+}
+
+/*
+ * Queue the job into a free lane, running the lanes first if all of them
+ * are busy. The job is not guaranteed to be completed on return.
+ */
+int aesmb_mgr_submit(AesMbJobManager* mgr, AesMbJob* job) {
+  int padding = mgr->padding == PADDING_PKCS5PADDING;
+  int rem = job->inputLength % BLOCKSIZE;
+  if (job->inputLength < 0 || (!padding && rem != 0)
+      || (job->keysched == NULL && !mgr->hasKey)) {
+    job->status = JOB_STATUS_FAILED;
+    return -1;
+  }
+
+  job->dataBlocks = job->inputLength / BLOCKSIZE;
+  job->outputLength = 0;
+  job->phase = JOB_PHASE_DATA;
+  job->status = JOB_STATUS_QUEUED;
+  if (padding) {
+    // PKCS5: the last partial block is padded with the pad length
+    memcpy(job->tail, job->input + job->inputLength - rem, rem);
+    memset(job->tail + rem, BLOCKSIZE - rem, BLOCKSIZE - rem);
+    if (job->dataBlocks == 0) {
+      job->phase = JOB_PHASE_TAIL;
+    }
+  } else if (job->dataBlocks == 0) {
+    job->status = JOB_STATUS_COMPLETED;
+  }
+
+  pthread_mutex_lock(&mgr->lock);
+  mgr->outstanding++;
+  if (job->status == JOB_STATUS_COMPLETED) {
+    pthread_mutex_unlock(&mgr->lock);
+    return 0;
+  }
+  while (mgr->busyLanes == PARALLEL_LEVEL) {
+    run_lanes(mgr);
+  }
+
+  int i;
+  for (i = 0; i < PARALLEL_LEVEL; i++) {
+    if (mgr->lanes[i] == NULL) {
+      mgr->lanes[i] = job;
+      mgr->busyLanes++;
+      break;
+    }
+  }
+
+  // full occupancy, the kernel runs at full width
+  if (mgr->busyLanes == PARALLEL_LEVEL) {
+    run_lanes(mgr);
+  }
+  pthread_mutex_unlock(&mgr->lock);
+  return 0;
+}
+
+/*
+ * Wait for the job to complete. If the lanes are not filled by other
+ * submitters within flushTimeout, the waiting thread runs them itself.
+ * Returns the output length of the job, or -1 if the job failed.
+ */
+int aesmb_mgr_wait(AesMbJobManager* mgr, AesMbJob* job) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += mgr->flushTimeout / 1000000000L;
+  deadline.tv_nsec += mgr->flushTimeout % 1000000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&mgr->lock);
+  int rc = 0;
+  while (job->status == JOB_STATUS_QUEUED && rc != ETIMEDOUT) {
+    rc = pthread_cond_timedwait(&mgr->completed, &mgr->lock, &deadline);
+  }
+  // timed out with partially filled lanes, flush until our job is done
+  while (job->status == JOB_STATUS_QUEUED) {
+    run_lanes(mgr);
+  }
+  mgr->outstanding--;
+  pthread_mutex_unlock(&mgr->lock);
+
+  return job->status == JOB_STATUS_COMPLETED ? job->outputLength : -1;
+}
+
+void aesmb_mgr_flush(AesMbJobManager* mgr) {
+  pthread_mutex_lock(&mgr->lock);
+  while (mgr->busyLanes > 0) {
+    run_lanes(mgr);
+  }
+  pthread_mutex_unlock(&mgr->lock);
+}
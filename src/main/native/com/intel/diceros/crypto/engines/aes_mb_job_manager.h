@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_MB_JOB_MANAGER_H
+#define __AES_MB_JOB_MANAGER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "aes_utils.h"
+
+#define JOB_STATUS_QUEUED 0
+#define JOB_STATUS_COMPLETED 1
+#define JOB_STATUS_FAILED 2
+
+// lane phases of a job
+#define JOB_PHASE_DATA 0
+#define JOB_PHASE_TAIL 1
+#define JOB_PHASE_DONE 2
+
+/*
+ * One independent AES-CBC encryption request. The input and output memory
+ * must stay valid until the job is completed.
+ */
+typedef struct _AesMbJob {
+  uint8_t* input;
+  uint8_t* output;
+  int inputLength;
+  int outputLength;
+  uint8_t iv[16];        // chaining value, updated by the kernel
+  uint8_t tail[16];      // last (padded) block when PKCS5 padding is used
+  // the key schedule of the job, NULL to use the one of the manager; see
+  // aesmb_mgr_set_job_key
+  uint8_t* keysched;
+  uint8_t keyschedStorage[16*15];
+  uint64_t dataBlocks;   // remaining full blocks of input
+  int phase;
+  int status;            // guarded by the manager lock
+} AesMbJob;
+
+/*
+ * Collects jobs from many threads into the lanes of the x8 CBC encryption
+ * kernel. A kernel pass always runs for the shortest remaining lane, so at
+ * least one job completes per pass. Lanes are flushed when all of them are
+ * busy, or by a waiting thread once flushTimeout has passed.
+ *
+ * Jobs may bring their own key of the manager's key size, e.g. one per
+ * tenant. Passes with such jobs use the per-lane key kernel, so jobs of
+ * different keys still share the lanes.
+ */
+typedef struct _AesMbJobManager {
+  pthread_mutex_t lock;
+  pthread_cond_t completed;
+  uint8_t keysched[16*15];
+  int hasKey;            // 0 if every job must bring its own key
+  int keyLength;
+  EncryptX8 efunc;
+  EncryptX8Keys kfunc;   // NULL without the per-lane key kernels
+  KeySched keySchedFunc;
+  int padding;
+  long flushTimeout;     // in nanoseconds
+  AesMbJob* lanes[PARALLEL_LEVEL];
+  int busyLanes;
+  int outstanding;       // jobs submitted but not yet returned by wait
+  uint8_t* scratch;      // target of the idle lanes
+} AesMbJobManager;
+
+/*
+ * key may be NULL, then every job needs its own key of keyLength bytes.
+ */
+AesMbJobManager* aesmb_mgr_create(uint8_t* key, int keyLength, int padding,
+    long flushTimeout, int* result);
+/*
+ * Free the manager. Returns -1 and leaves it intact while submitted jobs
+ * have not been returned by aesmb_mgr_wait yet.
+ */
+int aesmb_mgr_destroy(AesMbJobManager* mgr);
+int aesmb_mgr_output_length(AesMbJobManager* mgr, int inputLength);
+/*
+ * Expand a key of the job into job->keyschedStorage and point job->keysched
+ * at it. Returns -1 if the key size differs from the manager's, or -2 if the
+ * per-lane key kernels are not available.
+ */
+int aesmb_mgr_set_job_key(AesMbJobManager* mgr, AesMbJob* job, uint8_t* key,
+    int keyLength);
+int aesmb_mgr_submit(AesMbJobManager* mgr, AesMbJob* job);
+int aesmb_mgr_wait(AesMbJobManager* mgr, AesMbJob* job);
+void aesmb_mgr_flush(AesMbJobManager* mgr);
+
+#endif
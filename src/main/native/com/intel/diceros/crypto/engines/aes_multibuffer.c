@@ -17,215 +17,43 @@
  */
 #include <openssl/evp.h>
 #include <openssl/err.h>
-#include <cpuid.h>
-#include <dlfcn.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "com_intel_diceros.h"
 #include "aes_multibuffer.h"
-#include "config.h"
+#include "aes_multibuffer_stream.h"
+#include "aes_dispatch.h"
+#include "cpu_features.h"
+#include "work_pool.h"
 
 #define BLOCKSIZE 16
 
-void cleanDLError() {
-  dlerror();
-}
-
-static EncryptX8 encrypt(void* handle, int keyLength)
-{
-  if (NULL == handle) {
-    return NULL;
-  }
-
-  static EncryptX8 X8128 = NULL;
-  static EncryptX8 X8192 = NULL;
-  static EncryptX8 X8256 = NULL;
-
-  EncryptX8 result = NULL;
-  char* funcName = NULL;
-
-  switch (keyLength) {
-  case 16:
-    funcName = "aes_cbc_enc_128_x8";
-    if (NULL == X8128) {
-      X8128 = dlsym(handle, funcName);
-    }
-    result = X8128;
-    break;
-  case 24:
-    funcName = "aes_cbc_enc_192_x8";
-    if (NULL == X8192) {
-      X8192 = dlsym(handle, funcName);
-    }
-    result = X8192;
-    break;
-  case 32:
-    funcName = "aes_cbc_enc_256_x8";
-    if (NULL == X8256) {
-      X8256 = dlsym(handle, funcName);
-    }
-    result = X8256;
-    break;
-  default:
-    result = NULL;
-    break;
-  }
-
-  if (NULL == result) {
-    DTRACE("invalid key length %d or symbol %s\n", keyLength, funcName);
-  }
-
-  return result;
-}
-
-static DecryptX1 decrypt(void* handle, int keyLength)
-{
-  if (NULL == handle) {
-    return NULL;
-  }
-
-  static DecryptX1 X1128 = NULL;
-  static DecryptX1 X1192 = NULL;
-  static DecryptX1 X1256 = NULL;
-
-
-  DecryptX1 result = NULL;
-  char* funcName = NULL;
-
-  switch (keyLength) {
-  case 16:
-    funcName = "iDec128_CBC_by8";
-    if (NULL == X1128) {
-      X1128 = dlsym(handle, funcName);
-    }
-    result = X1128;
-    break;
-  case 24:
-    funcName = "iDec192_CBC_by8";
-    if (NULL == X1192) {
-      X1192 = dlsym(handle, funcName);
-    }
-    result = X1192;
-    break;
-  case 32:
-    funcName = "iDec256_CBC_by8";
-    if (NULL == X1256) {
-      X1256 = dlsym(handle, funcName);
-    }
-    result = X1256;
-    break;
-  default:
-    result = NULL;
-    break;
-  }
-
-  if (NULL == result) {
-    DTRACE("invalid key length %d or symbol %s\n", keyLength, funcName);
-  }
-  return result ;
-}
-
-// mode: 1 for encrypt, 0 for decrypt
-static KeySched keyexp(void* handle, int keyLength, int mode) {
-  if (NULL == handle) {
-    return NULL;
-  }
-
-  static KeySched EncKeyExp128 = NULL;
-  static KeySched EncKeyExp192 = NULL;
-  static KeySched EncKeyExp256 = NULL;
-
-  static KeySched DecKeyExp128 = NULL;
-  static KeySched DecKeyExp192 = NULL;
-  static KeySched DecKeyExp256 = NULL;
-
-  KeySched result = NULL;
-  char* funcName = NULL;
-
-  switch (keyLength + mode) {
-  case 16:
-    funcName = "aes_keyexp_128_dec";
-    if (NULL == DecKeyExp128) {
-      DecKeyExp128 = dlsym(handle, funcName);
-    }
-    result = DecKeyExp128;
-    break;
-  case 24:
-    funcName = "aes_keyexp_192_dec";
-    if (NULL == DecKeyExp192) {
-      DecKeyExp192 = dlsym(handle, funcName);
-    }
-    result = DecKeyExp192;
-    break;
-  case 32:
-    funcName = "aes_keyexp_256_dec";
-    if (NULL == DecKeyExp256) {
-      DecKeyExp256 = dlsym(handle, funcName);
-    }
-    result = DecKeyExp256;
-    break;
-  case 16 + 1:
-    funcName = "aes_keyexp_128_enc";
-    if (NULL == EncKeyExp128) {
-      EncKeyExp128 = dlsym(handle, funcName);
-    }
-    result = EncKeyExp128;
-    break;
-  case 24 + 1:
-    funcName = "aes_keyexp_192_enc";
-    if (NULL == EncKeyExp192) {
-      EncKeyExp192 = dlsym(handle, funcName);
-    }
-    result = EncKeyExp192;
-    break;
-  case 32 + 1:
-    funcName = "aes_keyexp_256_enc";
-    if (NULL == EncKeyExp256) {
-      EncKeyExp256 = dlsym(handle, funcName);
-    }
-    result = EncKeyExp256;
-    break;
-  default:
-    result = NULL;
-    break;
-  }
-
-  if (NULL == result) {
-    DTRACE("invalid key length %d or symbol %s\n", keyLength, funcName);
-  }
-  return result ;
-}
-
-int aesni_supported() {
-  int a, b, c, d;
-  __cpuid(1, a, b, c, d);
-
-  return (c >> 25) & 1;
-}
-
-int aesmb_keyexp(CipherContext* ctx) {
+/*
+ * Expand the key schedule of one direction on first use, an encrypt-only or
+ * decrypt-only context never pays for the other one.
+ */
+int aesmb_keyexp(CipherContext* ctx, int forEncryption) {
   if (NULL == ctx || NULL == ctx->aesmbCtx || NULL == ctx->aesmbCtx->handle) {
     DTRACE("Invalid parameter: ctx or key or iv is NULL!");
     return -1;
   }
 
-  void* handle = ctx->aesmbCtx->handle;
-
-  KeySched keySchedFunc = NULL;
-  // init encryption key expension
-  keySchedFunc = keyexp(handle, ctx->keyLength, 1);
-  if (NULL == keySchedFunc) {
-    DTRACE("Invalid parameter: key length(%d) is not supported", keyLength);
+  const AesMbDispatch* dispatch = aesmb_dispatch();
+  int index = aesmb_key_index(ctx->keyLength);
+  if (index < 0 || NULL == dispatch->encryptKeyexp[index]
+      || NULL == dispatch->decryptKeyexp[index]) {
+    DTRACE("Invalid parameter: key length(%d) is not supported", ctx->keyLength);
     return -2;
   }
-  keySchedFunc(ctx->key, ctx->aesmbCtx->encryptKeysched);
-  // init decryption key expension
-  keySchedFunc = keyexp(handle, ctx->keyLength, 0);
-  if (NULL == keySchedFunc) {
-    DTRACE("Invalid parameter: key length(%d) is not supported", keyLength);
-    return -2;
+
+  if (forEncryption && !ctx->aesmbCtx->encryptKeyschedReady) {
+    dispatch->encryptKeyexp[index](ctx->key, ctx->aesmbCtx->encryptKeysched);
+    ctx->aesmbCtx->encryptKeyschedReady = 1;
+  } else if (!forEncryption && !ctx->aesmbCtx->decryptKeyschedReady) {
+    dispatch->decryptKeyexp[index](ctx->key, ctx->aesmbCtx->decryptKeysched);
+    ctx->aesmbCtx->decryptKeyschedReady = 1;
   }
-  keySchedFunc(ctx->key, ctx->aesmbCtx->decryptKeysched);
 
   return 0;
 }
@@ -235,13 +63,21 @@ int aesmb_keyinit(CipherContext* ctx, uint8_t* key, int keyLength) {
     return 0;
   }
 
-  if (keyLength != ctx->keyLength) {
-    free(ctx->key);
+  if (keyLength != ctx->keyLength || NULL == ctx->key) {
     ctx->keyLength = keyLength;
-    ctx->key = (uint8_t*) malloc (keyLength * sizeof(uint8_t));
+    if (!resizeContextKey(ctx, keyLength)) {
+      return -5;
+    }
 
-    ctx->aesmbCtx->efunc = encrypt(ctx->aesmbCtx->handle, keyLength);
-    ctx->aesmbCtx->dfunc = decrypt(ctx->aesmbCtx->handle, keyLength);
+    const AesMbDispatch* dispatch = aesmb_dispatch();
+    int index = aesmb_key_index(keyLength);
+    if (index >= 0 && NULL != ctx->aesmbCtx->handle) {
+      ctx->aesmbCtx->efunc = dispatch->encryptX8[index];
+      ctx->aesmbCtx->efunc16 = dispatch->encryptX16[index];
+      ctx->aesmbCtx->dfunc = dispatch->decrypt[index];
+    }
+    ctx->aesmbCtx->lanes = NULL != ctx->aesmbCtx->efunc16 ?
+        AESMB_MAX_LANES : PARALLEL_LEVEL;
   }
 
   memcpy(ctx->key, key, keyLength);
@@ -251,11 +87,20 @@ int aesmb_keyinit(CipherContext* ctx, uint8_t* key, int keyLength) {
     return -3;
   }
 
-  if (!aesni_supported()) {
+  if (!cpu_has(CPU_FEATURE_AESNI)) {
     return -4;
   }
 
-  return aesmb_keyexp(ctx);
+  // the schedules are expanded by aesmb_keyexp when first needed
+  ctx->aesmbCtx->encryptKeyschedReady = 0;
+  ctx->aesmbCtx->decryptKeyschedReady = 0;
+  const AesMbDispatch* dispatch = aesmb_dispatch();
+  int index = aesmb_key_index(keyLength);
+  if (NULL == dispatch->encryptKeyexp[index]
+      || NULL == dispatch->decryptKeyexp[index]) {
+    return -2;
+  }
+  return 0;
 }
 
 int aesmb_ivinit(CipherContext* ctx, uint8_t* iv, int ivLength) {
@@ -263,14 +108,15 @@ int aesmb_ivinit(CipherContext* ctx, uint8_t* iv, int ivLength) {
     return 0;
   }
 
-  if (ivLength != ctx->ivLength) {
-    free(ctx->iv);
+  if (ivLength != ctx->ivLength || NULL == ctx->iv) {
     ctx->ivLength = ivLength;
-    ctx->iv = (uint8_t*) malloc (ivLength * sizeof(uint8_t) * PARALLEL_LEVEL);
+    if (!resizeContextIv(ctx, ivLength * AESMB_MAX_LANES)) {
+      return -5;
+    }
   }
 
   int i,j = 0;
-  for (i = 0 ; i < PARALLEL_LEVEL ; i++) {
+  for (i = 0 ; i < AESMB_MAX_LANES ; i++) {
     memcpy(ctx->iv + i * ivLength, iv, ivLength);
     // generate seven different IVs
     for(j=0 ;j <16 ;j++){
@@ -314,8 +160,8 @@ int aesmb_ctxinit(CipherContext* ctx,
   return aesmb_keyivinit(ctx, key, keyLength, iv, ivLength);
 }
 
-int aesmb_streamlength(int inputLength) {
-  int mbUnit = PARALLEL_LEVEL * BLOCKSIZE;
+int aesmb_streamlength(int inputLength, int lanes) {
+  int mbUnit = lanes * BLOCKSIZE;
   int mbBlocks = inputLength / mbUnit;
   return BLOCKSIZE * mbBlocks;
 }
@@ -324,7 +170,8 @@ int aesmb_encrypt(CipherContext* ctx,
               uint8_t* input,
               int inputLength,
               uint8_t* output,
-              int* outputLength
+              int* outputLength,
+              int lanes
               )
 {
   if (NULL == ctx || NULL == input || NULL == output || inputLength < 0 ) {
@@ -332,7 +179,7 @@ int aesmb_encrypt(CipherContext* ctx,
     return -1;
   }
 
-  int mbUnit = PARALLEL_LEVEL * BLOCKSIZE;
+  int mbUnit = lanes * BLOCKSIZE;
   int mbBlocks = inputLength / mbUnit;
   int mbTotal = inputLength - inputLength % mbUnit;
   *outputLength = mbTotal;
@@ -341,32 +188,116 @@ int aesmb_encrypt(CipherContext* ctx,
     return *outputLength;
   }
 
-  sAesData_x8 data;
-  data.keysched = ctx->aesmbCtx->encryptKeysched;
-  data.numblocks = mbBlocks;
+  if (aesmb_keyexp(ctx, ENCRYPTION) != 0) {
+    return -1;
+  }
 
   // init iv
-  uint8_t iv[PARALLEL_LEVEL*BLOCKSIZE];
-  memcpy(iv, ctx->iv, PARALLEL_LEVEL*BLOCKSIZE);
+  uint8_t iv[AESMB_MAX_LANES*BLOCKSIZE];
+  memcpy(iv, ctx->iv, lanes*BLOCKSIZE);
 
   int i;
-  for (i =0; i < PARALLEL_LEVEL; i++) {
-    int step = i * BLOCKSIZE * mbBlocks;
-    data.inbuf[i] = input + step;
-    data.outbuf[i] = output + step;
-    data.iv[i] = iv + i*BLOCKSIZE;
-  }
+  if (lanes == AESMB_MAX_LANES) {
+    sAesData_x16 data;
+    data.keysched = ctx->aesmbCtx->encryptKeysched;
+    data.numblocks = mbBlocks;
+    for (i =0; i < lanes; i++) {
+      int step = i * BLOCKSIZE * mbBlocks;
+      data.inbuf[i] = input + step;
+      data.outbuf[i] = output + step;
+      data.iv[i] = iv + i*BLOCKSIZE;
+    }
 
-  (ctx->aesmbCtx->efunc) (&data); // encrypt in parallel
+    (ctx->aesmbCtx->efunc16) (&data); // encrypt in parallel
+  } else {
+    sAesData_x8 data;
+    data.keysched = ctx->aesmbCtx->encryptKeysched;
+    data.numblocks = mbBlocks;
+    for (i =0; i < lanes; i++) {
+      int step = i * BLOCKSIZE * mbBlocks;
+      data.inbuf[i] = input + step;
+      data.outbuf[i] = output + step;
+      data.iv[i] = iv + i*BLOCKSIZE;
+    }
+
+    (ctx->aesmbCtx->efunc) (&data); // encrypt in parallel
+  }
 
   return *outputLength;
 }
 
+/*
+ * The lanes of aesmb_decrypt cut into pieces for the worker pool. CBC
+ * decryption of a piece only needs the ciphertext block before it, these
+ * chaining values are copied up front so that in-place decryption works.
+ */
+typedef struct _LaneJob {
+  sAesContext* aesCtx;
+  uint8_t* input;
+  uint8_t* output;
+  int laneBlocks;
+  int pieceBlocks;
+  int piecesPerLane;
+  uint8_t* ivs;
+} LaneJob;
+
+static int decryptPiece(void* arg, int index) {
+  LaneJob* job = (LaneJob*) arg;
+  int lane = index / job->piecesPerLane;
+  int first = index % job->piecesPerLane * job->pieceBlocks;
+  long offset = ((long) lane * job->laneBlocks + first) * BLOCKSIZE;
+  sAesData data;
+
+  data.keysched = job->aesCtx->decryptKeysched;
+  data.numblocks = job->laneBlocks - first < job->pieceBlocks ?
+      job->laneBlocks - first : job->pieceBlocks;
+  data.inbuf = job->input + offset;
+  data.outbuf = job->output + offset;
+  data.iv = job->ivs + index * BLOCKSIZE;
+  (job->aesCtx->dfunc)(&data);
+  return 0;
+}
+
+/*
+ * Returns 0 if the lanes were decrypted on the worker pool, -1 if they are
+ * left to the caller.
+ */
+static int decryptLanesParallel(CipherContext* ctx, uint8_t* input,
+    int laneBlocks, uint8_t* output, const uint8_t* iv, int lanes,
+    int chunkSize) {
+  LaneJob job;
+  int i, piece;
+
+  job.aesCtx = ctx->aesmbCtx;
+  job.input = input;
+  job.output = output;
+  job.laneBlocks = laneBlocks;
+  job.pieceBlocks = chunkSize / BLOCKSIZE;
+  job.piecesPerLane = (laneBlocks + job.pieceBlocks - 1) / job.pieceBlocks;
+  job.ivs = (uint8_t*) malloc(lanes * job.piecesPerLane * BLOCKSIZE);
+  if (NULL == job.ivs) {
+    return -1;
+  }
+  for (i = 0; i < lanes; i++) {
+    for (piece = 0; piece < job.piecesPerLane; piece++) {
+      const uint8_t* chain = piece == 0 ? iv + i * BLOCKSIZE : input
+          + ((long) i * laneBlocks + piece * job.pieceBlocks - 1) * BLOCKSIZE;
+      memcpy(job.ivs + (i * job.piecesPerLane + piece) * BLOCKSIZE, chain,
+          BLOCKSIZE);
+    }
+  }
+
+  work_pool_run(decryptPiece, &job, lanes * job.piecesPerLane);
+  free(job.ivs);
+  return 0;
+}
+
 int aesmb_decrypt(CipherContext* ctx,
               uint8_t* input,
               int inputLength,
               uint8_t* output,
-              int* outputLength
+              int* outputLength,
+              int lanes
               )
 {
   if (NULL == ctx || NULL == input || NULL == output || inputLength < 0 ) {
@@ -374,7 +305,7 @@ int aesmb_decrypt(CipherContext* ctx,
     return -1;
   }
 
-  int mbUnit = BLOCKSIZE * PARALLEL_LEVEL;
+  int mbUnit = BLOCKSIZE * lanes;
   int mbBlocks = inputLength / mbUnit;
   int mbTotal = inputLength - inputLength % mbUnit;
   *outputLength = mbTotal;
@@ -383,16 +314,27 @@ int aesmb_decrypt(CipherContext* ctx,
     return *outputLength;
   }
 
+  if (aesmb_keyexp(ctx, DECRYPTION) != 0) {
+    return -1;
+  }
+
   sAesData data;
   data.keysched = ctx->aesmbCtx->decryptKeysched;
   data.numblocks = mbBlocks;
 
   // init iv
-  uint8_t iv[PARALLEL_LEVEL*BLOCKSIZE];
-  memcpy(iv, ctx->iv, PARALLEL_LEVEL*BLOCKSIZE);
+  uint8_t iv[AESMB_MAX_LANES*BLOCKSIZE];
+  memcpy(iv, ctx->iv, lanes*BLOCKSIZE);
+
+  // the lanes are independent, large inputs are split over the worker pool
+  int chunkSize = work_pool_chunk_size(mbTotal);
+  if (chunkSize > 0 && decryptLanesParallel(ctx, input, mbBlocks, output, iv,
+      lanes, chunkSize) == 0) {
+    return *outputLength;
+  }
 
   int i;
-  for (i =0; i < PARALLEL_LEVEL; i++) {
+  for (i =0; i < lanes; i++) {
     int step = i * BLOCKSIZE * mbBlocks;
     data.inbuf = input + step;
     data.outbuf = output + step;
@@ -404,56 +346,98 @@ int aesmb_decrypt(CipherContext* ctx,
 }
 
 CipherContext* createCipherContextMB(void* handle, signed char* key, int keylen, signed char* iv, int ivlen) {
-  CipherContext* ctx = (CipherContext*) malloc(sizeof(CipherContext));
-  memset(ctx, 0, sizeof(CipherContext));
-
-  ctx->opensslCtx = (EVP_CIPHER_CTX*) malloc(sizeof(EVP_CIPHER_CTX));
-
-  ctx->aesmbCtx = (sAesContext*) malloc(sizeof(sAesContext));
-  memset(ctx->aesmbCtx, 0, sizeof(sAesContext));
+  CipherContext* ctx = createCipherContext();
+  if (NULL == ctx) {
+    return NULL;
+  }
+  ctx->aesmbCtx = &ctx->aesmbStorage;
 
   // init iv and key
   int result = aesmb_ctxinit(ctx, handle, (uint8_t*)key, keylen, (uint8_t*)iv, ivlen);
 
-  ctx->aesmbCtx->aesEnabled = aesni_supported() && result == 0;
+  ctx->aesmbCtx->aesEnabled = cpu_has(CPU_FEATURE_AESNI) && result == 0;
   return ctx;
 }
 
+/*
+ * Reload the IV of lane count into the keyed openssl context, the key
+ * schedule openssl expanded at init is kept.
+ */
+static void opensslResetIv(EVP_CIPHER_CTX* context,
+    CipherContext* cipherContext, int count) {
+  unsigned char* nativeIv = (unsigned char*) cipherContext->iv + count * 16;
+  cryptInit cryptInitFunc = getCryptInitFunc(context->encrypt);
+  cryptInitFunc(context, NULL, NULL, NULL, nativeIv);
+}
+
+static void setPadding(EVP_CIPHER_CTX* context, int padding) {
+  if (PADDING_NOPADDING == padding) {
+    EVP_CIPHER_CTX_set_padding(context, 0);
+  } else if (PADDING_PKCS5PADDING == padding){
+    EVP_CIPHER_CTX_set_padding(context, 1);
+  }
+}
+
+static int sameKey(CipherContext* ctx, uint8_t* key, int keyLength) {
+  if (NULL == ctx->key || NULL == ctx->aesmbCtx
+      || ctx->keyLength != keyLength) {
+    return 0;
+  }
+  uint8_t diff = 0;
+  int i;
+  for (i = 0; i < keyLength; i++) {
+    diff |= ctx->key[i] ^ key[i];
+  }
+  return diff == 0;
+}
+
 long init(JNIEnv* env, int forEncryption, signed char* nativeKey, int keyLength, signed char* nativeIv,
     int ivLength, int padding , long oldContext, int* loadLibraryResult) {
-  // Load libcrypto.so, if error, throw java exception
-  if (!loadLibrary(HADOOP_CRYPTO_LIBRARY)) {
+  // libcrypto.so and libaesmb.so are loaded once per process by the
+  // dispatch registry
+  const AesMbDispatch* dispatch = aesmb_dispatch();
+  if (NULL == dispatch->cryptoHandle) {
     *loadLibraryResult = -1;
     return 0;
   }
 
-  // load libaesmb.so, if error, print debug message
-  void* handle = loadLibrary(HADOOP_AESMB_LIBRARY);
+  void* handle = dispatch->handle;
   if (NULL == handle) {
     *loadLibraryResult = -2;
   }
 
-  // cleanup error
-  cleanDLError();
-
   if (oldContext != NULL) {
-    destroyCipherContext((CipherContext*)oldContext);
+    CipherContext* old = (CipherContext*) oldContext;
+    if (sameKey(old, (uint8_t*) nativeKey, keyLength) && ivLength == BLOCKSIZE
+        && old->aesmbCtx->handle == handle) {
+      // same key: keep both key schedules, only the lane IVs change
+      aesmb_stream_reset(old);
+      aesmb_ivinit(old, (uint8_t*) nativeIv, ivLength);
+      EVP_CIPHER_CTX* context = old->opensslCtx;
+      if (context->encrypt == forEncryption) {
+        opensslResetIv(context, old, 0);
+      } else {
+        opensslResetContext(forEncryption, context, old);
+      }
+      setPadding(context, padding);
+      return oldContext;
+    }
+    destroyCipherContext(old);
   }
 
   // init all context
   CipherContext* ctx = createCipherContextMB(handle, nativeKey, keyLength, nativeIv, ivLength);
+  if (NULL == ctx) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
   // init openssl context, by using localized key & iv
-  EVP_CIPHER_CTX_init(ctx->opensslCtx);
   if (-1 == opensslResetContext(forEncryption, ctx->opensslCtx, ctx)) {
     destroyCipherContext(ctx);
     THROW(env, "java/lang/IllegalArgumentException", "unsupportted key size");
     return 0;
   }
-  if (PADDING_NOPADDING == padding) {
-    EVP_CIPHER_CTX_set_padding(ctx->opensslCtx, 0);
-  } else if (PADDING_PKCS5PADDING == padding){
-    EVP_CIPHER_CTX_set_padding(ctx->opensslCtx, 1);
-  }
+  setPadding(ctx->opensslCtx, padding);
   return (long)ctx;
 }
 
@@ -482,7 +466,13 @@ void reset(CipherContext* cipherContext, uint8_t* nativeKey, uint8_t* nativeIv)
     aesmb_keyivinit(cipherContext, nativeKey, cipherContext->keyLength, (uint8_t*)nativeIv, cipherContext->ivLength);
 
     EVP_CIPHER_CTX * ctx = (EVP_CIPHER_CTX *)(cipherContext->opensslCtx);
-    opensslResetContext(ctx->encrypt, ctx, cipherContext);
+    if (NULL == nativeKey) {
+      // the lane IVs in cipherContext are never advanced, restoring the
+      // openssl IV is all a new message needs
+      opensslResetIv(ctx, cipherContext, 0);
+    } else {
+      opensslResetContext(ctx->encrypt, ctx, cipherContext);
+    }
 }
 
 int opensslEncrypt(EVP_CIPHER_CTX* ctx, unsigned char* output, int* outLength, unsigned char* input, int inLength) {
@@ -547,9 +537,17 @@ int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength
   }
 
   if (ctx->encrypt == ENCRYPTION) {
+    // the wide kernel is only worth it when every lane gets a block, and
+    // only allowed when the readers are known to take the 16 lane header
+    int lanes = aesCtx->lanes;
+    if (lanes > PARALLEL_LEVEL
+        && (!aesmb_wide_output() || inputLength < lanes * BLOCKSIZE)) {
+      lanes = PARALLEL_LEVEL;
+    }
+
     if (aesEnabled) {
       // try to apply multi-buffer optimization
-      int encrypted = aesmb_encrypt(cipherContext, input, inputLength, output, &outLength);
+      int encrypted = aesmb_encrypt(cipherContext, input, inputLength, output, &outLength, lanes);
       if (encrypted < 0) {
       // reportError(env, "AES multi-buffer encryption failed.");
         return 0;
@@ -566,7 +564,7 @@ int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength
     opensslEncrypt(ctx, output, &outLengthFinal, input, inputLength);
 
     if (aesmbApplied) {
-      header[0] = 1; // enabled
+      header[0] = lanes / PARALLEL_LEVEL; // enabled, 1 for 8 lanes, 2 for 16
       header[1] = outLengthFinal - inputLength; // padding
     } else {
       header[0] = 0;
@@ -576,8 +574,12 @@ int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength
     // read custom header
     if (header[0]) {
       int padding = (int) header[1];
+      int lanes = header[0] * PARALLEL_LEVEL;
+      if (lanes > AESMB_MAX_LANES) {
+        return 0;
+      }
       if (aesEnabled) {
-        int decrypted = aesmb_decrypt(cipherContext, input, inputLength - padding, output, &outLengthFinal);
+        int decrypted = aesmb_decrypt(cipherContext, input, inputLength - padding, output, &outLengthFinal, lanes);
         if (decrypted < 0) {
         // todo?
         // reportError(env, "Data can not be decrypted correctly");
@@ -589,12 +591,12 @@ int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength
         output += outLengthFinal;
         outLength += outLengthFinal;
       } else {
-        int step = aesmb_streamlength(inputLength - padding);
+        int step = aesmb_streamlength(inputLength - padding, lanes);
         outLength = 0;
         int i;
-        for (i = 0; i < PARALLEL_LEVEL; i++) {
+        for (i = 0; i < lanes; i++) {
           //reset open ssl context
-          opensslResetContextMB(ctx->encrypt, ctx, cipherContext, i);
+          opensslResetIv(ctx, cipherContext, i);
           //clear padding, since multi-buffer AES did not have padding
           EVP_CIPHER_CTX_set_padding(ctx, 0);
           //decrypt using open ssl
@@ -609,7 +611,7 @@ int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength
     }
 
     //reset open ssl context
-    opensslResetContext(ctx->encrypt, ctx, cipherContext);
+    opensslResetIv(ctx, cipherContext, 0);
     //enable padding, the last buffer need padding
     EVP_CIPHER_CTX_set_padding(ctx, 1);
     //decrypt using open ssl
@@ -26,7 +26,16 @@
 
 long init(JNIEnv* env, int forEncryption, signed char* nativeKey, int keyLength, signed char* nativeIv,
     int ivLength, int padding , long oldContext, int* loadLibraryResult);
+int aesmb_keyexp(CipherContext* ctx, int forEncryption);
+CipherContext* createCipherContextMB(void* handle, signed char* key, int keylen, signed char* iv, int ivlen);
+int aesmb_encrypt(CipherContext* ctx, uint8_t* input, int inputLength,
+    uint8_t* output, int* outputLength, int lanes);
+int aesmb_decrypt(CipherContext* ctx, uint8_t* input, int inputLength,
+    uint8_t* output, int* outputLength, int lanes);
 void reset(CipherContext* cipherContext, uint8_t* nativeKey, uint8_t* nativeIv);
+int opensslResetContext(int forEncryption, EVP_CIPHER_CTX* context, CipherContext* cipherContext);
+int opensslResetContextMB(int forEncryption, EVP_CIPHER_CTX* context,
+    CipherContext* cipherContext, int count);
 int bufferCrypt(CipherContext* cipherContext, const char* input, int inputLength, char* output);
 
 #endif
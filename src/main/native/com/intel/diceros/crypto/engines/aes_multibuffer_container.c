@@ -0,0 +1,352 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+#include "aes_multibuffer.h"
+#include "aes_multibuffer_container.h"
+
+#define BLOCKSIZE 16
+
+static uint64_t getLong(const uint8_t* p) {
+  uint64_t value = 0;
+  int i;
+  for (i = 0; i < 8; i++) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+static void putLong(uint8_t* p, uint64_t value) {
+  int i;
+  for (i = 7; i >= 0; i--) {
+    p[i] = (uint8_t) value;
+    value >>= 8;
+  }
+}
+
+int aesmb_container_parse(const uint8_t* input, int inputLength,
+    ContainerInfo* info) {
+  if (inputLength < CONTAINER_HEADER_LENGTH
+      || (input[0] & 0xc0) != CONTAINER_MARKER) {
+    return -1;
+  }
+  info->lanes = input[1];
+  info->chunkSize = ((input[2] << 8) | input[3]) * 1024;
+  info->plainLength = getLong(input + 4);
+  if ((input[0] & ~CONTAINER_MARKER) != CONTAINER_VERSION
+      || (info->lanes != PARALLEL_LEVEL && info->lanes != AESMB_MAX_LANES)
+      || info->chunkSize == 0 || info->chunkSize > CONTAINER_MAX_CHUNK_SIZE
+      || input[12] || input[13] || input[14] || input[15]) {
+    return -2;
+  }
+  return 0;
+}
+
+uint64_t aesmb_container_length(uint64_t plainLength) {
+  return CONTAINER_HEADER_LENGTH + (plainLength + BLOCKSIZE - 1)
+      / BLOCKSIZE * BLOCKSIZE;
+}
+
+/*
+ * The lane IVs of a chunk: the counter blocks IV ^ (chunk * lanes + i)
+ * encrypted under the key. ivCtx is a keyed openssl encryption context, only
+ * used without multi-buffer support.
+ */
+static void deriveIvs(CipherContext* ctx, EVP_CIPHER_CTX* ivCtx,
+    uint64_t chunk, int lanes, uint8_t* ivs) {
+  static const uint8_t zero[BLOCKSIZE];
+  uint8_t counters[AESMB_MAX_LANES * BLOCKSIZE];
+  int i, len;
+
+  for (i = 0; i < lanes; i++) {
+    uint8_t* counter = counters + i * BLOCKSIZE;
+    uint8_t index[8];
+    int j;
+    memcpy(counter, ctx->iv, BLOCKSIZE);
+    putLong(index, chunk * lanes + i);
+    for (j = 0; j < 8; j++) {
+      counter[8 + j] ^= index[j];
+    }
+  }
+
+  if (ctx->aesmbCtx->aesEnabled) {
+    // CBC over a zero block is E(K, IV), eight lanes per call
+    sAesData_x8 data;
+    data.keysched = ctx->aesmbCtx->encryptKeysched;
+    data.numblocks = 1;
+    for (i = 0; i < lanes; i++) {
+      data.inbuf[i % PARALLEL_LEVEL] = (uint8_t*) zero;
+      data.outbuf[i % PARALLEL_LEVEL] = ivs + i * BLOCKSIZE;
+      data.iv[i % PARALLEL_LEVEL] = counters + i * BLOCKSIZE;
+      if (i % PARALLEL_LEVEL == PARALLEL_LEVEL - 1) {
+        ctx->aesmbCtx->efunc(&data);
+      }
+    }
+  } else {
+    for (i = 0; i < lanes; i++) {
+      EVP_EncryptInit_ex(ivCtx, NULL, NULL, NULL, counters + i * BLOCKSIZE);
+      EVP_CIPHER_CTX_set_padding(ivCtx, 0);
+      EVP_EncryptUpdate(ivCtx, ivs + i * BLOCKSIZE, &len, zero, BLOCKSIZE);
+    }
+  }
+}
+
+static void encryptChunk(CipherContext* ctx, const uint8_t* input,
+    int blocks, int lanes, const uint8_t* ivs, uint8_t* output) {
+  sAesContext* aesCtx = ctx->aesmbCtx;
+  EVP_CIPHER_CTX* context = ctx->opensslCtx;
+  int laneBlocks = blocks / lanes;
+  int laneLength = laneBlocks * BLOCKSIZE;
+  int tail = (blocks - laneBlocks * lanes) * BLOCKSIZE;
+  uint8_t iv[AESMB_MAX_LANES * BLOCKSIZE];
+  int i, len;
+
+  memcpy(iv, ivs, lanes * BLOCKSIZE);
+  if (laneBlocks > 0 && aesCtx->aesEnabled) {
+    if (lanes == AESMB_MAX_LANES) {
+      sAesData_x16 data;
+      data.keysched = aesCtx->encryptKeysched;
+      data.numblocks = laneBlocks;
+      for (i = 0; i < lanes; i++) {
+        data.inbuf[i] = (uint8_t*) input + i * laneLength;
+        data.outbuf[i] = output + i * laneLength;
+        data.iv[i] = iv + i * BLOCKSIZE;
+      }
+      aesCtx->efunc16(&data);
+    } else {
+      sAesData_x8 data;
+      data.keysched = aesCtx->encryptKeysched;
+      data.numblocks = laneBlocks;
+      for (i = 0; i < lanes; i++) {
+        data.inbuf[i] = (uint8_t*) input + i * laneLength;
+        data.outbuf[i] = output + i * laneLength;
+        data.iv[i] = iv + i * BLOCKSIZE;
+      }
+      aesCtx->efunc(&data);
+    }
+  } else if (laneBlocks > 0) {
+    for (i = 0; i < lanes; i++) {
+      EVP_EncryptInit_ex(context, NULL, NULL, NULL, ivs + i * BLOCKSIZE);
+      EVP_CIPHER_CTX_set_padding(context, 0);
+      EVP_EncryptUpdate(context, output + i * laneLength, &len,
+          input + i * laneLength, laneLength);
+    }
+  }
+
+  if (tail > 0) {
+    const uint8_t* chain = laneBlocks > 0 ? output + laneLength - BLOCKSIZE :
+        ivs;
+    EVP_EncryptInit_ex(context, NULL, NULL, NULL, chain);
+    EVP_CIPHER_CTX_set_padding(context, 0);
+    EVP_EncryptUpdate(context, output + lanes * laneLength, &len,
+        input + lanes * laneLength, tail);
+  }
+}
+
+int aesmb_container_seal(CipherContext* ctx, const uint8_t* input,
+    int inputLength, int chunkSize, uint8_t* output) {
+  int lanes = ctx->aesmbCtx->aesEnabled ? ctx->aesmbCtx->lanes :
+      PARALLEL_LEVEL;
+  uint8_t ivs[AESMB_MAX_LANES * BLOCKSIZE];
+  uint8_t* padded = NULL;
+  int paddedLength = 0;
+  uint64_t chunk;
+  int offset;
+
+  if (inputLength < 0 || inputLength > 0x7fffffff - 2 * BLOCKSIZE
+      || chunkSize <= 0 || chunkSize % 1024 != 0
+      || chunkSize > CONTAINER_MAX_CHUNK_SIZE) {
+    return -1;
+  }
+  if (ctx->aesmbCtx->aesEnabled && aesmb_keyexp(ctx, ENCRYPTION) != 0) {
+    return -1;
+  }
+
+  output[0] = CONTAINER_MARKER | CONTAINER_VERSION;
+  output[1] = lanes;
+  output[2] = (chunkSize / 1024) >> 8;
+  output[3] = chunkSize / 1024;
+  putLong(output + 4, inputLength);
+  memset(output + 12, 0, 4);
+  output += CONTAINER_HEADER_LENGTH;
+
+  for (chunk = 0, offset = 0; offset < inputLength; chunk++,
+      offset += chunkSize) {
+    int length = inputLength - offset < chunkSize ? inputLength - offset :
+        chunkSize;
+    int blocks = (length + BLOCKSIZE - 1) / BLOCKSIZE;
+    const uint8_t* in = input + offset;
+    if (length % BLOCKSIZE != 0) {
+      // only the last chunk, the lanes read whole blocks
+      paddedLength = blocks * BLOCKSIZE;
+      padded = (uint8_t*) calloc(1, paddedLength);
+      if (NULL == padded) {
+        return -1;
+      }
+      memcpy(padded, in, length);
+      in = padded;
+    }
+    deriveIvs(ctx, ctx->opensslCtx, chunk, lanes, ivs);
+    encryptChunk(ctx, in, blocks, lanes, ivs, output + offset);
+  }
+
+  if (NULL != padded) {
+    memset(padded, 0, paddedLength);
+    free(padded);
+  }
+  memset(ivs, 0, sizeof(ivs));
+  return (int) aesmb_container_length(inputLength);
+}
+
+static void decryptBlocks(CipherContext* ctx, const uint8_t* chain,
+    const uint8_t* input, int blocks, uint8_t* output) {
+  uint8_t iv[BLOCKSIZE];
+  int len;
+
+  if (ctx->aesmbCtx->aesEnabled) {
+    sAesData data;
+    memcpy(iv, chain, BLOCKSIZE);
+    data.keysched = ctx->aesmbCtx->decryptKeysched;
+    data.numblocks = blocks;
+    data.inbuf = (uint8_t*) input;
+    data.outbuf = output;
+    data.iv = iv;
+    ctx->aesmbCtx->dfunc(&data);
+  } else {
+    EVP_DecryptInit_ex(ctx->opensslCtx, NULL, NULL, NULL, chain);
+    EVP_CIPHER_CTX_set_padding(ctx->opensslCtx, 0);
+    EVP_DecryptUpdate(ctx->opensslCtx, output, &len, input,
+        blocks * BLOCKSIZE);
+  }
+}
+
+/*
+ * Decrypt the blocks [first, last) of a chunk of the given blocks, every
+ * lane slice and the tail start from their own chaining value.
+ */
+static void decryptChunk(CipherContext* ctx, const uint8_t* input,
+    int blocks, int lanes, const uint8_t* ivs, int first, int last,
+    uint8_t* output) {
+  int laneBlocks = blocks / lanes;
+  int run;
+
+  for (run = 0; run <= lanes; run++) {
+    int start = run * laneBlocks;
+    int end = run == lanes ? blocks : start + laneBlocks;
+    const uint8_t* chain;
+    if (run == lanes) {
+      chain = laneBlocks > 0 ? input + (laneBlocks - 1) * BLOCKSIZE : ivs;
+    } else {
+      chain = ivs + run * BLOCKSIZE;
+    }
+    if (start < first) {
+      start = first;
+    }
+    if (end > last) {
+      end = last;
+    }
+    if (start >= end) {
+      continue;
+    }
+    if (start > run * laneBlocks) {
+      chain = input + (start - 1) * BLOCKSIZE;
+    }
+    decryptBlocks(ctx, chain, input + start * BLOCKSIZE, end - start,
+        output + (start - first) * BLOCKSIZE);
+  }
+}
+
+int aesmb_container_open(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint64_t position, int length, uint8_t* output) {
+  ContainerInfo info;
+  EVP_CIPHER_CTX ivCtx;
+  uint8_t ivs[AESMB_MAX_LANES * BLOCKSIZE];
+  uint8_t block[BLOCKSIZE];
+  uint64_t end = position + length;
+  uint64_t chunk;
+
+  if (aesmb_container_parse(input, inputLength, &info) != 0 || length < 0
+      || position > info.plainLength || length > info.plainLength - position
+      || (uint64_t) inputLength < CONTAINER_HEADER_LENGTH
+          + (end + BLOCKSIZE - 1) / BLOCKSIZE * BLOCKSIZE) {
+    return -1;
+  }
+  if (length == 0) {
+    return 0;
+  }
+
+  int aesEnabled = ctx->aesmbCtx->aesEnabled;
+  if (aesEnabled && (aesmb_keyexp(ctx, ENCRYPTION) != 0
+      || aesmb_keyexp(ctx, DECRYPTION) != 0)) {
+    return -1;
+  }
+  if (!aesEnabled) {
+    // the IVs need the encryption direction of the key
+    EVP_CIPHER_CTX_init(&ivCtx);
+    EVP_EncryptInit_ex(&ivCtx, getCipher(MODE_CBC, ctx->keyLength), NULL,
+        ctx->key, NULL);
+  }
+  input += CONTAINER_HEADER_LENGTH;
+
+  for (chunk = position / info.chunkSize;
+      chunk * info.chunkSize < end; chunk++) {
+    uint64_t chunkStart = chunk * info.chunkSize;
+    uint64_t chunkLength = info.plainLength - chunkStart < info.chunkSize ?
+        info.plainLength - chunkStart : info.chunkSize;
+    int blocks = (int) ((chunkLength + BLOCKSIZE - 1) / BLOCKSIZE);
+    // the requested bytes of this chunk
+    int from = position > chunkStart ? (int) (position - chunkStart) : 0;
+    int to = end < chunkStart + chunkLength ? (int) (end - chunkStart) :
+        (int) chunkLength;
+    int first = from / BLOCKSIZE;
+    int last = (to + BLOCKSIZE - 1) / BLOCKSIZE;
+    const uint8_t* in = input + chunkStart;
+
+    deriveIvs(ctx, &ivCtx, chunk, info.lanes, ivs);
+    if (from % BLOCKSIZE != 0 || (first == last - 1 && to % BLOCKSIZE != 0)) {
+      int skip = from % BLOCKSIZE;
+      int take = (first + 1) * BLOCKSIZE < to ?
+          BLOCKSIZE - skip : to - first * BLOCKSIZE - skip;
+      decryptChunk(ctx, in, blocks, info.lanes, ivs, first, first + 1, block);
+      memcpy(output, block + skip, take);
+      output += take;
+      first++;
+    }
+    if (first < last && to % BLOCKSIZE != 0) {
+      last--;
+    }
+    if (first < last) {
+      decryptChunk(ctx, in, blocks, info.lanes, ivs, first, last, output);
+      output += (last - first) * BLOCKSIZE;
+    }
+    if (last * BLOCKSIZE < to) {
+      decryptChunk(ctx, in, blocks, info.lanes, ivs, last, last + 1, block);
+      memcpy(output, block, to - last * BLOCKSIZE);
+      output += to - last * BLOCKSIZE;
+    }
+  }
+
+  if (!aesEnabled) {
+    EVP_CIPHER_CTX_cleanup(&ivCtx);
+  }
+  memset(ivs, 0, sizeof(ivs));
+  memset(block, 0, sizeof(block));
+  return length;
+}
@@ -0,0 +1,79 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_MULTIBUFFER_CONTAINER_H
+#define __AES_MULTIBUFFER_CONTAINER_H
+
+#include "aes_utils.h"
+
+/*
+ * Multi-buffer CBC container, version 1.
+ *
+ * The 16 byte header holds CONTAINER_MARKER | version, the lane count, the
+ * chunk size in KB (2 bytes) and the plaintext length (8 bytes), both big
+ * endian, and 4 zero bytes. The plaintext is cut into chunks, every chunk is
+ * encrypted on its own and its ciphertext sits at the same offset after the
+ * header, so a byte range is decrypted from the chunks it touches only.
+ *
+ * A chunk of n blocks gives n / lanes blocks to each lane, lane i encrypts
+ * slice i of the chunk, and the remaining blocks continue the chain of lane 0.
+ * The IV of lane i in chunk c is E(K, IV ^ (c * lanes + i)), the last chunk
+ * is zero padded to a whole block.
+ *
+ * header[0] of the older formats is 0 to 2 or has STREAM_MARKER set, so all
+ * of them can be told apart by the first byte.
+ */
+#define CONTAINER_MARKER 0x40
+#define CONTAINER_VERSION 1
+#define CONTAINER_HEADER_LENGTH 16
+#define CONTAINER_MAX_CHUNK_SIZE (1024 * 1024)
+
+typedef struct _ContainerInfo {
+  int lanes;
+  int chunkSize;
+  uint64_t plainLength;
+} ContainerInfo;
+
+/*
+ * Read the header of a container, returns 0, or -1 if input is no container
+ * and -2 if the version or the parameters are not supported.
+ */
+int aesmb_container_parse(const uint8_t* input, int inputLength,
+    ContainerInfo* info);
+
+/*
+ * The container length of plainLength bytes.
+ */
+uint64_t aesmb_container_length(uint64_t plainLength);
+
+/*
+ * Encrypt inputLength bytes into a container of chunkSize byte chunks,
+ * chunkSize is a multiple of 1024. Returns the container length or -1.
+ */
+int aesmb_container_seal(CipherContext* ctx, const uint8_t* input,
+    int inputLength, int chunkSize, uint8_t* output);
+
+/*
+ * Decrypt length plaintext bytes from position on of the container in input.
+ * Returns length, or -1 if the range is outside the container or the
+ * container is damaged.
+ */
+int aesmb_container_open(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint64_t position, int length, uint8_t* output);
+
+#endif
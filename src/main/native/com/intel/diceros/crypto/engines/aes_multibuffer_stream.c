@@ -0,0 +1,467 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+#include "aes_multibuffer.h"
+#include "aes_multibuffer_stream.h"
+
+#define BLOCKSIZE 16
+#define STREAM_MAX_SEGMENT (AESMB_MAX_LANES * STREAM_LANE_SEGMENT)
+
+#define STREAM_IDLE 0   // nothing written or parsed yet
+#define STREAM_MB 1     // segments of all lanes
+#define STREAM_PLAIN 2  // header[0] == 0: one openssl CBC stream
+#define STREAM_LEGACY 3 // one-shot input, decrypted by bufferCrypt at the end
+
+typedef struct _AesMbStream {
+  int state;
+  int headerLength;
+  uint8_t header[HEADER_LENGTH];
+  int lanes;
+  int laneSegment;
+  int segment;
+  uint8_t chain[AESMB_MAX_LANES * BLOCKSIZE];
+  // one-shot input kept until the final call
+  uint8_t* legacy;
+  int legacyLength;
+  int legacyCapacity;
+  int pendingLength;
+  uint8_t pending[STREAM_MAX_SEGMENT];
+} AesMbStream;
+
+static void freeStream(void* value) {
+  AesMbStream* stream = (AesMbStream*) value;
+  if (stream->legacy != NULL) {
+    memset(stream->legacy, 0, stream->legacyCapacity);
+    free(stream->legacy);
+  }
+  memset(stream, 0, sizeof(AesMbStream));
+  free(stream);
+}
+
+static AesMbStream* getStream(CipherContext* ctx) {
+  if (NULL == ctx->stream) {
+    AesMbStream* stream = (AesMbStream*) calloc(1, sizeof(AesMbStream));
+    if (NULL == stream) {
+      return NULL;
+    }
+    ctx->stream = stream;
+    ctx->freeStream = freeStream;
+  }
+  return (AesMbStream*) ctx->stream;
+}
+
+void aesmb_stream_reset(CipherContext* ctx) {
+  AesMbStream* stream = (AesMbStream*) ctx->stream;
+  if (NULL != stream) {
+    memset(stream->pending, 0, stream->pendingLength);
+    if (stream->legacy != NULL) {
+      memset(stream->legacy, 0, stream->legacyLength);
+    }
+    stream->state = STREAM_IDLE;
+    stream->headerLength = 0;
+    stream->pendingLength = 0;
+    stream->legacyLength = 0;
+  }
+}
+
+static int isEncryption(CipherContext* ctx) {
+  return ctx->opensslCtx->encrypt == ENCRYPTION;
+}
+
+/*
+ * Restart the keyed openssl context at iv, the key schedule is kept.
+ */
+static void opensslRestart(CipherContext* ctx, const uint8_t* iv,
+    int padding) {
+  EVP_CIPHER_CTX* context = ctx->opensslCtx;
+  cryptInit cryptInitFunc = getCryptInitFunc(context->encrypt);
+  cryptInitFunc(context, NULL, NULL, NULL, iv);
+  EVP_CIPHER_CTX_set_padding(context, padding);
+}
+
+static void startSegments(AesMbStream* stream, CipherContext* ctx,
+    int lanes, int laneSegment) {
+  stream->state = STREAM_MB;
+  stream->lanes = lanes;
+  stream->laneSegment = laneSegment;
+  stream->segment = lanes * laneSegment;
+  memcpy(stream->chain, ctx->iv, lanes * BLOCKSIZE);
+}
+
+static void encryptSegment(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, uint8_t* output) {
+  sAesContext* aesCtx = ctx->aesmbCtx;
+  int lanes = stream->lanes;
+  int laneSegment = stream->laneSegment;
+  uint8_t iv[AESMB_MAX_LANES * BLOCKSIZE];
+  int i;
+
+  memcpy(iv, stream->chain, lanes * BLOCKSIZE);
+  if (lanes == AESMB_MAX_LANES) {
+    sAesData_x16 data;
+    data.keysched = aesCtx->encryptKeysched;
+    data.numblocks = laneSegment / BLOCKSIZE;
+    for (i = 0; i < lanes; i++) {
+      data.inbuf[i] = (uint8_t*) input + i * laneSegment;
+      data.outbuf[i] = output + i * laneSegment;
+      data.iv[i] = iv + i * BLOCKSIZE;
+    }
+    aesCtx->efunc16(&data);
+  } else {
+    sAesData_x8 data;
+    data.keysched = aesCtx->encryptKeysched;
+    data.numblocks = laneSegment / BLOCKSIZE;
+    for (i = 0; i < lanes; i++) {
+      data.inbuf[i] = (uint8_t*) input + i * laneSegment;
+      data.outbuf[i] = output + i * laneSegment;
+      data.iv[i] = iv + i * BLOCKSIZE;
+    }
+    aesCtx->efunc(&data);
+  }
+  // every lane chains from the last ciphertext block of its slice
+  for (i = 0; i < lanes; i++) {
+    memcpy(stream->chain + i * BLOCKSIZE,
+        output + (i + 1) * laneSegment - BLOCKSIZE, BLOCKSIZE);
+  }
+}
+
+static int decryptSegment(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, uint8_t* output) {
+  sAesContext* aesCtx = ctx->aesmbCtx;
+  int laneSegment = stream->laneSegment;
+  uint8_t iv[BLOCKSIZE];
+  uint8_t next[BLOCKSIZE];
+  int i, len;
+
+  for (i = 0; i < stream->lanes; i++) {
+    const uint8_t* in = input + i * laneSegment;
+    uint8_t* out = output + i * laneSegment;
+    uint8_t* chain = stream->chain + i * BLOCKSIZE;
+    // saved first, the input may be overwritten by the output
+    memcpy(next, in + laneSegment - BLOCKSIZE, BLOCKSIZE);
+    if (aesCtx->aesEnabled) {
+      sAesData data;
+      memcpy(iv, chain, BLOCKSIZE);
+      data.keysched = aesCtx->decryptKeysched;
+      data.numblocks = laneSegment / BLOCKSIZE;
+      data.inbuf = (uint8_t*) in;
+      data.outbuf = out;
+      data.iv = iv;
+      aesCtx->dfunc(&data);
+    } else {
+      opensslRestart(ctx, chain, 0);
+      if (!EVP_DecryptUpdate(ctx->opensslCtx, out, &len, in, laneSegment)
+          || len != laneSegment) {
+        return -1;
+      }
+    }
+    memcpy(chain, next, BLOCKSIZE);
+  }
+  return 0;
+}
+
+/*
+ * Run the segments of input through the lanes, keeping the rest in pending.
+ * Decryption holds back the last segment, it may be the padded tail.
+ */
+static int processSegments(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, int inputLength, uint8_t* output) {
+  int encrypt = isEncryption(ctx);
+  int holdBack = encrypt ? 0 : 1;
+  int segment = stream->segment;
+  int written = 0;
+
+  if (stream->pendingLength > 0
+      && stream->pendingLength + inputLength >= segment + holdBack) {
+    int take = segment - stream->pendingLength;
+    memcpy(stream->pending + stream->pendingLength, input, take);
+    input += take;
+    inputLength -= take;
+    if (encrypt) {
+      encryptSegment(stream, ctx, stream->pending, output);
+    } else if (decryptSegment(stream, ctx, stream->pending, output) != 0) {
+      return -1;
+    }
+    stream->pendingLength = 0;
+    written += segment;
+  }
+  if (stream->pendingLength == 0) {
+    while (inputLength >= segment + holdBack) {
+      if (encrypt) {
+        encryptSegment(stream, ctx, input, output + written);
+      } else if (decryptSegment(stream, ctx, input, output + written) != 0) {
+        return -1;
+      }
+      input += segment;
+      inputLength -= segment;
+      written += segment;
+    }
+  }
+  memcpy(stream->pending + stream->pendingLength, input, inputLength);
+  stream->pendingLength += inputLength;
+  return written;
+}
+
+/*
+ * Feed openssl directly, pendingLength counts the bytes openssl holds back.
+ */
+static int plainUpdate(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, int inputLength, uint8_t* output, int written) {
+  EVP_CIPHER_CTX* context = ctx->opensslCtx;
+  int len = 0;
+
+  if (inputLength > 0) {
+    cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(context->encrypt);
+    if (!cryptUpdateFunc(context, output, &len, input, inputLength)) {
+      return -1;
+    }
+    stream->pendingLength += inputLength - len;
+  }
+  return written + len;
+}
+
+static int encryptUpdate(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, int inputLength, uint8_t* output) {
+  sAesContext* aesCtx = ctx->aesmbCtx;
+  int written = 0;
+  int len;
+
+  if (stream->state == STREAM_IDLE) {
+    if (!aesCtx->aesEnabled) {
+      // the one-shot format without lanes is a plain CBC stream already
+      stream->state = STREAM_PLAIN;
+      opensslRestart(ctx, ctx->iv, 1);
+      output[0] = 0;
+      output[1] = 0;
+      output += HEADER_LENGTH;
+      written = HEADER_LENGTH;
+    } else {
+      int lanes = aesCtx->lanes;
+      if (stream->pendingLength + inputLength < lanes * STREAM_LANE_SEGMENT) {
+        // may still end up as a one-shot message
+        memcpy(stream->pending + stream->pendingLength, input, inputLength);
+        stream->pendingLength += inputLength;
+        return 0;
+      }
+      if (aesmb_keyexp(ctx, ENCRYPTION) != 0) {
+        return -1;
+      }
+      startSegments(stream, ctx, lanes, STREAM_LANE_SEGMENT);
+      output[0] = STREAM_MARKER | (lanes / PARALLEL_LEVEL);
+      output[1] = STREAM_LANE_SEGMENT / 1024;
+      output += HEADER_LENGTH;
+      written = HEADER_LENGTH;
+    }
+  }
+
+  if (stream->state == STREAM_PLAIN) {
+    return plainUpdate(stream, ctx, input, inputLength, output, written);
+  }
+  len = processSegments(stream, ctx, input, inputLength, output);
+  return len < 0 ? -1 : written + len;
+}
+
+static int appendLegacy(AesMbStream* stream, const uint8_t* input,
+    int inputLength) {
+  if (stream->legacyLength + inputLength > stream->legacyCapacity) {
+    int capacity = stream->legacyCapacity * 2;
+    if (capacity < stream->legacyLength + inputLength) {
+      capacity = stream->legacyLength + inputLength;
+    }
+    uint8_t* legacy = (uint8_t*) realloc(stream->legacy, capacity);
+    if (NULL == legacy) {
+      return -1;
+    }
+    stream->legacy = legacy;
+    stream->legacyCapacity = capacity;
+  }
+  memcpy(stream->legacy + stream->legacyLength, input, inputLength);
+  stream->legacyLength += inputLength;
+  return 0;
+}
+
+static int decryptUpdate(AesMbStream* stream, CipherContext* ctx,
+    const uint8_t* input, int inputLength, uint8_t* output) {
+  while (stream->headerLength < HEADER_LENGTH && inputLength > 0) {
+    stream->header[stream->headerLength++] = *input++;
+    inputLength--;
+  }
+  if (stream->headerLength < HEADER_LENGTH) {
+    return 0;
+  }
+
+  if (stream->state == STREAM_IDLE) {
+    uint8_t flags = stream->header[0];
+    if (flags == 0) {
+      stream->state = STREAM_PLAIN;
+      opensslRestart(ctx, ctx->iv, 1);
+    } else if (flags & STREAM_MARKER) {
+      int lanes = (flags & ~STREAM_MARKER) * PARALLEL_LEVEL;
+      int laneSegment = stream->header[1] * 1024;
+      if ((lanes != PARALLEL_LEVEL && lanes != AESMB_MAX_LANES)
+          || laneSegment == 0 || laneSegment > STREAM_LANE_SEGMENT) {
+        return -1;
+      }
+      if (ctx->aesmbCtx->aesEnabled && aesmb_keyexp(ctx, DECRYPTION) != 0) {
+        return -1;
+      }
+      startSegments(stream, ctx, lanes, laneSegment);
+    } else {
+      stream->state = STREAM_LEGACY;
+      if (appendLegacy(stream, stream->header, HEADER_LENGTH) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  switch (stream->state) {
+  case STREAM_PLAIN:
+    return plainUpdate(stream, ctx, input, inputLength, output, 0);
+  case STREAM_LEGACY:
+    return appendLegacy(stream, input, inputLength);
+  default:
+    return processSegments(stream, ctx, input, inputLength, output);
+  }
+}
+
+int aesmb_stream_update(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint8_t* output) {
+  if (inputLength == 0) {
+    return 0;
+  }
+  AesMbStream* stream = getStream(ctx);
+  if (NULL == stream) {
+    return -1;
+  }
+  if (isEncryption(ctx)) {
+    return encryptUpdate(stream, ctx, input, inputLength, output);
+  }
+  return decryptUpdate(stream, ctx, input, inputLength, output);
+}
+
+/*
+ * CBC with padding over the pending tail, chained from lane 0.
+ */
+static int finishTail(AesMbStream* stream, CipherContext* ctx,
+    uint8_t* output) {
+  EVP_CIPHER_CTX* context = ctx->opensslCtx;
+  int len = 0;
+  int lenFinal;
+
+  if (stream->state == STREAM_MB) {
+    opensslRestart(ctx, stream->chain, 1);
+    cryptUpdate cryptUpdateFunc = getCryptUpdateFunc(context->encrypt);
+    if (stream->pendingLength > 0 && !cryptUpdateFunc(context, output, &len,
+        stream->pending, stream->pendingLength)) {
+      return -1;
+    }
+  }
+  cryptFinal cryptFinalFunc = getCryptFinalFunc(context->encrypt);
+  if (!cryptFinalFunc(context, output + len, &lenFinal)) {
+    return -1;
+  }
+  return len + lenFinal;
+}
+
+static int finish(AesMbStream* stream, CipherContext* ctx, uint8_t* output) {
+  if (isEncryption(ctx)) {
+    if (stream->state == STREAM_IDLE) {
+      // shorter than one segment, written in the one-shot format
+      return bufferCrypt(ctx, (const char*) stream->pending,
+          stream->pendingLength, (char*) output);
+    }
+    return finishTail(stream, ctx, output);
+  }
+
+  if (stream->headerLength == 0) {
+    return 0;
+  }
+  if (stream->headerLength < HEADER_LENGTH) {
+    return -1;
+  }
+  if (stream->state == STREAM_LEGACY) {
+    return bufferCrypt(ctx, (const char*) stream->legacy,
+        stream->legacyLength, (char*) output);
+  }
+  if (stream->state == STREAM_MB && (stream->pendingLength == 0
+      || stream->pendingLength % BLOCKSIZE != 0)) {
+    return -1;
+  }
+  return finishTail(stream, ctx, output);
+}
+
+int aesmb_stream_final(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint8_t* output) {
+  AesMbStream* stream = (AesMbStream*) ctx->stream;
+  int written;
+
+  if (NULL == stream || (stream->state == STREAM_IDLE
+      && stream->headerLength == 0 && stream->pendingLength == 0)) {
+    // the whole message in one call: bufferCrypt straight from the input,
+    // unless it is a stream to decrypt. An empty message stays empty.
+    if (inputLength == 0) {
+      return 0;
+    }
+    if (isEncryption(ctx) || (inputLength >= HEADER_LENGTH
+        && !(input[0] & STREAM_MARKER))) {
+      written = bufferCrypt(ctx, (const char*) input, inputLength,
+          (char*) output);
+      reset(ctx, NULL, NULL);
+      return written;
+    }
+    stream = getStream(ctx);
+    if (NULL == stream) {
+      return -1;
+    }
+  }
+
+  written = aesmb_stream_update(ctx, input, inputLength, output);
+  if (written >= 0) {
+    int len = finish(stream, ctx, output + written);
+    written = len < 0 ? -1 : written + len;
+  }
+  aesmb_stream_reset(ctx);
+  reset(ctx, NULL, NULL);
+  return written;
+}
+
+int aesmb_stream_update_bound(CipherContext* ctx, int inputLength) {
+  AesMbStream* stream = (AesMbStream*) ctx->stream;
+  int bound = inputLength;
+  if (NULL != stream) {
+    bound += stream->pendingLength;
+  }
+  if (isEncryption(ctx) && (NULL == stream || stream->state == STREAM_IDLE)) {
+    bound += HEADER_LENGTH;
+  }
+  return bound;
+}
+
+int aesmb_stream_final_bound(CipherContext* ctx, int inputLength) {
+  AesMbStream* stream = (AesMbStream*) ctx->stream;
+  int bound = aesmb_stream_update_bound(ctx, inputLength);
+  if (isEncryption(ctx)) {
+    bound += BLOCKSIZE;
+  } else if (NULL != stream) {
+    bound += stream->legacyLength;
+  }
+  return bound;
+}
@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_MULTIBUFFER_STREAM_H
+#define __AES_MULTIBUFFER_STREAM_H
+
+#include "aes_utils.h"
+
+/*
+ * Streaming multi-buffer CBC.
+ *
+ * A stream starts with the 2 byte header of bufferCrypt. header[0] is
+ * STREAM_MARKER | lanes / 8 and header[1] the bytes per lane and segment in
+ * KB. The data follows in segments of lanes * laneSegment bytes, lane i
+ * encrypts slice i of every segment and chains from its own previous slice.
+ * The last partial segment is CBC encrypted with PKCS5 padding, chained from
+ * lane 0.
+ *
+ * Messages that end before the first segment is full are written in the
+ * one-shot format of bufferCrypt, and one-shot input is still decrypted, so
+ * both formats can be read by either path.
+ */
+#define STREAM_MARKER 0x80
+#define STREAM_LANE_SEGMENT 4096
+
+/*
+ * Process inputLength bytes, returns the bytes written to output or -1 on
+ * error. The output needs room for aesmb_stream_update_bound bytes.
+ */
+int aesmb_stream_update(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint8_t* output);
+
+/*
+ * Process the last inputLength bytes and finish the message, returns the
+ * bytes written to output or -1 on error (e.g. bad padding). The context is
+ * ready for the next message afterwards.
+ */
+int aesmb_stream_final(CipherContext* ctx, const uint8_t* input,
+    int inputLength, uint8_t* output);
+
+int aesmb_stream_update_bound(CipherContext* ctx, int inputLength);
+int aesmb_stream_final_bound(CipherContext* ctx, int inputLength);
+
+/*
+ * Drop the state of the current message.
+ */
+void aesmb_stream_reset(CipherContext* ctx);
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AES_OPENSSL_H
+#define __AES_OPENSSL_H
+
+#include "aes_utils.h"
+
+#define CRYPT_ERROR_UPDATE -1
+#define CRYPT_ERROR_FINAL -2
+// GCM decryption: the input is shorter than the tag
+#define CRYPT_ERROR_SHORT_INPUT -3
+// GCM decryption: the tag does not match
+#define CRYPT_ERROR_TAG -4
+
+/*
+ * One update of an AESOpensslEngine context over native memory, followed by
+ * the final call if isFinal is set. Returns the bytes written or one of the
+ * CRYPT_ERROR_* codes. No JNI calls are made, so the asynchronous workers
+ * can use it outside of the JVM.
+ */
+int opensslProcess(CipherContext* cipherCtx, unsigned char* output,
+    const unsigned char* input, int inputLength, int isFinal);
+
+#endif
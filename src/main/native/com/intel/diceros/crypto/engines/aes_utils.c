@@ -19,27 +19,123 @@
 #include <string.h>
 #include <stdio.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include "config.h"
 #include "aes_utils.h"
+#ifdef HADOOP_AESMB_LIBRARY
+#include "aes_gcm.h"
+#endif
 
 void* loadLibrary(const char * libname) {
   void *handle = dlopen(libname, RTLD_LAZY | RTLD_GLOBAL);
   return handle;
 }
 
+// contexts kept per thread, the rest goes back to the allocator
+#define ARENA_MAX_FREE 32
+
+typedef struct _ContextArena {
+  CipherContext* head;
+  int count;
+} ContextArena;
+
+static pthread_key_t arenaKey;
+static pthread_once_t arenaOnce = PTHREAD_ONCE_INIT;
+
+static void arenaRelease(void* value) {
+  ContextArena* arena = (ContextArena*) value;
+  while (arena->head != NULL) {
+    CipherContext* ctx = arena->head;
+    arena->head = ctx->nextFree;
+    free(ctx);
+  }
+  free(arena);
+}
+
+static void arenaKeyCreate() {
+  pthread_key_create(&arenaKey, arenaRelease);
+}
+
+static ContextArena* threadArena() {
+  pthread_once(&arenaOnce, arenaKeyCreate);
+  ContextArena* arena = (ContextArena*) pthread_getspecific(arenaKey);
+  if (arena == NULL) {
+    arena = (ContextArena*) calloc(1, sizeof(ContextArena));
+    if (arena != NULL && pthread_setspecific(arenaKey, arena) != 0) {
+      free(arena);
+      arena = NULL;
+    }
+  }
+  return arena;
+}
+
+CipherContext* createCipherContext() {
+  CipherContext* ctx = NULL;
+  ContextArena* arena = threadArena();
+  if (arena != NULL && arena->head != NULL) {
+    // blocks on the free list were wiped by destroyCipherContext
+    ctx = arena->head;
+    arena->head = ctx->nextFree;
+    arena->count--;
+    ctx->nextFree = NULL;
+  } else {
+    void* block = NULL;
+    if (posix_memalign(&block, CACHE_LINE_SIZE, sizeof(CipherContext)) != 0) {
+      return NULL;
+    }
+    ctx = (CipherContext*) block;
+    memset(ctx, 0, sizeof(CipherContext));
+  }
+  ctx->opensslCtx = &ctx->opensslStorage;
+  EVP_CIPHER_CTX_init(ctx->opensslCtx);
+  return ctx;
+}
+
 void destroyCipherContext(CipherContext* ctx) {
   EVP_CIPHER_CTX_cleanup(ctx->opensslCtx);
-  free(ctx->opensslCtx);
-  ctx->opensslCtx = NULL;
-  free(ctx->key);
-  ctx->key = NULL;
-  free(ctx->iv);
-  ctx->iv = NULL;
-
-  // destroy AESMB context
-  free(ctx->aesmbCtx);
-  ctx->aesmbCtx = NULL;
-
-  free(ctx);
+  if (ctx->key != ctx->keyStorage) {
+    free(ctx->key);
+  }
+  if (ctx->iv != ctx->ivStorage) {
+    free(ctx->iv);
+  }
+  if (ctx->stream != NULL) {
+    ctx->freeStream(ctx->stream);
+  }
+  // no key material stays behind on the free list
+  memset(ctx, 0, sizeof(CipherContext));
+
+  ContextArena* arena = threadArena();
+  if (arena != NULL && arena->count < ARENA_MAX_FREE) {
+    ctx->nextFree = arena->head;
+    arena->head = ctx;
+    arena->count++;
+  } else {
+    free(ctx);
+  }
+}
+
+static uint8_t* resizeContextBuffer(uint8_t* buffer, uint8_t* storage,
+    int capacity, int size) {
+  if (buffer != storage) {
+    free(buffer);
+  }
+  if (size <= capacity) {
+    return storage;
+  }
+  return (uint8_t*) malloc(size);
+}
+
+int resizeContextKey(CipherContext* ctx, int keyLength) {
+  ctx->key = resizeContextBuffer(ctx->key, ctx->keyStorage,
+      sizeof(ctx->keyStorage), keyLength);
+  return ctx->key != NULL;
+}
+
+int resizeContextIv(CipherContext* ctx, int ivSize) {
+  ctx->iv = resizeContextBuffer(ctx->iv, ctx->ivStorage,
+      sizeof(ctx->ivStorage), ivSize);
+  return ctx->iv != NULL;
 }
 
 cryptInit getCryptInitFunc(int forEncryption) {
@@ -99,6 +195,13 @@ EVP_CIPHER* getCipher(int mode, int keyLen) {
       return NULL;
     }
   } else if (mode == MODE_GCM) {
+#ifdef HADOOP_AESMB_LIBRARY
+    // prefer the in-tree kernels, they do not depend on the libcrypto version
+    const EVP_CIPHER* cipher = aesmb_gcm_cipher(keyLen);
+    if (cipher != NULL) {
+      return (EVP_CIPHER*) cipher;
+    }
+#endif
     switch (keyLen) {
     case 16:
       return EVP_aes_128_gcm();
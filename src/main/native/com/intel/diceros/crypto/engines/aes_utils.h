@@ -32,6 +32,8 @@
 #endif
 
 #define PARALLEL_LEVEL 8
+// upper bound of the multi-buffer lanes, the lanes in use are picked at runtime
+#define AESMB_MAX_LANES 16
 
 #define ENCRYPTION 1
 #define DECRYPTION 0
@@ -45,31 +47,81 @@
 #define PADDING_PKCS5PADDING 1
 
 typedef void (*EncryptX8)(sAesData_x8* data);
+typedef void (*EncryptX16)(sAesData_x16* data);
+typedef void (*EncryptX8Keys)(sAesKeysData_x8* data);
 typedef void (*DecryptX1)(sAesData* data);
 typedef void (*KeySched)(uint8_t *key, uint8_t *enc_exp_keys);
+typedef void (*GcmPrecomp)(sGcmData* data);
+typedef void (*GcmInit)(sGcmData* data, const uint8_t* iv, uint64_t ivLength);
+typedef int (*GcmAad)(sGcmData* data, const uint8_t* aad, uint64_t length);
+typedef void (*GcmUpdate)(sGcmData* data, uint8_t* out, const uint8_t* in,
+    uint64_t length);
+typedef void (*GcmFinalize)(sGcmData* data, uint8_t* tag);
 
 typedef struct _sAesContext {
   void* handle;
   uint8_t encryptKeysched[16*15];
   uint8_t decryptKeysched[16*15];
   EncryptX8 efunc;
+  EncryptX16 efunc16;
   DecryptX1 dfunc;
+  int lanes; // PARALLEL_LEVEL, or AESMB_MAX_LANES with VAES
   int aesEnabled;
+  // the schedules above are expanded on first use, see aesmb_keyexp
+  int encryptKeyschedReady;
+  int decryptKeyschedReady;
 } sAesContext;
 
+#define CACHE_LINE_SIZE 64
+// key and IV bytes kept inline, longer values fall back to the heap
+#define CONTEXT_KEY_CAPACITY 64
+#define CONTEXT_IV_CAPACITY (16 * AESMB_MAX_LANES)
+
+/*
+ * One cache line aligned block: the pointers below refer to the inline
+ * storage at the end, so a context costs a single allocation which
+ * createCipherContext recycles through a per-thread free list.
+ */
 typedef struct _CipherContext {
   EVP_CIPHER_CTX* opensslCtx;
   uint8_t* key;
   uint8_t  keyLength;
   uint8_t* iv;
   uint8_t  ivLength;
-  sAesContext* aesmbCtx;
-} CipherContext;
+  sAesContext* aesmbCtx; // NULL unless the multi-buffer engine uses it
+  // GCM: tag length set by setTagLen, 0 if the caller handles the tag itself
+  uint8_t  tagLength;
+  // GCM decryption: the trailing bytes which may be the tag are held here
+  uint8_t  tagBuffered;
+  uint8_t  tag[16];
+  struct _CipherContext* nextFree; // arena free list link
+  // streaming multi-buffer CBC state, released through freeStream
+  void* stream;
+  void (*freeStream)(void* stream);
+
+  uint8_t keyStorage[CONTEXT_KEY_CAPACITY];
+  uint8_t ivStorage[CONTEXT_IV_CAPACITY];
+  sAesContext aesmbStorage;
+  EVP_CIPHER_CTX opensslStorage;
+} __attribute__((aligned(CACHE_LINE_SIZE))) CipherContext;
 
 void* loadLibrary(const char* libname);
 
+/*
+ * Returns a zeroed context with an initialized openssl context, or NULL if
+ * out of memory. destroyCipherContext wipes it and hands it back.
+ */
+CipherContext* createCipherContext();
+
 void destroyCipherContext(CipherContext* ctx);
 
+/*
+ * Make room for keyLength key bytes and ivSize IV bytes, returns 0 if out
+ * of memory.
+ */
+int resizeContextKey(CipherContext* ctx, int keyLength);
+int resizeContextIv(CipherContext* ctx, int ivSize);
+
 typedef int (*cryptInit)(EVP_CIPHER_CTX *, const EVP_CIPHER *, ENGINE *,
     const unsigned char *, const unsigned char *);
 typedef int (*cryptUpdate)(EVP_CIPHER_CTX *, unsigned char *, int *,
@@ -0,0 +1,329 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/cmac.h>
+#include "com_intel_diceros.h"
+#include "com/intel/diceros/crypto/engines/aes_utils.h"
+#include "com_intel_diceros_crypto_macs_NativeMac.h"
+
+#define HMAC_SHA1 com_intel_diceros_crypto_macs_NativeMac_HMAC_SHA1
+#define HMAC_SHA256 com_intel_diceros_crypto_macs_NativeMac_HMAC_SHA256
+#define HMAC_SHA512 com_intel_diceros_crypto_macs_NativeMac_HMAC_SHA512
+#define CMAC_AES com_intel_diceros_crypto_macs_NativeMac_CMAC_AES
+#define GMAC_AES com_intel_diceros_crypto_macs_NativeMac_GMAC_AES
+
+#define GMAC_TAG_LENGTH 16
+
+// max bytes processed per GetPrimitiveArrayCritical section
+#define CRITICAL_CHUNK_SIZE (256 * 1024)
+
+/*
+ * Exactly one of the openssl contexts is used, depending on the type. Once
+ * keyed, every context keeps its precomputed key state (the HMAC pads, the
+ * AES key schedule and the CMAC subkeys) until it is keyed again.
+ */
+typedef struct _MacContext {
+  int type;
+  int keyed;
+  HMAC_CTX* hmac;
+  CMAC_CTX* cmac;
+  EVP_CIPHER_CTX* gcm;
+  int gcmIvLength;
+} MacContext;
+
+static const EVP_MD* getDigest(int type) {
+  switch (type) {
+  case HMAC_SHA1:
+    return EVP_sha1();
+  case HMAC_SHA256:
+    return EVP_sha256();
+  case HMAC_SHA512:
+    return EVP_sha512();
+  default:
+    return NULL;
+  }
+}
+
+static void freeMacContext(MacContext* macCtx) {
+  if (macCtx->hmac != NULL) {
+    HMAC_CTX_cleanup(macCtx->hmac);
+    free(macCtx->hmac);
+  }
+  if (macCtx->cmac != NULL) {
+    CMAC_CTX_free(macCtx->cmac);
+  }
+  if (macCtx->gcm != NULL) {
+    EVP_CIPHER_CTX_cleanup(macCtx->gcm);
+    free(macCtx->gcm);
+  }
+  free(macCtx);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_create(
+    JNIEnv *env, jclass clazz, jint type) {
+  MacContext* macCtx = (MacContext*) calloc(1, sizeof(MacContext));
+  if (macCtx == NULL) {
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  macCtx->type = type;
+  if (getDigest(type) != NULL) {
+    macCtx->hmac = (HMAC_CTX*) malloc(sizeof(HMAC_CTX));
+    if (macCtx->hmac != NULL) {
+      HMAC_CTX_init(macCtx->hmac);
+    }
+  } else if (type == CMAC_AES) {
+    macCtx->cmac = CMAC_CTX_new();
+  } else if (type == GMAC_AES) {
+    macCtx->gcm = (EVP_CIPHER_CTX*) malloc(sizeof(EVP_CIPHER_CTX));
+    if (macCtx->gcm != NULL) {
+      EVP_CIPHER_CTX_init(macCtx->gcm);
+    }
+  } else {
+    free(macCtx);
+    THROW(env, "java/lang/IllegalArgumentException", "Unknown mac type");
+    return 0;
+  }
+  if (macCtx->hmac == NULL && macCtx->cmac == NULL && macCtx->gcm == NULL) {
+    free(macCtx);
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  return (jlong) macCtx;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_destroy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  freeMacContext((MacContext*) context);
+}
+
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_copy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  MacContext* src = (MacContext*) context;
+  MacContext* dst = (MacContext*) calloc(1, sizeof(MacContext));
+  int ok = 0;
+  if (dst != NULL) {
+    dst->type = src->type;
+    dst->keyed = src->keyed;
+    dst->gcmIvLength = src->gcmIvLength;
+    if (src->hmac != NULL) {
+      dst->hmac = (HMAC_CTX*) malloc(sizeof(HMAC_CTX));
+      if (dst->hmac != NULL) {
+        HMAC_CTX_init(dst->hmac);
+        ok = !src->keyed || HMAC_CTX_copy(dst->hmac, src->hmac);
+      }
+    } else if (src->cmac != NULL) {
+      dst->cmac = CMAC_CTX_new();
+      ok = dst->cmac != NULL
+          && (!src->keyed || CMAC_CTX_copy(dst->cmac, src->cmac));
+    } else {
+      dst->gcm = (EVP_CIPHER_CTX*) malloc(sizeof(EVP_CIPHER_CTX));
+      if (dst->gcm != NULL) {
+        EVP_CIPHER_CTX_init(dst->gcm);
+        ok = !src->keyed || EVP_CIPHER_CTX_copy(dst->gcm, src->gcm);
+      }
+    }
+  }
+  if (!ok) {
+    if (dst != NULL) {
+      freeMacContext(dst);
+    }
+    THROW(env, "java/lang/IllegalStateException", "Cannot copy the context");
+    return 0;
+  }
+  return (jlong) dst;
+}
+
+/*
+ * Key the context, or only restart the message if key is NULL. iv is the
+ * GMAC nonce and ignored by the other types.
+ */
+static int macInit(MacContext* macCtx, const unsigned char* key, int keyLength,
+    const unsigned char* iv, int ivLength) {
+  if (macCtx->hmac != NULL) {
+    return HMAC_Init_ex(macCtx->hmac, key, keyLength,
+        key == NULL ? NULL : getDigest(macCtx->type), NULL);
+  }
+  if (macCtx->cmac != NULL) {
+    return CMAC_Init(macCtx->cmac, key, keyLength,
+        key == NULL ? NULL : getCipher(MODE_CBC, keyLength), NULL);
+  }
+
+  if (key != NULL) {
+    EVP_CIPHER* cipher = getCipher(MODE_GCM, keyLength);
+    if (cipher == NULL
+        || !EVP_EncryptInit_ex(macCtx->gcm, cipher, NULL, key, NULL)) {
+      return 0;
+    }
+    macCtx->gcmIvLength = EVP_CIPHER_iv_length(cipher);
+  }
+  if (ivLength != macCtx->gcmIvLength) {
+    if (!EVP_CIPHER_CTX_ctrl(macCtx->gcm, EVP_CTRL_GCM_SET_IVLEN, ivLength,
+        NULL)) {
+      return 0;
+    }
+    macCtx->gcmIvLength = ivLength;
+  }
+  return EVP_EncryptInit_ex(macCtx->gcm, NULL, NULL, NULL, iv);
+}
+
+static int macUpdate(MacContext* macCtx, const unsigned char* in, int len) {
+  int outLength;
+  if (macCtx->hmac != NULL) {
+    return HMAC_Update(macCtx->hmac, in, len);
+  }
+  if (macCtx->cmac != NULL) {
+    return CMAC_Update(macCtx->cmac, in, len);
+  }
+  // GMAC authenticates the message as additional data
+  return EVP_EncryptUpdate(macCtx->gcm, NULL, &outLength, in, len);
+}
+
+/*
+ * Write the mac to out, returns its length or -1 on error. HMAC and CMAC
+ * restart the message with the same key.
+ */
+static int macFinal(MacContext* macCtx, unsigned char* out) {
+  unsigned int length = 0;
+  size_t cmacLength = 0;
+  int outLength;
+  if (macCtx->hmac != NULL) {
+    if (!HMAC_Final(macCtx->hmac, out, &length)
+        || !HMAC_Init_ex(macCtx->hmac, NULL, 0, NULL, NULL)) {
+      return -1;
+    }
+    return length;
+  }
+  if (macCtx->cmac != NULL) {
+    if (!CMAC_Final(macCtx->cmac, out, &cmacLength)
+        || !CMAC_Init(macCtx->cmac, NULL, 0, NULL, NULL)) {
+      return -1;
+    }
+    return cmacLength;
+  }
+  if (!EVP_EncryptFinal_ex(macCtx->gcm, out, &outLength)
+      || !EVP_CIPHER_CTX_ctrl(macCtx->gcm, EVP_CTRL_GCM_GET_TAG,
+          GMAC_TAG_LENGTH, out)) {
+    return -1;
+  }
+  return GMAC_TAG_LENGTH;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_init(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray key, jbyteArray iv) {
+  MacContext* macCtx = (MacContext*) context;
+  unsigned char* keyBytes = NULL;
+  unsigned char ivBytes[64];
+  int keyLength = 0;
+  int ivLength = 0;
+
+  if (key != NULL) {
+    keyLength = (*env)->GetArrayLength(env, key);
+    keyBytes = (unsigned char*) malloc(keyLength > 0 ? keyLength : 1);
+    if (keyBytes == NULL) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the key");
+      return;
+    }
+    (*env)->GetByteArrayRegion(env, key, 0, keyLength, (jbyte*) keyBytes);
+  } else if (!macCtx->keyed) {
+    THROW(env, "java/lang/IllegalStateException", "Mac is not keyed");
+    return;
+  }
+  if (iv != NULL) {
+    ivLength = (*env)->GetArrayLength(env, iv);
+    if (ivLength <= 0 || ivLength > (int) sizeof(ivBytes)) {
+      free(keyBytes);
+      THROW(env, "java/security/InvalidAlgorithmParameterException",
+          "Invalid iv length");
+      return;
+    }
+    (*env)->GetByteArrayRegion(env, iv, 0, ivLength, (jbyte*) ivBytes);
+  }
+
+  int rc = macInit(macCtx, keyBytes, keyLength, ivBytes, ivLength);
+  if (keyBytes != NULL) {
+    memset(keyBytes, 0, keyLength);
+    free(keyBytes);
+  }
+  if (!rc) {
+    macCtx->keyed = 0;
+    THROW(env, "java/security/InvalidKeyException",
+        "Error in initializing the mac");
+    return;
+  }
+  macCtx->keyed = 1;
+}
+
+/*
+ * The array is pinned at most CRITICAL_CHUNK_SIZE bytes at a time, so that
+ * a single large update can not stall the GC for long.
+ */
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_updateArray(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray in, jint inOff,
+    jint inLen) {
+  MacContext* macCtx = (MacContext*) context;
+  while (inLen > 0) {
+    int chunk = inLen > CRITICAL_CHUNK_SIZE ? CRITICAL_CHUNK_SIZE : inLen;
+    unsigned char* input = (unsigned char*)
+        (*env)->GetPrimitiveArrayCritical(env, in, 0);
+    if (NULL == input) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the input array");
+      return;
+    }
+    int rc = macUpdate(macCtx, input + inOff, chunk);
+    (*env)->ReleasePrimitiveArrayCritical(env, in, input, JNI_ABORT);
+    if (!rc) {
+      THROW(env, "java/lang/IllegalStateException", "Error in the mac update");
+      return;
+    }
+    inOff += chunk;
+    inLen -= chunk;
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_updateDirect(
+    JNIEnv *env, jclass clazz, jlong context, jobject inputDirectBuffer,
+    jint start, jint inputLength) {
+  unsigned char* input = (unsigned char*)
+      (*env)->GetDirectBufferAddress(env, inputDirectBuffer);
+  if (NULL == input) {
+    THROW(env, "java/lang/IllegalArgumentException",
+        "Input must be a direct buffer");
+    return;
+  }
+  if (!macUpdate((MacContext*) context, input + start, inputLength)) {
+    THROW(env, "java/lang/IllegalStateException", "Error in the mac update");
+  }
+}
+
+JNIEXPORT jint JNICALL Java_com_intel_diceros_crypto_macs_NativeMac_doFinal(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray out, jint outOff) {
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  int length = macFinal((MacContext*) context, mac);
+  if (length < 0) {
+    THROW(env, "java/lang/IllegalStateException", "Error in the mac final");
+    return 0;
+  }
+  (*env)->SetByteArrayRegion(env, out, outOff, length, (jbyte*) mac);
+  memset(mac, 0, sizeof(mac));
+  return length;
+}
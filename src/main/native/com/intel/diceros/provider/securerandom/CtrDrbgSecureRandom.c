@@ -0,0 +1,177 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "com_intel_diceros.h"
+#include "com_intel_diceros_provider_securerandom_SecureRandom_CTRDRBG.h"
+#include "ctr_drbg.h"
+#include "rdrand-api.h"
+
+/*
+ * Reseed from RDSEED, returns -1 if RDSEED is not available.
+ */
+static int reseedFromRdseed(CtrDrbg* drbg, const uint8_t* additional,
+    size_t additionalLength, int* result) {
+  uint8_t entropy[CTR_DRBG_SEED_LENGTH];
+  if (drngSeedBytes(entropy, CTR_DRBG_SEED_LENGTH) != 0) {
+    return -1;
+  }
+  *result = ctr_drbg_reseed(drbg, entropy, additional, additionalLength);
+  memset(entropy, 0, sizeof(entropy));
+  return 0;
+}
+
+/*
+ * Returns the context instantiated with the given entropy, or from RDSEED
+ * if it is null. Returns 0 if RDSEED is not available.
+ */
+JNIEXPORT jlong JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024CTRDRBG_create(
+    JNIEnv *env, jclass clazz, jbyteArray entropy) {
+  uint8_t seed[CTR_DRBG_SEED_LENGTH];
+  if (entropy == NULL) {
+    if (drngSeedBytes(seed, CTR_DRBG_SEED_LENGTH) != 0) {
+      return 0;
+    }
+  } else {
+    (*env)->GetByteArrayRegion(env, entropy, 0, CTR_DRBG_SEED_LENGTH,
+        (jbyte *) seed);
+    if ((*env)->ExceptionCheck(env)) {
+      return 0;
+    }
+  }
+
+  CtrDrbg* drbg = ctr_drbg_new();
+  if (drbg == NULL) {
+    memset(seed, 0, sizeof(seed));
+    THROW(env, "java/lang/OutOfMemoryError", "Cannot allocate the context");
+    return 0;
+  }
+  int ret = ctr_drbg_instantiate(drbg, seed, NULL, 0);
+  memset(seed, 0, sizeof(seed));
+  if (ret != 0) {
+    ctr_drbg_free(drbg);
+    THROW(env, "java/security/ProviderException",
+        "Error in instantiating the CTR_DRBG");
+    return 0;
+  }
+  return (jlong) drbg;
+}
+
+JNIEXPORT void JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024CTRDRBG_destroy(
+    JNIEnv *env, jclass clazz, jlong context) {
+  if (context != 0) {
+    ctr_drbg_free((CtrDrbg*) context);
+  }
+}
+
+static int checkContext(JNIEnv *env, jlong context) {
+  if (context == 0) {
+    THROW(env, "java/security/ProviderException",
+        "The CTR_DRBG is not instantiated");
+    return 0;
+  }
+  return 1;
+}
+
+/*
+ * Reseed with the given entropy, or from RDSEED if it is null, and the
+ * optional additional input. Returns false if RDSEED is not available.
+ */
+JNIEXPORT jboolean JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024CTRDRBG_reseed(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray entropy,
+    jbyteArray additional) {
+  CtrDrbg* drbg = (CtrDrbg*) context;
+  uint8_t input[CTR_DRBG_SEED_LENGTH];
+  int inputLength = 0;
+  int ret;
+
+  if (!checkContext(env, context)) {
+    return JNI_FALSE;
+  }
+  if (additional != NULL) {
+    inputLength = (*env)->GetArrayLength(env, additional);
+    if (inputLength > CTR_DRBG_SEED_LENGTH) {
+      THROW(env, "java/lang/IllegalArgumentException",
+          "Additional input too long");
+      return JNI_FALSE;
+    }
+    (*env)->GetByteArrayRegion(env, additional, 0, inputLength,
+        (jbyte *) input);
+  }
+  if (entropy == NULL) {
+    if (reseedFromRdseed(drbg, input, inputLength, &ret) != 0) {
+      return JNI_FALSE;
+    }
+  } else {
+    uint8_t seed[CTR_DRBG_SEED_LENGTH];
+    (*env)->GetByteArrayRegion(env, entropy, 0, CTR_DRBG_SEED_LENGTH,
+        (jbyte *) seed);
+    ret = ctr_drbg_reseed(drbg, seed, input, inputLength);
+    memset(seed, 0, sizeof(seed));
+  }
+  memset(input, 0, sizeof(input));
+  if (ret != 0) {
+    THROW(env, "java/security/ProviderException",
+        "Error in reseeding the CTR_DRBG");
+  }
+  return JNI_TRUE;
+}
+
+/*
+ * Fill len bytes of out from off, one generate request of at most
+ * CTR_DRBG_MAX_REQUEST bytes per pinning of the array. When the reseed
+ * interval is reached the DRBG is reseeded from RDSEED, if that is not
+ * available the bytes generated so far are returned and the caller reseeds.
+ */
+JNIEXPORT jint JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024CTRDRBG_generate(
+    JNIEnv *env, jclass clazz, jlong context, jbyteArray out, jint off,
+    jint len) {
+  CtrDrbg* drbg = (CtrDrbg*) context;
+  int done = 0;
+  int ret;
+
+  if (!checkContext(env, context)) {
+    return 0;
+  }
+  while (done < len) {
+    int chunk = len - done > CTR_DRBG_MAX_REQUEST ? CTR_DRBG_MAX_REQUEST :
+        len - done;
+    uint8_t* output = (uint8_t*) (*env)->GetPrimitiveArrayCritical(env, out, 0);
+    if (NULL == output) {
+      THROW(env, "java/lang/OutOfMemoryError", "Cannot pin the output array");
+      return done;
+    }
+    ret = ctr_drbg_generate(drbg, output + off + done, chunk);
+    (*env)->ReleasePrimitiveArrayCritical(env, out, output, 0);
+    if (ret == CTR_DRBG_RESEED_REQUIRED) {
+      if (reseedFromRdseed(drbg, NULL, 0, &ret) != 0) {
+        return done;
+      }
+      if (ret == 0) {
+        continue; // repeat the request after the reseed
+      }
+    }
+    if (ret != 0) {
+      THROW(env, "java/security/ProviderException",
+          "Error in generating from the CTR_DRBG");
+      return done;
+    }
+    done += chunk;
+  }
+  return done;
+}
@@ -21,6 +21,9 @@
 #include "com_intel_diceros_provider_securerandom_SecureRandom_DRNG.h"
 #include "rdrand-api.h"
 
+// max bytes filled per GetPrimitiveArrayCritical section
+#define CRITICAL_CHUNK_SIZE (256 * 1024)
+
 JNIEXPORT jboolean JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024DRNG_drngInit 
   (JNIEnv *env, jclass thisObj) {
   if (0 == drngInit())
@@ -31,11 +34,38 @@ JNIEXPORT jboolean JNICALL Java_com_intel_diceros_provider_securerandom_SecureRa
 
 JNIEXPORT jboolean JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024DRNG_drngRandBytes___3B 
   (JNIEnv *env, jobject thisObj, jbyteArray buffer) {
+  if (NULL == buffer)
+    return JNI_FALSE;
+  jsize buffer_len = (*env)->GetArrayLength(env, buffer);
+  jsize offset = 0;
+  int rtn = 0;
+  // filled in place, pinned CRITICAL_CHUNK_SIZE bytes at a time
+  while (0 == rtn && offset < buffer_len) {
+    jsize chunk = buffer_len - offset > CRITICAL_CHUNK_SIZE ?
+        CRITICAL_CHUNK_SIZE : buffer_len - offset;
+    jbyte* b = (*env)->GetPrimitiveArrayCritical(env, buffer, 0);
+    if (NULL == b)
+      return JNI_FALSE;
+    rtn = drngRandBytes((uint8_t *)b + offset, chunk);
+    (*env)->ReleasePrimitiveArrayCritical(env, buffer, b, 0);
+    offset += chunk;
+  }
+
+  if (0 == rtn)
+    return JNI_TRUE;
+  else
+    return JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024DRNG_drngSeedBytes
+  (JNIEnv *env, jclass thisObj, jbyteArray buffer) {
   if (NULL == buffer)
     return JNI_FALSE;
   jbyte* b = (*env)->GetByteArrayElements(env, buffer, 0);
+  if (NULL == b)
+    return JNI_FALSE;
   jsize buffer_len = (*env)->GetArrayLength(env, buffer);
-  int rtn = drngRandBytes((uint8_t *)b, buffer_len);
+  int rtn = drngSeedBytes((uint8_t *)b, buffer_len);
   (*env)->ReleaseByteArrayElements(env, buffer, b, 0);
 
   if (0 == rtn)
@@ -61,3 +91,19 @@ JNIEXPORT jint JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom
       return -1;
   }
 }
+
+/*
+ * Fill length bytes from offset of a direct buffer, the range is checked by
+ * the caller. Returns 0, -1 if the DRNG failed or -2 if the buffer is not
+ * direct.
+ */
+JNIEXPORT jint JNICALL Java_com_intel_diceros_provider_securerandom_SecureRandom_00024DRNG_drngRandBytesRange
+  (JNIEnv *env, jclass thisObj, jobject buffer, jlong offset, jlong length) {
+  jbyte* b = (*env)->GetDirectBufferAddress(env, buffer);
+  if (NULL == b)
+    return -2;
+  if (0 == drngRandBytesBulk((uint8_t *)b + offset, length))
+    return 0;
+  else
+    return -1;
+}
@@ -0,0 +1,162 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "ctr_drbg.h"
+
+static void increment(uint8_t* v) {
+  int i;
+  for (i = CTR_DRBG_BLOCK_LENGTH - 1; i >= 0; i--) {
+    if (++v[i] != 0) {
+      break;
+    }
+  }
+}
+
+/*
+ * Start the AES-CTR keystream E(K, V + 1), E(K, V + 2), ... which is the
+ * block sequence of the standard, its counter is the whole 128 bit block.
+ */
+static int startKeystream(CtrDrbg* drbg) {
+  uint8_t counter[CTR_DRBG_BLOCK_LENGTH];
+  memcpy(counter, drbg->v, CTR_DRBG_BLOCK_LENGTH);
+  increment(counter);
+  return EVP_EncryptInit_ex(drbg->cipher, EVP_aes_256_ctr(), NULL, drbg->key,
+      counter);
+}
+
+static int keystream(CtrDrbg* drbg, uint8_t* output, size_t length) {
+  int len;
+  memset(output, 0, length);
+  return EVP_EncryptUpdate(drbg->cipher, output, &len, output, length);
+}
+
+/*
+ * CTR_DRBG_Update: the next seedlen bytes of the running keystream xor the
+ * provided data become the new key and V.
+ */
+static int updateFromKeystream(CtrDrbg* drbg, const uint8_t* provided,
+    size_t providedLength) {
+  uint8_t temp[CTR_DRBG_SEED_LENGTH];
+  size_t i;
+  if (!keystream(drbg, temp, CTR_DRBG_SEED_LENGTH)) {
+    return -1;
+  }
+  for (i = 0; i < providedLength; i++) {
+    temp[i] ^= provided[i];
+  }
+  memcpy(drbg->key, temp, CTR_DRBG_KEY_LENGTH);
+  memcpy(drbg->v, temp + CTR_DRBG_KEY_LENGTH, CTR_DRBG_BLOCK_LENGTH);
+  memset(temp, 0, sizeof(temp));
+  return 0;
+}
+
+static int update(CtrDrbg* drbg, const uint8_t* provided,
+    size_t providedLength) {
+  if (!startKeystream(drbg)) {
+    return -1;
+  }
+  return updateFromKeystream(drbg, provided, providedLength);
+}
+
+/*
+ * seed_material = entropy xor the zero padded input.
+ */
+static int seed(CtrDrbg* drbg, const uint8_t* entropy, const uint8_t* input,
+    size_t inputLength) {
+  uint8_t material[CTR_DRBG_SEED_LENGTH];
+  size_t i;
+  int ret;
+  if (inputLength > CTR_DRBG_SEED_LENGTH) {
+    return -1;
+  }
+  memcpy(material, entropy, CTR_DRBG_SEED_LENGTH);
+  for (i = 0; i < inputLength; i++) {
+    material[i] ^= input[i];
+  }
+  ret = update(drbg, material, CTR_DRBG_SEED_LENGTH);
+  memset(material, 0, sizeof(material));
+  if (ret == 0) {
+    drbg->reseedCounter = 1;
+  }
+  return ret;
+}
+
+CtrDrbg* ctr_drbg_new() {
+  CtrDrbg* drbg = (CtrDrbg*) calloc(1, sizeof(CtrDrbg));
+  if (drbg == NULL) {
+    return NULL;
+  }
+  drbg->cipher = (EVP_CIPHER_CTX *) malloc(sizeof(EVP_CIPHER_CTX));
+  if (drbg->cipher == NULL) {
+    free(drbg);
+    return NULL;
+  }
+  EVP_CIPHER_CTX_init(drbg->cipher);
+  return drbg;
+}
+
+void ctr_drbg_free(CtrDrbg* drbg) {
+  EVP_CIPHER_CTX_cleanup(drbg->cipher);
+  free(drbg->cipher);
+  memset(drbg, 0, sizeof(CtrDrbg));
+  free(drbg);
+}
+
+int ctr_drbg_instantiate(CtrDrbg* drbg, const uint8_t* entropy,
+    const uint8_t* personalization, size_t personalizationLength) {
+  memset(drbg->key, 0, CTR_DRBG_KEY_LENGTH);
+  memset(drbg->v, 0, CTR_DRBG_BLOCK_LENGTH);
+  return seed(drbg, entropy, personalization, personalizationLength);
+}
+
+int ctr_drbg_reseed(CtrDrbg* drbg, const uint8_t* entropy,
+    const uint8_t* additional, size_t additionalLength) {
+  return seed(drbg, entropy, additional, additionalLength);
+}
+
+/*
+ * The output is the keystream from V + 1, the partial last block is cut from
+ * a whole block so that the update continues at the next counter.
+ */
+int ctr_drbg_generate(CtrDrbg* drbg, uint8_t* output, size_t length) {
+  uint8_t last[CTR_DRBG_BLOCK_LENGTH];
+  size_t full = length & ~((size_t) CTR_DRBG_BLOCK_LENGTH - 1);
+  int ret = 0;
+
+  if (length > CTR_DRBG_MAX_REQUEST) {
+    return -1;
+  }
+  if (drbg->reseedCounter > CTR_DRBG_RESEED_INTERVAL) {
+    return CTR_DRBG_RESEED_REQUIRED;
+  }
+  if (!startKeystream(drbg) || !keystream(drbg, output, full)) {
+    return -1;
+  }
+  if (full < length) {
+    if (!keystream(drbg, last, CTR_DRBG_BLOCK_LENGTH)) {
+      return -1;
+    }
+    memcpy(output + full, last, length - full);
+    memset(last, 0, sizeof(last));
+  }
+  ret = updateFromKeystream(drbg, NULL, 0);
+  drbg->reseedCounter++;
+  return ret;
+}
@@ -0,0 +1,68 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CTR_DRBG_H
+#define __CTR_DRBG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/evp.h>
+
+/*
+ * CTR_DRBG of NIST SP 800-90A with AES-256 and no derivation function, so
+ * the entropy input must be full entropy, e.g. from RDSEED.
+ */
+#define CTR_DRBG_KEY_LENGTH 32
+#define CTR_DRBG_BLOCK_LENGTH 16
+#define CTR_DRBG_SEED_LENGTH (CTR_DRBG_KEY_LENGTH + CTR_DRBG_BLOCK_LENGTH)
+
+// max bytes per generate request, 2^19 bits
+#define CTR_DRBG_MAX_REQUEST (64 * 1024)
+// generate requests between reseeds, the standard allows up to 2^48
+#define CTR_DRBG_RESEED_INTERVAL (1 << 24)
+
+#define CTR_DRBG_RESEED_REQUIRED 1
+
+typedef struct _CtrDrbg {
+  EVP_CIPHER_CTX* cipher;
+  uint8_t key[CTR_DRBG_KEY_LENGTH];
+  uint8_t v[CTR_DRBG_BLOCK_LENGTH];
+  uint64_t reseedCounter;
+} CtrDrbg;
+
+CtrDrbg* ctr_drbg_new();
+void ctr_drbg_free(CtrDrbg* drbg);
+
+/*
+ * Instantiate or reseed with CTR_DRBG_SEED_LENGTH bytes of entropy. The
+ * personalization string or additional input is optional and at most
+ * CTR_DRBG_SEED_LENGTH bytes. Both return 0 on success, -1 on error.
+ */
+int ctr_drbg_instantiate(CtrDrbg* drbg, const uint8_t* entropy,
+    const uint8_t* personalization, size_t personalizationLength);
+int ctr_drbg_reseed(CtrDrbg* drbg, const uint8_t* entropy,
+    const uint8_t* additional, size_t additionalLength);
+
+/*
+ * Generate length bytes, at most CTR_DRBG_MAX_REQUEST. Returns 0 on success,
+ * CTR_DRBG_RESEED_REQUIRED when the reseed interval is reached (nothing is
+ * generated) or -1 on error.
+ */
+int ctr_drbg_generate(CtrDrbg* drbg, uint8_t* output, size_t length);
+
+#endif
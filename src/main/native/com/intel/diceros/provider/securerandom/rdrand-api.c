@@ -1,110 +1,172 @@
-#include <assert.h>
-
-#include <openssl/evp.h>
-#include <openssl/err.h>
-#include <openssl/engine.h>
-#include <openssl/crypto.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <sys/syscall.h>
+#include <string.h>
+#include <immintrin.h>
 
+#include "cpu_features.h"
+#include "work_pool.h"
+#include "com/intel/diceros/crypto/digests/sha.h"
 #include "rdrand-api.h"
 
-static pthread_mutex_t *lockarray = NULL;
+/*
+ * RDRAND only fails when the DRNG is transiently drained, Intel's guidance is
+ * to retry 10 times before reporting an error. RDSEED waits for fresh
+ * entropy and can fail far more often under load, so it retries longer and
+ * pauses between attempts.
+ */
+#define RDRAND_RETRIES 10
+#define RDSEED_RETRIES 1024
 
-static void lock_callback(int mode, int type, char *file, int line) {
-  (void)file;
-  (void)line;
-  if (mode & CRYPTO_LOCK) {
-    pthread_mutex_lock(&(lockarray[type]));
-  } else {
-    pthread_mutex_unlock(&(lockarray[type]));
+/*
+ * The DRBG behind RDRAND reseeds at least every 511 128 bit samples, so
+ * 1024 64 bit samples span a reseed. Their SHA-256 is used for 16 bytes of
+ * seed when RDSEED is missing or exhausted.
+ */
+#define RDRAND_SEED_SAMPLES 1024
+#define RDRAND_SEED_BYTES 16
+
+typedef int (*DrngStep)(uint64_t* value);
+
+__attribute__((target("rdrnd")))
+static int rdrand64(uint64_t* value) {
+  unsigned long long v;
+  int i;
+  for (i = 0; i < RDRAND_RETRIES; i++) {
+    if (_rdrand64_step(&v)) {
+      *value = v;
+      return 1;
+    }
   }
+  return 0;
 }
 
-static unsigned long thread_id(void) {
-  unsigned long ret;
-
-  ret=(unsigned long)syscall(SYS_gettid);
-  return(ret);
-}
-
-static void init_locks(void) {
+__attribute__((target("rdseed")))
+static int rdseed64(uint64_t* value) {
+  unsigned long long v;
   int i;
-
-  lockarray=(pthread_mutex_t *)OPENSSL_malloc(CRYPTO_num_locks() *
-      sizeof(pthread_mutex_t));
-  for (i=0; i<CRYPTO_num_locks(); i++) {
-    pthread_mutex_init(&(lockarray[i]),NULL);
+  for (i = 0; i < RDSEED_RETRIES; i++) {
+    if (_rdseed64_step(&v)) {
+      *value = v;
+      return 1;
+    }
+    _mm_pause();
   }
-
-  CRYPTO_set_id_callback((unsigned long (*)())thread_id);
-  CRYPTO_set_locking_callback((void (*)())lock_callback);
+  return 0;
 }
 
-static void destroy_locks(void) {
-  int i;
+/*
+ * Fill the buffer 8 bytes per instruction, the tail takes the low bytes of
+ * one more value.
+ */
+static int drngFill(DrngStep step, uint8_t* buffer, size_t buffer_len) {
+  uint64_t value = 0;
+  int ret = 0;
+  while (buffer_len >= 8) {
+    if (!step(&value)) {
+      ret = -1;
+      break;
+    }
+    memcpy(buffer, &value, 8);
+    buffer += 8;
+    buffer_len -= 8;
+  }
+  if (ret == 0 && buffer_len > 0) {
+    if (step(&value)) {
+      memcpy(buffer, &value, buffer_len);
+    } else {
+      ret = -1;
+    }
+  }
+  value = 0;
+  return ret;
+}
 
-  CRYPTO_set_locking_callback(NULL);
-  for (i=0; i<CRYPTO_num_locks(); i++)
-    pthread_mutex_destroy(&(lockarray[i]));
+/*
+ * The instructions are used directly, without the OpenSSL rdrand ENGINE, so
+ * no libcrypto lock is taken on the way. Returns -1 if the cpu has no RDRAND,
+ * the caller then falls back to another generator.
+ */
+int drngInit() {
+  return cpu_has(CPU_FEATURE_RDRAND) ? 0 : -1;
+}
 
-  OPENSSL_free(lockarray);
+int drngRandBytes(uint8_t* buffer, size_t buffer_len) {
+  if (!cpu_has(CPU_FEATURE_RDRAND)) {
+    return -1;
+  }
+  return drngFill(rdrand64, buffer, buffer_len);
 }
 
-int drngInited = 0;
-int drngInitResult = 0;
+typedef struct _DrngJob {
+  uint8_t* buffer;
+  size_t length;
+  int chunkSize;
+} DrngJob;
+
+static int drngFillChunk(void* arg, int index) {
+  DrngJob* job = (DrngJob*) arg;
+  size_t offset = (size_t) index * job->chunkSize;
+  size_t length = job->length - offset < (size_t) job->chunkSize ?
+      job->length - offset : (size_t) job->chunkSize;
+  return drngFill(rdrand64, job->buffer + offset, length);
+}
 
-int drngInit() {
-  if (drngInited != 0) {
-    return drngInitResult;
+/*
+ * RDRAND throughput grows with the cores issuing it, so large fills are
+ * split over the worker pool when it is enabled.
+ */
+int drngRandBytesBulk(uint8_t* buffer, size_t buffer_len) {
+  int chunkSize = work_pool_chunk_size((long) buffer_len);
+  if (chunkSize == 0) {
+    return drngRandBytes(buffer, buffer_len);
   }
+  if (!cpu_has(CPU_FEATURE_RDRAND)) {
+    return -1;
+  }
+  DrngJob job;
+  job.buffer = buffer;
+  job.length = buffer_len;
+  job.chunkSize = chunkSize;
+  return work_pool_run(drngFillChunk, &job,
+      (int) ((buffer_len + chunkSize - 1) / chunkSize));
+}
 
-  init_locks();
-  ENGINE_load_rdrand();
-  ENGINE* eng = ENGINE_by_id("rdrand");
-
+static int rdrandSeed(uint8_t* buffer, size_t buffer_len) {
+  uint64_t samples[RDRAND_SEED_SAMPLES];
+  uint8_t digest[SHA256_HASH_LENGTH];
+  ShaContext sha;
   int ret = 0;
-  do {
-    if (NULL == eng) {
-      /*fprintf(stderr, "ENGINE_load_rdrand failed, err = 0x%lx\n",
-          ERR_get_error());*/
-      ret = 0;
-      break;
-    } else {
-      int rc = ENGINE_set_default(eng, ENGINE_METHOD_RAND);
-      if(1 != rc) {
-        /*fprintf(stderr, "ENGINE_set_default failed, err = 0x%lx\n",
-          ERR_get_error());*/
+  int i;
+  while (ret == 0 && buffer_len > 0) {
+    size_t chunk = buffer_len < RDRAND_SEED_BYTES ? buffer_len :
+        RDRAND_SEED_BYTES;
+    for (i = 0; i < RDRAND_SEED_SAMPLES; i++) {
+      if (!rdrand64(&samples[i])) {
         ret = -1;
         break;
       }
     }
-  } while(0);
-
-  if (NULL != eng)
-    ENGINE_free(eng);
-  if (-1 == ret)
-    destroy_locks();
-
-  drngInited = 1;
-  drngInitResult = ret;
-
+    if (ret != 0) {
+      break;
+    }
+    sha_init(&sha, SHA_ALG_SHA256);
+    sha_update(&sha, (uint8_t*) samples, sizeof(samples));
+    sha_final(&sha, digest);
+    memcpy(buffer, digest, chunk);
+    buffer += chunk;
+    buffer_len -= chunk;
+  }
+  memset(samples, 0, sizeof(samples));
+  memset(digest, 0, sizeof(digest));
+  memset(&sha, 0, sizeof(sha));
   return ret;
 }
 
-/*
- * here we do not consider the situation that ENGINE_METHOD_RAND is
- * changed to other rng methods by other threads.
- * */
-int drngRandBytes(uint8_t* buffer, size_t buffer_len) {
-  int ret = 0;
-  int rc = RAND_bytes(buffer, buffer_len);
-  if (1 != rc) {
-    /*fprintf(stderr, "RAND_bytes (1) failed, err = 0x%lx\n",
-        ERR_get_error());*/
-    ret = -1;
+int drngSeedBytes(uint8_t* buffer, size_t buffer_len) {
+  if (cpu_has(CPU_FEATURE_RDSEED) &&
+      drngFill(rdseed64, buffer, buffer_len) == 0) {
+    return 0;
   }
-
-  return ret;
+  if (cpu_has(CPU_FEATURE_RDRAND)) {
+    return rdrandSeed(buffer, buffer_len);
+  }
+  return -1;
 }
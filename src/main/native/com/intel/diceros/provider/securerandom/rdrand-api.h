@@ -8,9 +8,26 @@
 extern "C" {
 #endif
 
+/*
+ * All functions return 0 on success and -1 if the instruction is not
+ * supported or kept failing after its retries.
+ */
 int drngInit();
 int drngRandBytes(uint8_t* buffer, size_t buffer_len);
 
+/*
+ * drngRandBytes for large buffers, filled by the worker pool when it is
+ * enabled and the buffer reaches its threshold.
+ */
+int drngRandBytesBulk(uint8_t* buffer, size_t buffer_len);
+
+/*
+ * Fill the buffer with seed material for other generators: from RDSEED, the
+ * conditioned entropy source, or if it is missing or keeps failing, from
+ * RDRAND samples spanning a reseed of its DRBG, conditioned with SHA-256.
+ */
+int drngSeedBytes(uint8_t* buffer, size_t buffer_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,82 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cpuid.h>
+#include <pthread.h>
+#include "cpu_features.h"
+
+static pthread_once_t probeOnce = PTHREAD_ONCE_INIT;
+static int features = 0;
+
+static unsigned int xgetbv0() {
+  unsigned int eax, edx;
+  __asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return eax;
+}
+
+static void probe() {
+  unsigned int a, b, c, d;
+  int result = 0;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d)) {
+    return;
+  }
+  if ((c >> 25) & 1) {
+    result |= CPU_FEATURE_AESNI;
+  }
+  if ((c >> 1) & 1) {
+    result |= CPU_FEATURE_PCLMUL;
+  }
+  if ((c >> 30) & 1) {
+    result |= CPU_FEATURE_RDRAND;
+  }
+  if ((c >> 20) & 1) {
+    result |= CPU_FEATURE_SSE42;
+  }
+
+  // xmm/ymm (and opmask/zmm) state enabled by the OS
+  unsigned int xcr0 = ((c >> 27) & 1) ? xgetbv0() : 0;
+  int ymmEnabled = (xcr0 & 0x06) == 0x06;
+  int zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+  if (__get_cpuid_max(0, 0) >= 7) {
+    __cpuid_count(7, 0, a, b, c, d);
+    if (((b >> 5) & 1) && ymmEnabled) {
+      result |= CPU_FEATURE_AVX2;
+    }
+    if (((b >> 16) & 1) && zmmEnabled) {
+      result |= CPU_FEATURE_AVX512F;
+    }
+    if (((c >> 9) & 1) && ymmEnabled) {
+      result |= CPU_FEATURE_VAES;
+    }
+    if ((b >> 29) & 1) {
+      result |= CPU_FEATURE_SHANI;
+    }
+    if ((b >> 18) & 1) {
+      result |= CPU_FEATURE_RDSEED;
+    }
+  }
+
+  features = result;
+}
+
+int cpu_features() {
+  pthread_once(&probeOnce, probe);
+  return features;
+}
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CPU_FEATURES_H
+#define __CPU_FEATURES_H
+
+/*
+ * CPU features used by the native code. The values are shared with
+ * com.intel.diceros.crypto.engines.KernelDispatch.
+ */
+#define CPU_FEATURE_AESNI   0x01
+#define CPU_FEATURE_PCLMUL  0x02
+#define CPU_FEATURE_AVX2    0x04
+#define CPU_FEATURE_AVX512F 0x08
+#define CPU_FEATURE_VAES    0x10
+#define CPU_FEATURE_SHANI   0x20
+#define CPU_FEATURE_RDRAND  0x40
+#define CPU_FEATURE_RDSEED  0x80
+#define CPU_FEATURE_SSE42   0x100
+
+/*
+ * Returns the bitmask of the supported CPU_FEATURE_* flags. CPUID is only
+ * run once per process, the AVX flags are only set if the OS saves the
+ * corresponding register state.
+ */
+int cpu_features();
+
+static inline int cpu_has(int features) {
+  return (cpu_features() & features) == features;
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <nmmintrin.h>
+#include "cpu_features.h"
+#include "crc32c.h"
+
+// reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82f63b78
+
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+static uint32_t table[256];
+static int hardware = 0;
+
+static void init() {
+  uint32_t i, j;
+  for (i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+    }
+    table[i] = crc;
+  }
+  hardware = cpu_has(CPU_FEATURE_SSE42);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint32_t crc, const uint8_t* data,
+    size_t length) {
+  uint64_t crc64 = crc;
+  uint64_t word;
+  while (length >= 8) {
+    memcpy(&word, data, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    length -= 8;
+  }
+  crc = (uint32_t) crc64;
+  while (length > 0) {
+    crc = _mm_crc32_u8(crc, *data++);
+    length--;
+  }
+  return crc;
+}
+
+static uint32_t crc32cTable(uint32_t crc, const uint8_t* data,
+    size_t length) {
+  while (length > 0) {
+    crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    length--;
+  }
+  return crc;
+}
+
+uint32_t crc32c_update(uint32_t crc, const uint8_t* data, size_t length) {
+  pthread_once(&initOnce, init);
+  crc = ~crc;
+  crc = hardware ? crc32cHardware(crc, data, length) :
+      crc32cTable(crc, data, length);
+  return ~crc;
+}
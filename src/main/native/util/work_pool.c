@@ -0,0 +1,282 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "work_pool.h"
+
+/*
+ * The chunks [next, end) a participant has not started yet, the owner takes
+ * from the front and thieves from the back.
+ */
+typedef struct _WorkShare {
+  pthread_mutex_t lock;
+  int next;
+  int end;
+} __attribute__((aligned(64))) WorkShare;
+
+typedef struct _WorkPool {
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  // held by the thread running a job, and while the pool is reconfigured
+  pthread_mutex_t busy;
+  pthread_t workers[WORK_POOL_MAX_THREADS];
+  int threads;
+  int threshold;
+  int chunkSize;
+  int shutdown;
+
+  // the current job, guarded by lock
+  WorkFunc func;
+  void* arg;
+  unsigned generation;
+  int active;
+  int joined;            // workers inside the current job
+  int remaining;         // chunks not finished yet
+  int failed;
+  WorkShare shares[WORK_POOL_MAX_THREADS + 1];
+} WorkPool;
+
+static WorkPool pool = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .start = PTHREAD_COND_INITIALIZER,
+  .done = PTHREAD_COND_INITIALIZER,
+  .busy = PTHREAD_MUTEX_INITIALIZER,
+  .threshold = WORK_POOL_DEFAULT_THRESHOLD,
+  .chunkSize = WORK_POOL_DEFAULT_CHUNK_SIZE,
+};
+static pthread_once_t sharesOnce = PTHREAD_ONCE_INIT;
+
+static void initShares() {
+  int i;
+  for (i = 0; i <= WORK_POOL_MAX_THREADS; i++) {
+    pthread_mutex_init(&pool.shares[i].lock, NULL);
+  }
+}
+
+static int takeOwn(WorkShare* share) {
+  int index = -1;
+  pthread_mutex_lock(&share->lock);
+  if (share->next < share->end) {
+    index = share->next++;
+  }
+  pthread_mutex_unlock(&share->lock);
+  return index;
+}
+
+/*
+ * Move the back half of the largest other share to the share of self,
+ * returns 0 if nothing is left to steal.
+ */
+static int steal(int self, int participants) {
+  int victim = -1;
+  int largest = 0;
+  int i;
+  for (i = 0; i < participants; i++) {
+    if (i == self) {
+      continue;
+    }
+    pthread_mutex_lock(&pool.shares[i].lock);
+    int left = pool.shares[i].end - pool.shares[i].next;
+    pthread_mutex_unlock(&pool.shares[i].lock);
+    if (left > largest) {
+      largest = left;
+      victim = i;
+    }
+  }
+  if (victim < 0) {
+    return 0;
+  }
+
+  WorkShare* from = &pool.shares[victim];
+  int begin, end;
+  pthread_mutex_lock(&from->lock);
+  end = from->end;
+  begin = end - (end - from->next + 1) / 2;
+  from->end = begin;
+  pthread_mutex_unlock(&from->lock);
+  if (begin >= end) {
+    // raced with the owner, look again
+    return 1;
+  }
+
+  WorkShare* to = &pool.shares[self];
+  pthread_mutex_lock(&to->lock);
+  to->next = begin;
+  to->end = end;
+  pthread_mutex_unlock(&to->lock);
+  return 1;
+}
+
+static void runShares(int self, int participants, WorkFunc func, void* arg) {
+  for (;;) {
+    int index = takeOwn(&pool.shares[self]);
+    if (index < 0) {
+      if (!steal(self, participants)) {
+        return;
+      }
+      continue;
+    }
+    int rc = func(arg, index);
+    pthread_mutex_lock(&pool.lock);
+    if (rc != 0) {
+      pool.failed = 1;
+    }
+    if (--pool.remaining == 0) {
+      pthread_cond_broadcast(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+  }
+}
+
+static void* workerMain(void* param) {
+  int self = (int) (long) param;
+  unsigned seen = 0;
+
+  pthread_mutex_lock(&pool.lock);
+  for (;;) {
+    while (!pool.shutdown && (!pool.active || pool.generation == seen)) {
+      pthread_cond_wait(&pool.start, &pool.lock);
+    }
+    if (pool.shutdown) {
+      break;
+    }
+    seen = pool.generation;
+    WorkFunc func = pool.func;
+    void* arg = pool.arg;
+    int participants = pool.threads + 1;
+    pool.joined++;
+    pthread_mutex_unlock(&pool.lock);
+
+    runShares(self, participants, func, arg);
+
+    pthread_mutex_lock(&pool.lock);
+    if (--pool.joined == 0) {
+      pthread_cond_broadcast(&pool.done);
+    }
+  }
+  pthread_mutex_unlock(&pool.lock);
+  return NULL;
+}
+
+static void stopWorkers() {
+  int i;
+  pthread_mutex_lock(&pool.lock);
+  pool.shutdown = 1;
+  pthread_cond_broadcast(&pool.start);
+  pthread_mutex_unlock(&pool.lock);
+  for (i = 0; i < pool.threads; i++) {
+    pthread_join(pool.workers[i], NULL);
+  }
+  pool.threads = 0;
+  pool.shutdown = 0;
+}
+
+int work_pool_configure(int threads, int threshold, int chunkSize) {
+  int i;
+  if (threads < 0 || threads > WORK_POOL_MAX_THREADS || threshold < 0
+      || chunkSize < 4096 || chunkSize % 4096 != 0) {
+    return -1;
+  }
+  pthread_once(&sharesOnce, initShares);
+
+  pthread_mutex_lock(&pool.busy);
+  stopWorkers();
+  pool.threshold = threshold;
+  pool.chunkSize = chunkSize;
+  for (i = 0; i < threads; i++) {
+    // the worker index is its share, the submitting thread uses the last one
+    if (pthread_create(&pool.workers[i], NULL, workerMain, (void*) (long) i)
+        != 0) {
+      pool.threads = i;
+      stopWorkers();
+      pthread_mutex_unlock(&pool.busy);
+      return -1;
+    }
+    pool.threads = i + 1;
+  }
+  pthread_mutex_unlock(&pool.busy);
+  return 0;
+}
+
+int work_pool_threads() {
+  return pool.threads;
+}
+
+int work_pool_chunk_size(long length) {
+  if (pool.threads == 0 || length < pool.threshold
+      || length < 2L * pool.chunkSize) {
+    return 0;
+  }
+  return pool.chunkSize;
+}
+
+static int runInline(WorkFunc func, void* arg, int count) {
+  int i;
+  for (i = 0; i < count; i++) {
+    if (func(arg, i) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int work_pool_run(WorkFunc func, void* arg, int count) {
+  if (pool.threads == 0 || count < 2 || pthread_mutex_trylock(&pool.busy) != 0) {
+    return runInline(func, arg, count);
+  }
+  if (pool.threads == 0) {
+    pthread_mutex_unlock(&pool.busy);
+    return runInline(func, arg, count);
+  }
+
+  int participants = pool.threads + 1;
+  int i, failed;
+  for (i = 0; i < participants; i++) {
+    WorkShare* share = &pool.shares[i];
+    pthread_mutex_lock(&share->lock);
+    share->next = (long) count * i / participants;
+    share->end = (long) count * (i + 1) / participants;
+    pthread_mutex_unlock(&share->lock);
+  }
+
+  pthread_mutex_lock(&pool.lock);
+  pool.func = func;
+  pool.arg = arg;
+  pool.remaining = count;
+  pool.failed = 0;
+  pool.active = 1;
+  pool.generation++;
+  pthread_cond_broadcast(&pool.start);
+  pthread_mutex_unlock(&pool.lock);
+
+  runShares(pool.threads, participants, func, arg);
+
+  pthread_mutex_lock(&pool.lock);
+  // func and arg live on the stack of the caller, wait for every worker
+  while (pool.remaining > 0 || pool.joined > 0) {
+    pthread_cond_wait(&pool.done, &pool.lock);
+  }
+  pool.active = 0;
+  failed = pool.failed;
+  pthread_mutex_unlock(&pool.lock);
+
+  pthread_mutex_unlock(&pool.busy);
+  return failed ? -1 : 0;
+}
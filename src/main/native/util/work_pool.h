@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __WORK_POOL_H
+#define __WORK_POOL_H
+
+/*
+ * Opt-in pool of worker threads for very large buffers. A job is cut into
+ * count chunks, every participant (the workers and the submitting thread)
+ * starts on its own share and steals half of the largest remaining share
+ * when it runs out. The pool is disabled (0 threads) until configured from
+ * com.intel.diceros.crypto.engines.WorkerPool.
+ */
+#define WORK_POOL_MAX_THREADS 64
+#define WORK_POOL_DEFAULT_THRESHOLD (8 * 1024 * 1024)
+#define WORK_POOL_DEFAULT_CHUNK_SIZE (256 * 1024)
+
+/*
+ * Processes chunk index of a job, returns 0 or -1 on error.
+ */
+typedef int (*WorkFunc)(void* arg, int index);
+
+/*
+ * Start threads workers, 0 stops the pool. Jobs of at least threshold bytes
+ * are split into chunks of chunkSize bytes. Returns 0, or -1 if the threads
+ * cannot be started (the pool is disabled then).
+ */
+int work_pool_configure(int threads, int threshold, int chunkSize);
+
+int work_pool_threads();
+
+/*
+ * Returns the chunk size to split a job of length bytes into, or 0 if it
+ * should run on the calling thread.
+ */
+int work_pool_chunk_size(long length);
+
+/*
+ * Run func for the chunks 0 to count - 1 and wait for all of them, returns 0
+ * or -1 if a chunk failed. The chunks run on the calling thread alone if the
+ * pool is disabled or busy with the job of another thread.
+ */
+int work_pool_run(WorkFunc func, void* arg, int count);
+
+#endif
@@ -23,14 +23,17 @@ import java.security.Key;
 import java.security.NoSuchAlgorithmException;
 import java.security.NoSuchProviderException;
 import java.security.Security;
+import java.util.Random;
 
 import javax.crypto.BadPaddingException;
 import javax.crypto.Cipher;
 import javax.crypto.IllegalBlockSizeException;
 import javax.crypto.NoSuchPaddingException;
 import javax.crypto.ShortBufferException;
+import javax.crypto.spec.IvParameterSpec;
 import javax.crypto.spec.SecretKeySpec;
 
+import com.intel.diceros.crypto.engines.KernelDispatch;
 import com.intel.diceros.provider.DicerosProvider;
 import com.intel.diceros.provider.util.Arrays;
 import com.intel.diceros.test.util.Hex;
@@ -39,7 +42,20 @@ public class AESCBCMBTest extends AESAbstarctTest {
   private static String[] cipherTests = {
     "000102030405060708090a0b0c0d0e0f", // key data, length 128
     //"123456789abcdef1123456789abcdef1", // iv data
-    "hello world hello world hello world hello world hello world hello world123456789"}; // input data
+    "hello world hello world hello world hello world hello world hello world123456789", // input data
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", // key data, length 256
+    // long enough for every lane of the 8 and 16 lane kernels
+    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+      + "0123456789"};
 
   public AESCBCMBTest() {
 
@@ -84,6 +100,10 @@ public class AESCBCMBTest extends AESAbstarctTest {
     //
     byte[] encrytion = new byte[input.length + 16 + 2];
     int encryptLen = out.doFinal(input, 0, input.length, encrytion, 0);
+    // header[0] is lanes / 8, older readers take any non-zero value for 8
+    if (!KernelDispatch.isWideOutput() && encrytion[0] > 1) {
+      fail("16 lane header written without wide output");
+    }
 
     byte[] decrytion = in.doFinal(encrytion, 0, encryptLen);
 
@@ -143,6 +163,77 @@ public class AESCBCMBTest extends AESAbstarctTest {
     }
   }
 
+  /**
+   * AES Test with the input fed through several updates. The ciphertext must
+   * match the one of a single doFinal, and decrypt in chunks as well as in
+   * one call.
+   *
+   * @param keyBytes the key data
+   * @param length the input length
+   * @throws Exception
+   */
+  protected void streamTest(byte[] keyBytes, int length) throws Exception {
+    Random rnd = new Random(length);
+    byte[] input = new byte[length];
+    rnd.nextBytes(input);
+
+    Key key = new SecretKeySpec(keyBytes, "AES");
+    Cipher enc = Cipher.getInstance(this.cipherName, this.providerName);
+    Cipher dec = Cipher.getInstance(this.cipherName, this.providerName);
+    enc.init(Cipher.ENCRYPT_MODE, key);
+    IvParameterSpec iv = new IvParameterSpec(enc.getIV());
+
+    //
+    // encryption in chunks
+    //
+    byte[] encryption = new byte[enc.getOutputSize(length)];
+    int encryptLen = 0;
+    int off = 0;
+    while (off < length) {
+      int chunk = Math.min(1 + rnd.nextInt(20000), length - off);
+      encryptLen += enc.update(input, off, chunk, encryption, encryptLen);
+      off += chunk;
+    }
+    encryptLen += enc.doFinal(encryption, encryptLen);
+
+    enc.init(Cipher.ENCRYPT_MODE, key, iv);
+    byte[] expected = enc.doFinal(input);
+    if (!Arrays.areEqual(expected, Arrays.copyOf(encryption, encryptLen))) {
+      fail("AES failed streaming encryption of " + length + " bytes");
+    }
+
+    //
+    // decryption in chunks
+    //
+    dec.init(Cipher.DECRYPT_MODE, key, iv);
+    byte[] decryption = new byte[dec.getOutputSize(encryptLen)];
+    int decryptLen = 0;
+    off = 0;
+    while (off < encryptLen) {
+      int chunk = Math.min(1 + rnd.nextInt(20000), encryptLen - off);
+      decryptLen += dec.update(encryption, off, chunk, decryption, decryptLen);
+      off += chunk;
+    }
+    decryptLen += dec.doFinal(decryption, decryptLen);
+    if (!Arrays.areEqual(input, Arrays.copyOf(decryption, decryptLen))) {
+      fail("AES failed streaming decryption of " + length + " bytes");
+    }
+
+    //
+    // decryption in one call
+    //
+    ByteBuffer cipherText = ByteBuffer.allocateDirect(encryptLen);
+    cipherText.put(encryption, 0, encryptLen);
+    cipherText.flip();
+    ByteBuffer plainText = ByteBuffer.allocateDirect(encryptLen);
+    dec.init(Cipher.DECRYPT_MODE, key, iv);
+    dec.doFinal(cipherText, plainText);
+    plainText.flip();
+    if (!plainText.equals(ByteBuffer.wrap(input))) {
+      fail("AES failed decryption of a stream of " + length + " bytes");
+    }
+  }
+
   @Override
   public void performTest() throws Exception {
     for (int i = 0; i != cipherTests.length; i += 2) {
@@ -156,6 +247,14 @@ public class AESCBCMBTest extends AESAbstarctTest {
       inputBuffer.flip();
       byteBufferTest(Hex.decode(cipherTests[i]), inputBuffer);
     }
+
+    // shorter than a segment, a few segments, and not a whole segment
+    int[] lengths = {1000, 16 * 4096 * 4, 300001};
+    for (int i = 0; i != cipherTests.length; i += 2) {
+      for (int length : lengths) {
+        streamTest(Hex.decode(cipherTests[i]), length);
+      }
+    }
   }
 
   public void testAESCBCMB() {
@@ -18,9 +18,22 @@
 
 package com.intel.diceros.test.aes;
 
+import com.intel.diceros.crypto.DataLengthException;
+import com.intel.diceros.crypto.engines.AESOpensslEngine;
+import com.intel.diceros.crypto.modes.CTRBlockCipher;
+import com.intel.diceros.crypto.params.KeyParameter;
+import com.intel.diceros.crypto.params.ParametersWithIV;
 import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.symmetric.util.Constants;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.util.Hex;
 
+import javax.crypto.Cipher;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+import java.nio.ByteBuffer;
 import java.security.Security;
+import java.util.Random;
 
 public class AESCTRTest extends AESAbstarctTest {
   static String[] cipherCTRTests = {
@@ -83,6 +96,129 @@ public class AESCTRTest extends AESAbstarctTest {
     super(cipherName, providerName, cipherCTRTests);
   }
 
+  /**
+   * Decrypt random ranges of a ciphertext after seeking the cipher to the
+   * start of the range, including offsets inside a block and a counter that
+   * wraps around the low 64 bits.
+   */
+  private void seekTest(byte[] keyBytes, byte[] ivBytes) throws Exception {
+    Random random = new Random(1);
+    byte[] input = new byte[4096];
+    random.nextBytes(input);
+
+    Cipher enc = Cipher.getInstance(this.cipherName, this.providerName);
+    enc.init(Cipher.ENCRYPT_MODE, new SecretKeySpec(keyBytes, "AES"),
+        new IvParameterSpec(ivBytes));
+    byte[] cipherText = enc.doFinal(input);
+
+    CTRBlockCipher ctr = new CTRBlockCipher(new AESOpensslEngine(Constants.MODE_CTR));
+    ctr.init(false, new ParametersWithIV(new KeyParameter(keyBytes), ivBytes));
+    for (int i = 0; i < 100; i++) {
+      int position = random.nextInt(input.length);
+      int len = random.nextInt(input.length - position);
+      byte[] out = new byte[len];
+      ctr.processBlock(position, cipherText, position, len, out, 0);
+      if (!Arrays.areEqual(out,
+          java.util.Arrays.copyOfRange(input, position, position + len))) {
+        fail("AES CTR seek failed at position " + position);
+      }
+    }
+  }
+
+  /**
+   * Encrypt with the fused CRC32C pass, check the ciphertext and checksums
+   * against the cipher and a bitwise CRC32C, then decrypt in place.
+   */
+  private void checksumTest(byte[] keyBytes, byte[] ivBytes,
+      int bytesPerChecksum) throws Exception {
+    Random random = new Random(bytesPerChecksum);
+    byte[] input = new byte[70001];
+    random.nextBytes(input);
+
+    Cipher enc = Cipher.getInstance(this.cipherName, this.providerName);
+    enc.init(Cipher.ENCRYPT_MODE, new SecretKeySpec(keyBytes, "AES"),
+        new IvParameterSpec(ivBytes));
+    byte[] cipherText = enc.doFinal(input);
+
+    int count = (input.length + bytesPerChecksum - 1) / bytesPerChecksum;
+    int[] checksums = new int[count + 1];
+    ByteBuffer in = ByteBuffer.allocateDirect(input.length);
+    ByteBuffer out = ByteBuffer.allocateDirect(input.length);
+    in.put(input);
+    in.flip();
+    AESOpensslEngine engine = new AESOpensslEngine(Constants.MODE_CTR);
+    engine.init(true, new ParametersWithIV(new KeyParameter(keyBytes), ivBytes));
+    engine.processWithChecksums(in, out, bytesPerChecksum, checksums, 1);
+    out.flip();
+    byte[] result = new byte[input.length];
+    out.duplicate().get(result);
+    if (!Arrays.areEqual(cipherText, result)) {
+      fail("AES CTR checksummed encryption failed");
+    }
+    for (int i = 0; i < count; i++) {
+      int off = i * bytesPerChecksum;
+      int len = Math.min(bytesPerChecksum, input.length - off);
+      if (checksums[i + 1] != crc32c(cipherText, off, len)) {
+        fail("AES CTR checksum " + i + " is wrong");
+      }
+    }
+
+    int[] decryptChecksums = new int[count];
+    engine.init(false, new ParametersWithIV(new KeyParameter(keyBytes), ivBytes));
+    engine.processWithChecksums(out, out.duplicate(), bytesPerChecksum,
+        decryptChecksums, 0);
+    out.flip();
+    out.get(result);
+    if (!Arrays.areEqual(input, result)) {
+      fail("AES CTR checksummed in place decryption failed");
+    }
+    if (!Arrays.areEqual(java.util.Arrays.copyOfRange(checksums, 1, count + 1),
+        decryptChecksums)) {
+      fail("AES CTR decryption checksums differ from encryption");
+    }
+
+    out.flip();
+    try {
+      engine.processWithChecksums(out, out.duplicate(), 0, decryptChecksums, 0);
+      fail("AES CTR checksummed processing accepted 0 bytes per checksum");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+    try {
+      engine.processWithChecksums(out, out.duplicate(), bytesPerChecksum,
+          decryptChecksums, 1);
+      fail("AES CTR checksummed processing accepted a short checksum array");
+    } catch (DataLengthException e) {
+      // expected
+    }
+  }
+
+  private static int crc32c(byte[] data, int off, int len) {
+    int crc = 0xffffffff;
+    for (int i = off; i < off + len; i++) {
+      crc ^= data[i] & 0xff;
+      for (int k = 0; k < 8; k++) {
+        crc = (crc >>> 1) ^ (0x82F63B78 & -(crc & 1));
+      }
+    }
+    return ~crc;
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    super.performTest();
+
+    checksumTest(Hex.decode("2b7e151628aed2a6abf7158809cf4f3c"),
+        Hex.decode("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"), 512);
+    checksumTest(Hex.decode("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"),
+        Hex.decode("00000000000000fffffffffffffffff0"), 20000);
+
+    seekTest(Hex.decode("2b7e151628aed2a6abf7158809cf4f3c"),
+        Hex.decode("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+    seekTest(Hex.decode("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"),
+        Hex.decode("00000000000000fffffffffffffffff0"));
+  }
+
   public void testAESCTR() {
     Security.addProvider(new DicerosProvider());
     runTest(new AESCTRTest("AES/CTR/NoPadding", "DC"));
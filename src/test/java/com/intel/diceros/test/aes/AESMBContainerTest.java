@@ -0,0 +1,167 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import java.security.Security;
+import java.util.Random;
+
+import javax.crypto.Cipher;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+import com.intel.diceros.crypto.engines.AESMultiBufferContainer;
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+/**
+ * This class checks that byte ranges and single chunks of a multi-buffer
+ * container decrypt to the sealed plaintext, and that the container reader
+ * still opens messages of the AES/MBCBC cipher.
+ */
+public class AESMBContainerTest extends BaseBlockCipherTest {
+  private static final int THREADS = 4;
+  private static final int RANGES = 200;
+
+  private volatile Throwable failure;
+
+  public AESMBContainerTest() {
+    super("AES");
+  }
+
+  private void rangeTest(byte[] key, byte[] iv, int length, int chunkSize)
+      throws Exception {
+    Random random = new Random(length);
+    byte[] input = new byte[length];
+    random.nextBytes(input);
+
+    AESMultiBufferContainer container = new AESMultiBufferContainer(key, iv);
+    byte[] sealed = new byte[(int) AESMultiBufferContainer.getSealedLength(length)];
+    container.seal(input, 0, length, chunkSize, sealed, 0);
+    if (AESMultiBufferContainer.getPlainTextLength(sealed, 0, sealed.length) != length
+        || AESMultiBufferContainer.getChunkSize(sealed, 0, sealed.length) != chunkSize) {
+      fail("AES container header is wrong");
+    }
+    if (!Arrays.areEqual(input, container.open(sealed, 0, sealed.length))) {
+      fail("AES container failed decryption of " + length + " bytes");
+    }
+
+    for (int i = 0; i < RANGES && length > 0; i++) {
+      int position = random.nextInt(length);
+      int rangeLength = random.nextInt(Math.min(length - position, 3 * chunkSize) + 1);
+      byte[] range = new byte[rangeLength];
+      container.open(sealed, 0, sealed.length, position, range, 0, rangeLength);
+      if (!Arrays.areEqual(Arrays.copyOfRange(input, position, position + rangeLength), range)) {
+        fail("AES container failed decryption of " + rangeLength + " bytes at "
+            + position);
+      }
+    }
+    container.close();
+  }
+
+  private void parallelTest(byte[] key, final byte[] iv) throws Exception {
+    final int chunkSize = AESMultiBufferContainer.DEFAULT_CHUNK_SIZE;
+    final int chunks = 4 * THREADS;
+    final byte[] input = new byte[chunks * chunkSize - 100];
+    new Random().nextBytes(input);
+    final byte[] sealed = new AESMultiBufferContainer(key, iv).seal(input, 0,
+        input.length);
+    final byte[] output = new byte[input.length];
+    final byte[] threadKey = key;
+
+    // every thread decrypts every THREADS-th chunk with its own instance
+    Thread[] threads = new Thread[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+      final int first = i;
+      threads[i] = new Thread() {
+        public void run() {
+          try {
+            AESMultiBufferContainer container = new AESMultiBufferContainer(
+                threadKey, iv);
+            for (int c = first; c < chunks; c += THREADS) {
+              int position = c * chunkSize;
+              int length = Math.min(chunkSize, input.length - position);
+              container.open(sealed, 0, sealed.length, position, output,
+                  position, length);
+            }
+            container.close();
+          } catch (Throwable e) {
+            failure = e;
+          }
+        }
+      };
+      threads[i].start();
+    }
+    for (int i = 0; i < THREADS; i++) {
+      threads[i].join();
+    }
+    if (failure != null) {
+      fail("AES container failed parallel decryption - " + failure, failure);
+    }
+    if (!Arrays.areEqual(input, output)) {
+      fail("AES container failed parallel decryption");
+    }
+  }
+
+  private void messageTest(byte[] key, byte[] iv, int length) throws Exception {
+    byte[] input = new byte[length];
+    new Random(length).nextBytes(input);
+    Cipher cipher = Cipher.getInstance("AES/MBCBC/PKCS5Padding", "DC");
+    cipher.init(Cipher.ENCRYPT_MODE, new SecretKeySpec(key, "AES"),
+        new IvParameterSpec(iv));
+    byte[] message = cipher.doFinal(input);
+
+    AESMultiBufferContainer container = new AESMultiBufferContainer(key, iv);
+    if (!Arrays.areEqual(input, container.open(message, 0, message.length))) {
+      fail("AES container failed to open a message of " + length + " bytes");
+    }
+    container.close();
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    Random random = new Random();
+    byte[] iv = new byte[16];
+    random.nextBytes(iv);
+    int[] lengths = {0, 1, 17, 1000, 65536, 65537, 300001};
+    int[] chunkSizes = {1024, 4096, AESMultiBufferContainer.DEFAULT_CHUNK_SIZE};
+    for (int keyLength = 16; keyLength <= 32; keyLength += 8) {
+      byte[] key = new byte[keyLength];
+      random.nextBytes(key);
+      for (int length : lengths) {
+        for (int chunkSize : chunkSizes) {
+          rangeTest(key, iv, length, chunkSize);
+        }
+        if (length > 0) {
+          messageTest(key, iv, length);
+        }
+      }
+      parallelTest(key, iv);
+    }
+  }
+
+  public void testAESMBContainer() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new AESMBContainerTest());
+  }
+
+  public static void main(String[] args) {
+    new AESMBContainerTest().testAESMBContainer();
+  }
+}
@@ -0,0 +1,173 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import java.nio.ByteBuffer;
+import java.util.Random;
+
+import javax.crypto.Cipher;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+import com.intel.diceros.crypto.engines.AESMultiBufferJobManager;
+import com.intel.diceros.provider.symmetric.util.Constants;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+/**
+ * This class checks the records encrypted by the multi-buffer job manager
+ * from several threads against the default AES/CBC/PKCS5Padding cipher, with
+ * a shared key and with one key per thread.
+ */
+public class AESMBJobManagerTest extends BaseBlockCipherTest {
+  private static final int THREADS = 8;
+  private static final int RECORDS = 200;
+  private static final int MAX_RECORD_SIZE = 4096;
+
+  private volatile Throwable failure;
+
+  public AESMBJobManagerTest() {
+    super("AES");
+  }
+
+  /**
+   * Encrypt the records with the shared key, or with <code>tenantKey</code>
+   * if it is not null.
+   */
+  private void runRecords(AESMultiBufferJobManager manager, byte[] key,
+      byte[] tenantKey, long seed) throws Exception {
+    Random random = new Random(seed);
+    Cipher cipher = Cipher.getInstance("AES/CBC/PKCS5Padding");
+    ByteBuffer input = ByteBuffer.allocateDirect(MAX_RECORD_SIZE);
+    ByteBuffer output = ByteBuffer.allocateDirect(MAX_RECORD_SIZE + 16);
+
+    for (int i = 0; i < RECORDS; i++) {
+      byte[] record = new byte[random.nextInt(MAX_RECORD_SIZE)];
+      byte[] iv = new byte[16];
+      random.nextBytes(record);
+      random.nextBytes(iv);
+
+      input.clear();
+      input.put(record);
+      input.flip();
+      output.clear();
+
+      int len = tenantKey == null ? manager.submit(input, output, iv).await()
+          : manager.submit(input, output, iv, tenantKey).await();
+      output.flip();
+      byte[] encrypted = new byte[len];
+      output.get(encrypted);
+
+      cipher.init(Cipher.DECRYPT_MODE,
+          new SecretKeySpec(tenantKey == null ? key : tenantKey, "AES"),
+          new IvParameterSpec(iv));
+      if (!Arrays.areEqual(record, cipher.doFinal(encrypted))) {
+        fail("AES multi-buffer job failed for record length " + record.length);
+      }
+    }
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    final byte[] key = new byte[32];
+    new Random().nextBytes(key);
+    AESMultiBufferJobManager manager = new AESMultiBufferJobManager(key,
+        Constants.PADDING_PKCS5PADDING);
+    runThreads(manager, key, false);
+    // odd threads bring their own key, even threads use the shared one
+    runThreads(manager, key, true);
+    manager.close();
+
+    manager = new AESMultiBufferJobManager(32, Constants.PADDING_PKCS5PADDING,
+        AESMultiBufferJobManager.DEFAULT_FLUSH_TIMEOUT);
+    runThreads(manager, null, true);
+    manager.close();
+
+    closeTest(key);
+  }
+
+  /**
+   * The manager must not be closed under an outstanding job.
+   */
+  private void closeTest(byte[] key) throws Exception {
+    AESMultiBufferJobManager manager = new AESMultiBufferJobManager(key,
+        Constants.PADDING_PKCS5PADDING);
+    ByteBuffer input = ByteBuffer.allocateDirect(100);
+    ByteBuffer output = ByteBuffer.allocateDirect(112);
+    AESMultiBufferJobManager.Job job = manager.submit(input, output,
+        new byte[16]);
+    try {
+      manager.close();
+      fail("AES multi-buffer job manager closed with an outstanding job");
+    } catch (IllegalStateException e) {
+      // expected
+    }
+    if (job.await() != 112) {
+      fail("AES multi-buffer job failed after a refused close");
+    }
+    manager.close();
+    if (job.await() != 112) {
+      fail("AES multi-buffer job result changed after close");
+    }
+    try {
+      manager.flush();
+      fail("AES multi-buffer job manager flushed after close");
+    } catch (IllegalStateException e) {
+      // expected
+    }
+  }
+
+  private void runThreads(final AESMultiBufferJobManager manager,
+      final byte[] key, boolean tenants) throws Exception {
+    Thread[] threads = new Thread[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+      final long seed = i;
+      final byte[] tenantKey = tenants && (key == null || i % 2 == 1) ?
+          new byte[32] : null;
+      if (tenantKey != null) {
+        new Random(-seed).nextBytes(tenantKey);
+      }
+      threads[i] = new Thread() {
+        public void run() {
+          try {
+            runRecords(manager, key, tenantKey, seed);
+          } catch (Throwable e) {
+            failure = e;
+          }
+        }
+      };
+      threads[i].start();
+    }
+    for (int i = 0; i < THREADS; i++) {
+      threads[i].join();
+    }
+
+    if (failure != null) {
+      fail("AES multi-buffer job manager failed - " + failure, failure);
+    }
+  }
+
+  public void testAESMBJobManager() {
+    runTest(new AESMBJobManagerTest());
+  }
+
+  public static void main(String[] args) {
+    new AESMBJobManagerTest().testAESMBJobManager();
+  }
+}
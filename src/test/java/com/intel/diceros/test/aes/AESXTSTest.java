@@ -18,13 +18,20 @@
 
 package com.intel.diceros.test.aes;
 
+import com.intel.diceros.crypto.engines.AESOpensslEngine;
+import com.intel.diceros.crypto.modes.XTSBlockCipher;
+import com.intel.diceros.crypto.params.KeyParameter;
+import com.intel.diceros.crypto.params.ParametersWithIV;
 import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.symmetric.util.Constants;
 import com.intel.diceros.provider.util.Arrays;
 import com.intel.diceros.test.BaseBlockCipherTest;
 import com.intel.diceros.test.util.Hex;
 
+import java.nio.ByteBuffer;
 import java.security.Key;
 import java.security.Security;
+import java.util.Random;
 
 import javax.crypto.Cipher;
 import javax.crypto.spec.IvParameterSpec;
@@ -91,6 +98,75 @@ public class AESXTSTest extends BaseBlockCipherTest {
           Hex.decode(cipherXTSTests[i + 1]), Hex.decode(cipherXTSTests[i + 2]),
           Hex.decode(cipherXTSTests[i + 3]), Hex.decode(cipherXTSTests[i + 4]));
     }
+
+    for (int i = 0; i != cipherXTSTests.length; i += 5) {
+      sectorTest(Hex.decode(cipherXTSTests[i + 1]));
+    }
+  }
+
+  /**
+   * Encrypt a run of sectors in one call and compare every sector with a
+   * cipher initialized with the sector number as tweak, then decrypt the run
+   * from a direct buffer.
+   */
+  private void sectorTest(byte[] keyBytes) throws Exception {
+    final int unitSize = 512;
+    final long startSector = 0xfffffffeL;
+    Random random = new Random(1);
+    byte[] plainText = new byte[unitSize * 8 + 48];
+    random.nextBytes(plainText);
+
+    XTSBlockCipher xts = new XTSBlockCipher(new AESOpensslEngine(Constants.MODE_XTS));
+    xts.init(true, new ParametersWithIV(new KeyParameter(keyBytes), new byte[16]));
+    byte[] cipherText = new byte[plainText.length];
+    xts.processSectors(plainText, 0, plainText.length, cipherText, 0, unitSize,
+        startSector);
+
+    Key key = new SecretKeySpec(keyBytes, "AES");
+    Cipher enc = Cipher.getInstance(this.cipherName, this.providerName);
+    for (int off = 0; off < plainText.length; off += unitSize) {
+      int len = Math.min(unitSize, plainText.length - off);
+      long sector = startSector + off / unitSize;
+      byte[] tweak = new byte[16];
+      for (int i = 0; i < 8; i++) {
+        tweak[i] = (byte) (sector >>> (8 * i));
+      }
+      enc.init(Cipher.ENCRYPT_MODE, key, new IvParameterSpec(tweak));
+      byte[] expected = new byte[len];
+      enc.update(plainText, off, len, expected, 0);
+      if (!Arrays.areEqual(expected,
+          java.util.Arrays.copyOfRange(cipherText, off, off + len))) {
+        fail("AES XTS sector " + sector + " failed encryption");
+      }
+    }
+
+    ByteBuffer input = ByteBuffer.allocateDirect(cipherText.length);
+    ByteBuffer output = ByteBuffer.allocateDirect(cipherText.length);
+    input.put(cipherText);
+    input.flip();
+    xts.init(false, new ParametersWithIV(new KeyParameter(keyBytes), new byte[16]));
+    xts.processSectors(input, output, unitSize, startSector);
+    output.flip();
+    byte[] decResult = new byte[output.remaining()];
+    output.get(decResult);
+    if (!Arrays.areEqual(decResult, plainText)) {
+      fail("AES XTS sectors failed decryption");
+    }
+
+    try {
+      xts.processSectors(cipherText, 0, cipherText.length, decResult, 0, 500,
+          startSector);
+      fail("AES XTS accepted a data unit size which is no block multiple");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+    try {
+      xts.processSectors(cipherText, -16, unitSize, decResult, 0, unitSize,
+          startSector);
+      fail("AES XTS accepted a negative input offset");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
   }
 
   private void byteArrayTest(int strength, byte[] keyBytes, byte[] ivBytes,
@@ -0,0 +1,179 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import com.intel.diceros.crypto.engines.AESOpensslEngine;
+import com.intel.diceros.crypto.engines.AsyncCallback;
+import com.intel.diceros.crypto.engines.AsyncCipher;
+import com.intel.diceros.crypto.engines.AsyncCipherService;
+import com.intel.diceros.crypto.params.KeyParameter;
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.symmetric.util.Constants;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+import java.nio.ByteBuffer;
+import java.security.Security;
+import java.util.List;
+import java.util.Random;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import javax.crypto.BadPaddingException;
+import javax.crypto.Cipher;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+/**
+ * This class checks that jobs run on the asynchronous workers match the
+ * synchronous ciphers.
+ */
+public class AsyncCipherTest extends BaseBlockCipherTest {
+  private static final int CIPHERS = 4;
+  private static final int UPDATES = 16;
+
+  public AsyncCipherTest() {
+    super("AES");
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    Random rnd = new Random(UPDATES);
+    byte[] keyBytes = new byte[16];
+    byte[] iv = new byte[16];
+    rnd.nextBytes(keyBytes);
+    rnd.nextBytes(iv);
+
+    AsyncCipherService service = new AsyncCipherService(2);
+    try {
+      for (int i = 0; i < CIPHERS; i++) {
+        streamTest(service, i % 2 == 0 ? Constants.MODE_CTR : Constants.MODE_CBC,
+            keyBytes, iv, rnd);
+      }
+      badTagTest(service, keyBytes, iv);
+    } finally {
+      service.close();
+    }
+  }
+
+  /**
+   * Encrypt a message in UPDATES batched jobs, the last one final, and
+   * compare it with the provider cipher.
+   */
+  private void streamTest(AsyncCipherService service, int mode,
+      byte[] keyBytes, byte[] iv, Random rnd) throws Exception {
+    String name = mode == Constants.MODE_CTR ? "AES/CTR/NoPadding" :
+        "AES/CBC/PKCS5Padding";
+    AESOpensslEngine engine = new AESOpensslEngine(mode,
+        mode == Constants.MODE_CTR ? Constants.PADDING_NOPADDING :
+            Constants.PADDING_PKCS5PADDING);
+    engine.setIV(iv);
+    engine.init(true, new KeyParameter(keyBytes));
+
+    byte[][] parts = new byte[UPDATES][];
+    ByteBuffer[] inputs = new ByteBuffer[UPDATES];
+    ByteBuffer[] outputs = new ByteBuffer[UPDATES];
+    boolean[] isFinal = new boolean[UPDATES];
+    int total = 0;
+    for (int i = 0; i < UPDATES; i++) {
+      parts[i] = new byte[rnd.nextInt(5000)];
+      rnd.nextBytes(parts[i]);
+      inputs[i] = ByteBuffer.allocateDirect(parts[i].length);
+      inputs[i].put(parts[i]);
+      inputs[i].flip();
+      outputs[i] = ByteBuffer.allocateDirect(parts[i].length + 32);
+      total += parts[i].length;
+    }
+    isFinal[UPDATES - 1] = true;
+
+    final AtomicInteger completed = new AtomicInteger();
+    AsyncCipher cipher = service.newCipher(engine);
+    List<Future<Integer>> futures = cipher.submit(inputs, outputs, isFinal,
+        new AsyncCallback() {
+          @Override
+          public void completed(int length) {
+            completed.incrementAndGet();
+          }
+
+          @Override
+          public void failed(Exception e) {
+          }
+        });
+
+    ByteBuffer actual = ByteBuffer.allocate(total + 32);
+    for (int i = 0; i < UPDATES; i++) {
+      int length = futures.get(i).get().intValue();
+      if (outputs[i].position() != length || inputs[i].hasRemaining()) {
+        fail("Async job did not update the buffer positions");
+      }
+      outputs[i].flip();
+      actual.put(outputs[i]);
+    }
+    cipher.close();
+    if (completed.get() != UPDATES) {
+      fail("Async callback called " + completed.get() + " times");
+    }
+
+    byte[] plainText = new byte[total];
+    for (int i = 0, off = 0; i < UPDATES; off += parts[i].length, i++) {
+      System.arraycopy(parts[i], 0, plainText, off, parts[i].length);
+    }
+    Cipher expected = Cipher.getInstance(name, "DC");
+    expected.init(Cipher.ENCRYPT_MODE, new SecretKeySpec(keyBytes, "AES"),
+        new IvParameterSpec(iv));
+    byte[] cipherText = expected.doFinal(plainText);
+    actual.flip();
+    byte[] actualBytes = new byte[actual.remaining()];
+    actual.get(actualBytes);
+    if (!Arrays.areEqual(cipherText, actualBytes)) {
+      fail("Async " + name + " differs from the synchronous cipher");
+    }
+  }
+
+  private void badTagTest(AsyncCipherService service, byte[] keyBytes,
+      byte[] iv) throws Exception {
+    AESOpensslEngine engine = new AESOpensslEngine(Constants.MODE_GCM);
+    engine.setTagLen(Constants.GCM_DEFAULT_TAG_LEN);
+    engine.setIV(java.util.Arrays.copyOf(iv, 12));
+    engine.init(false, new KeyParameter(keyBytes));
+
+    ByteBuffer input = ByteBuffer.allocateDirect(100);
+    ByteBuffer output = ByteBuffer.allocateDirect(100);
+    AsyncCipher cipher = service.newCipher(engine);
+    try {
+      cipher.submit(input, output, true, null).get();
+      fail("Async GCM accepted a bad tag");
+    } catch (ExecutionException e) {
+      if (!(e.getCause() instanceof BadPaddingException)) {
+        fail("Async GCM failed with " + e.getCause());
+      }
+    }
+    cipher.close();
+  }
+
+  public void testAsyncCipher() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new AsyncCipherTest());
+  }
+
+  public static void main(String[] args) {
+    new AsyncCipherTest().testAsyncCipher();
+  }
+}
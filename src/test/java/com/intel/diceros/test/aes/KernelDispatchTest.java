@@ -0,0 +1,97 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import com.intel.diceros.crypto.engines.KernelDispatch;
+import com.intel.diceros.provider.symmetric.util.Constants;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+/**
+ * This class checks that the dispatch registry is consistent with the
+ * probed CPU features.
+ */
+public class KernelDispatchTest extends BaseBlockCipherTest {
+
+  public KernelDispatchTest() {
+    super("AES");
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    int features = KernelDispatch.getCpuFeatures();
+    if (features != KernelDispatch.getCpuFeatures()) {
+      fail("CPU features changed between calls");
+    }
+
+    int lanes = KernelDispatch.getLanes();
+    if (lanes != 8 && lanes != 16) {
+      fail("Invalid lane count " + lanes);
+    }
+    if (lanes == 16 && !KernelDispatch.hasFeatures(
+        KernelDispatch.CPU_FEATURE_VAES | KernelDispatch.CPU_FEATURE_AVX512F)) {
+      fail("16 lanes bound without VAES");
+    }
+
+    for (int i = 0; i < Constants.AES_KEYSIZES.length; i++) {
+      int keyLength = Constants.AES_KEYSIZES[i];
+      String name = KernelDispatch.getKernelName(Constants.MODE_CBC, true, keyLength);
+      if (!KernelDispatch.hasFeatures(KernelDispatch.CPU_FEATURE_AESNI)) {
+        if (name != null) {
+          fail("Kernel " + name + " bound without AES-NI");
+        }
+      } else if (name == null || !name.contains(String.valueOf(keyLength * 8))) {
+        fail("Invalid kernel " + name + " for key length " + keyLength);
+      }
+    }
+
+    int gcmFeatures = KernelDispatch.CPU_FEATURE_AESNI
+        | KernelDispatch.CPU_FEATURE_PCLMUL;
+    for (int i = 0; i < Constants.AES_KEYSIZES.length; i++) {
+      int keyLength = Constants.AES_KEYSIZES[i];
+      String name = KernelDispatch.getKernelName(Constants.MODE_GCM, false, keyLength);
+      if (name != null && !KernelDispatch.hasFeatures(gcmFeatures)) {
+        fail("Kernel " + name + " bound without AES-NI and PCLMULQDQ");
+      } else if (name != null && !name.contains(String.valueOf(keyLength * 8))) {
+        fail("Invalid kernel " + name + " for key length " + keyLength);
+      }
+    }
+
+    if (KernelDispatch.getKernelName(Constants.MODE_CBC, true, 17) != null) {
+      fail("Kernel bound for an invalid key length");
+    }
+
+    boolean wide = KernelDispatch.isWideOutput();
+    if (wide != Boolean.getBoolean(KernelDispatch.WIDE_OUTPUT_PROPERTY)) {
+      fail("Wide output does not follow " + KernelDispatch.WIDE_OUTPUT_PROPERTY);
+    }
+    KernelDispatch.setWideOutput(!wide);
+    if (KernelDispatch.isWideOutput() == wide) {
+      fail("Wide output not switched");
+    }
+    KernelDispatch.setWideOutput(wide);
+  }
+
+  public void testKernelDispatch() {
+    runTest(new KernelDispatchTest());
+  }
+
+  public static void main(String[] args) {
+    new KernelDispatchTest().testKernelDispatch();
+  }
+}
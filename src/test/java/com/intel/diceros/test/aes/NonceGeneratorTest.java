@@ -0,0 +1,88 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.symmetric.util.NonceGenerator;
+import com.intel.diceros.test.BaseBlockCipherTest;
+import com.intel.diceros.test.util.Hex;
+
+import java.security.Security;
+import java.util.HashSet;
+import java.util.Set;
+
+public class NonceGeneratorTest extends BaseBlockCipherTest {
+  private static final int THREADS = 8;
+  // more than one counter block per thread
+  private static final int NONCES = 100000;
+
+  public NonceGeneratorTest() {
+    super("NonceGenerator");
+  }
+
+  public void testNonceGenerator() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new NonceGeneratorTest());
+  }
+
+  public static void main(String[] args) {
+    new NonceGeneratorTest().testNonceGenerator();
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    final NonceGenerator generator = new NonceGenerator();
+    final byte[][][] nonces = new byte[THREADS][NONCES][];
+    Thread[] threads = new Thread[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+      final int index = t;
+      threads[t] = new Thread() {
+        @Override
+        public void run() {
+          for (int i = 0; i < NONCES; i++) {
+            nonces[index][i] = generator.nextNonce();
+          }
+        }
+      };
+      threads[t].start();
+    }
+    for (int t = 0; t < THREADS; t++) {
+      threads[t].join();
+    }
+
+    byte[] first = nonces[0][0];
+    Set<String> seen = new HashSet<String>();
+    for (int t = 0; t < THREADS; t++) {
+      for (int i = 0; i < NONCES; i++) {
+        byte[] nonce = nonces[t][i];
+        if (nonce.length != NonceGenerator.NONCE_LENGTH) {
+          fail("nonce has a wrong length");
+        }
+        for (int k = 0; k < NonceGenerator.FIXED_LENGTH; k++) {
+          if (nonce[k] != first[k]) {
+            fail("nonce fixed field changed");
+          }
+        }
+        if (!seen.add(Hex.toHexString(nonce))) {
+          fail("nonce repeated");
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,172 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.aes;
+
+import com.intel.diceros.crypto.engines.AESOpensslEngine;
+import com.intel.diceros.crypto.engines.WorkerPool;
+import com.intel.diceros.crypto.modes.XTSBlockCipher;
+import com.intel.diceros.crypto.params.KeyParameter;
+import com.intel.diceros.crypto.params.ParametersWithIV;
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.symmetric.util.Constants;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+import java.nio.ByteBuffer;
+import java.security.Key;
+import java.security.Security;
+import java.util.Random;
+
+import javax.crypto.Cipher;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+/**
+ * This class checks that jobs split over the worker pool give the same
+ * result as the single thread path.
+ */
+public class WorkerPoolTest extends BaseBlockCipherTest {
+  private static final int THRESHOLD = 64 * 1024;
+  private static final int CHUNK_SIZE = 16 * 1024;
+  private static final int LENGTH = 1024 * 1024 + 21;
+
+  public WorkerPoolTest() {
+    super("AES");
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    try {
+      WorkerPool.configure(-1, THRESHOLD, CHUNK_SIZE);
+      fail("Negative thread count accepted");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+    try {
+      WorkerPool.configure(2, THRESHOLD, 1000);
+      fail("Chunk size which is not a multiple of 4096 accepted");
+    } catch (IllegalArgumentException e) {
+      // expected
+    }
+
+    Random rnd = new Random(LENGTH);
+    byte[] keyBytes = new byte[32];
+    byte[] iv = new byte[16];
+    byte[] input = new byte[LENGTH];
+    rnd.nextBytes(keyBytes);
+    rnd.nextBytes(input);
+    // a counter about to carry into the upper 64 bits
+    for (int i = 8; i < 16; i++) {
+      iv[i] = (byte) 0xff;
+    }
+
+    try {
+      WorkerPool.configure(0, THRESHOLD, CHUNK_SIZE);
+      byte[] ctr = ctr(keyBytes, iv, input);
+      byte[] xts = xts(keyBytes, input, true);
+      byte[] mbcbc = mbcbc(keyBytes, input, true);
+
+      WorkerPool.configure(3, THRESHOLD, CHUNK_SIZE);
+      if (WorkerPool.getThreads() != 3) {
+        fail("Worker pool reports " + WorkerPool.getThreads() + " threads");
+      }
+      if (!Arrays.areEqual(ctr, ctr(keyBytes, iv, input))) {
+        fail("AES CTR on the worker pool failed");
+      }
+      if (!Arrays.areEqual(xts, xts(keyBytes, input, true))
+          || !Arrays.areEqual(input, xts(keyBytes, xts, false))) {
+        fail("AES XTS on the worker pool failed");
+      }
+      if (!Arrays.areEqual(input, mbcbc(keyBytes, mbcbc, false))) {
+        fail("AES MBCBC decryption on the worker pool failed");
+      }
+    } finally {
+      WorkerPool.configure(0, WorkerPool.DEFAULT_THRESHOLD,
+          WorkerPool.DEFAULT_CHUNK_SIZE);
+    }
+  }
+
+  /**
+   * CTR over direct buffers, the first update leaves the counter inside a
+   * block.
+   */
+  private byte[] ctr(byte[] keyBytes, byte[] iv, byte[] input)
+      throws Exception {
+    Cipher cipher = Cipher.getInstance("AES/CTR/NoPadding", "DC");
+    cipher.init(Cipher.ENCRYPT_MODE, new SecretKeySpec(keyBytes, "AES"),
+        new IvParameterSpec(iv));
+    ByteBuffer in = toDirect(input);
+    ByteBuffer out = ByteBuffer.allocateDirect(input.length);
+    in.limit(7);
+    cipher.update(in, out);
+    in.limit(in.capacity() - 5);
+    cipher.update(in, out);
+    in.limit(in.capacity());
+    cipher.doFinal(in, out);
+    return fromDirect(out);
+  }
+
+  private byte[] xts(byte[] keyBytes, byte[] input, boolean forEncryption) {
+    XTSBlockCipher xts = new XTSBlockCipher(
+        new AESOpensslEngine(Constants.MODE_XTS));
+    xts.init(forEncryption, new ParametersWithIV(new KeyParameter(keyBytes),
+        new byte[16]));
+    ByteBuffer out = ByteBuffer.allocateDirect(input.length);
+    xts.processSectors(toDirect(input), out, 4096, 7);
+    return fromDirect(out);
+  }
+
+  private byte[] mbcbc(byte[] keyBytes, byte[] input, boolean forEncryption)
+      throws Exception {
+    Cipher cipher = Cipher.getInstance("AES/MBCBC/PKCS5Padding", "DC");
+    Key key = new SecretKeySpec(keyBytes, "AES");
+    if (forEncryption) {
+      cipher.init(Cipher.ENCRYPT_MODE, key, new IvParameterSpec(new byte[16]));
+    } else {
+      cipher.init(Cipher.DECRYPT_MODE, key, new IvParameterSpec(new byte[16]));
+    }
+    ByteBuffer out = ByteBuffer.allocateDirect(
+        cipher.getOutputSize(input.length));
+    cipher.doFinal(toDirect(input), out);
+    return fromDirect(out);
+  }
+
+  private static ByteBuffer toDirect(byte[] data) {
+    ByteBuffer buffer = ByteBuffer.allocateDirect(data.length);
+    buffer.put(data);
+    buffer.flip();
+    return buffer;
+  }
+
+  private static byte[] fromDirect(ByteBuffer buffer) {
+    buffer.flip();
+    byte[] data = new byte[buffer.remaining()];
+    buffer.get(data);
+    return data;
+  }
+
+  public void testWorkerPool() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new WorkerPoolTest());
+  }
+
+  public static void main(String[] args) {
+    new WorkerPoolTest().testWorkerPool();
+  }
+}
@@ -0,0 +1,126 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.digest;
+
+import java.nio.ByteBuffer;
+import java.security.MessageDigest;
+import java.security.Security;
+import java.util.Random;
+
+import com.intel.diceros.crypto.digests.SHADigest;
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+
+/**
+ * This class checks the SHA-1 and SHA-256 digests of the DC provider and the
+ * batch SHA-256 against the digests of the default provider.
+ */
+public class SHADigestTest extends BaseBlockCipherTest {
+  private static final int MESSAGES = 100;
+  private static final int MAX_MESSAGE_SIZE = 1000;
+
+  public SHADigestTest() {
+    super("SHA");
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    digestTest("SHA-1");
+    digestTest("SHA-256");
+    batchTest();
+  }
+
+  private void digestTest(String algorithm) throws Exception {
+    Random random = new Random();
+    MessageDigest expected = MessageDigest.getInstance(algorithm, "SUN");
+    MessageDigest actual = MessageDigest.getInstance(algorithm, "DC");
+    ByteBuffer direct = ByteBuffer.allocateDirect(MAX_MESSAGE_SIZE);
+
+    for (int i = 0; i < MESSAGES; i++) {
+      byte[] message = new byte[random.nextInt(MAX_MESSAGE_SIZE)];
+      random.nextBytes(message);
+      byte[] digest = expected.digest(message);
+
+      // split into array, single byte and direct buffer updates
+      int split = random.nextInt(message.length + 1);
+      actual.update(message, 0, split);
+      if (split < message.length) {
+        actual.update(message[split]);
+        direct.clear();
+        direct.put(message, split + 1, message.length - split - 1);
+        direct.flip();
+        actual.update(direct);
+      }
+      if (!Arrays.areEqual(digest, actual.digest())) {
+        fail(algorithm + " failed for message length " + message.length);
+      }
+    }
+
+    // a clone continues independently
+    byte[] message = new byte[MAX_MESSAGE_SIZE];
+    random.nextBytes(message);
+    actual.update(message, 0, 100);
+    MessageDigest clone = (MessageDigest) actual.clone();
+    actual.update(message, 100, message.length - 100);
+    clone.update(message, 100, message.length - 100);
+    byte[] digest = expected.digest(message);
+    if (!Arrays.areEqual(digest, actual.digest())
+        || !Arrays.areEqual(digest, clone.digest())) {
+      fail(algorithm + " clone failed");
+    }
+  }
+
+  private void batchTest() throws Exception {
+    Random random = new Random();
+    MessageDigest expected = MessageDigest.getInstance("SHA-256", "SUN");
+    int[] offsets = new int[MESSAGES];
+    int[] lengths = new int[MESSAGES];
+    ByteBuffer messages = ByteBuffer.allocateDirect(MESSAGES * MAX_MESSAGE_SIZE);
+    byte[][] data = new byte[MESSAGES][];
+    for (int i = 0; i < MESSAGES; i++) {
+      data[i] = new byte[random.nextInt(MAX_MESSAGE_SIZE)];
+      random.nextBytes(data[i]);
+      offsets[i] = messages.position();
+      lengths[i] = data[i].length;
+      messages.put(data[i]);
+    }
+
+    ByteBuffer digests = ByteBuffer.allocateDirect(
+        MESSAGES * SHADigest.SHA256_LENGTH);
+    SHADigest.batchSHA256(messages, offsets, lengths, MESSAGES, digests);
+    digests.flip();
+    for (int i = 0; i < MESSAGES; i++) {
+      byte[] digest = new byte[SHADigest.SHA256_LENGTH];
+      digests.get(digest);
+      if (!Arrays.areEqual(expected.digest(data[i]), digest)) {
+        fail("SHA-256 batch failed for message " + i);
+      }
+    }
+  }
+
+  public void testSHADigest() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new SHADigestTest());
+  }
+
+  public static void main(String[] args) {
+    new SHADigestTest().testSHADigest();
+  }
+}
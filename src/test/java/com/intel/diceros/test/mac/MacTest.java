@@ -0,0 +1,156 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.mac;
+
+import java.nio.ByteBuffer;
+import java.security.Security;
+import java.util.Random;
+
+import javax.crypto.Mac;
+import javax.crypto.spec.IvParameterSpec;
+import javax.crypto.spec.SecretKeySpec;
+
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
+import com.intel.diceros.test.BaseBlockCipherTest;
+import com.intel.diceros.test.util.Hex;
+
+/**
+ * This class checks the HMACs of the DC provider against the default
+ * provider, and AES-CMAC and AES-GMAC against published test vectors.
+ */
+public class MacTest extends BaseBlockCipherTest {
+  private static final int MESSAGES = 50;
+  private static final int MAX_MESSAGE_SIZE = 1000;
+
+  // RFC 4493, examples 1 and 2
+  private static final String CMAC_KEY = "2b7e151628aed2a6abf7158809cf4f3c";
+  private static final String CMAC_MESSAGE = "6bc1bee22e409f96e93d7e117393172a";
+  private static final String CMAC_EMPTY = "bb1d6929e95937287fa37d129b756746";
+  private static final String CMAC_BLOCK = "070a16b46b4d4144f79bdd9dd04a287c";
+
+  // NIST GCM test vector with an empty plaintext
+  private static final String GMAC_KEY = "77be63708971c4e240d1cb79e8d77feb";
+  private static final String GMAC_IV = "e0e00f19fed7ba0136a797f3";
+  private static final String GMAC_AAD = "7a43ec1d9c0a5a78a0b16533a6213cab";
+  private static final String GMAC_TAG = "209fcc8d3675ed938e9c7166709dd946";
+
+  public MacTest() {
+    super("Mac");
+  }
+
+  @Override
+  public void performTest() throws Exception {
+    hmacTest("HmacSHA1");
+    hmacTest("HmacSHA256");
+    hmacTest("HmacSHA512");
+    cmacTest();
+    gmacTest();
+  }
+
+  private void hmacTest(String algorithm) throws Exception {
+    Random random = new Random();
+    Mac expected = Mac.getInstance(algorithm, "SunJCE");
+    Mac actual = Mac.getInstance(algorithm, "DC");
+    ByteBuffer direct = ByteBuffer.allocateDirect(MAX_MESSAGE_SIZE);
+
+    for (int i = 0; i < MESSAGES; i++) {
+      // keys longer than the block size are hashed first
+      byte[] keyBytes = new byte[1 + random.nextInt(200)];
+      random.nextBytes(keyBytes);
+      SecretKeySpec key = new SecretKeySpec(keyBytes, algorithm);
+      expected.init(key);
+      actual.init(key);
+
+      // two messages per key, the second one after a re-init with the key
+      for (int j = 0; j < 2; j++) {
+        byte[] message = new byte[random.nextInt(MAX_MESSAGE_SIZE)];
+        random.nextBytes(message);
+        int split = random.nextInt(message.length + 1);
+        actual.update(message, 0, split);
+        direct.clear();
+        direct.put(message, split, message.length - split);
+        direct.flip();
+        actual.update(direct);
+        if (!Arrays.areEqual(expected.doFinal(message), actual.doFinal())) {
+          fail(algorithm + " failed for message length " + message.length);
+        }
+        actual.init(new SecretKeySpec(keyBytes.clone(), algorithm));
+      }
+    }
+
+    // a clone continues independently
+    byte[] message = new byte[MAX_MESSAGE_SIZE];
+    random.nextBytes(message);
+    actual.update(message, 0, 100);
+    Mac clone = (Mac) actual.clone();
+    actual.update(message, 100, message.length - 100);
+    clone.update(message, 100, message.length - 100);
+    byte[] mac = expected.doFinal(message);
+    if (!Arrays.areEqual(mac, actual.doFinal())
+        || !Arrays.areEqual(mac, clone.doFinal())) {
+      fail(algorithm + " clone failed");
+    }
+  }
+
+  private void cmacTest() throws Exception {
+    Mac cmac = Mac.getInstance("AESCMAC", "DC");
+    cmac.init(new SecretKeySpec(Hex.decode(CMAC_KEY), "AES"));
+    if (!Arrays.areEqual(Hex.decode(CMAC_EMPTY), cmac.doFinal())) {
+      fail("AES-CMAC failed for the empty message");
+    }
+    // the mac is ready for the next message with the same key
+    if (!Arrays.areEqual(Hex.decode(CMAC_BLOCK),
+        cmac.doFinal(Hex.decode(CMAC_MESSAGE)))) {
+      fail("AES-CMAC failed for a one block message");
+    }
+  }
+
+  private void gmacTest() throws Exception {
+    Mac gmac = Mac.getInstance("AESGMAC", "DC");
+    SecretKeySpec key = new SecretKeySpec(Hex.decode(GMAC_KEY), "AES");
+    gmac.init(key, new IvParameterSpec(Hex.decode(GMAC_IV)));
+    if (!Arrays.areEqual(Hex.decode(GMAC_TAG),
+        gmac.doFinal(Hex.decode(GMAC_AAD)))) {
+      fail("AES-GMAC failed");
+    }
+
+    // a finished GMAC needs a new nonce
+    try {
+      gmac.update(Hex.decode(GMAC_AAD));
+      fail("AES-GMAC accepted a message without a new nonce");
+    } catch (IllegalStateException e) {
+      // expected
+    }
+    gmac.init(key, new IvParameterSpec(Hex.decode(GMAC_IV)));
+    gmac.update(ByteBuffer.wrap(Hex.decode(GMAC_AAD)));
+    if (!Arrays.areEqual(Hex.decode(GMAC_TAG), gmac.doFinal())) {
+      fail("AES-GMAC failed after a re-init");
+    }
+  }
+
+  public void testMac() {
+    Security.addProvider(new DicerosProvider());
+    runTest(new MacTest());
+  }
+
+  public static void main(String[] args) {
+    new MacTest().testMac();
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.intel.diceros.test.securerandom;
+
+import com.intel.diceros.provider.DicerosProvider;
+import com.intel.diceros.provider.util.Arrays;
+
+import java.security.SecureRandom;
+import java.security.Security;
+
+/**
+ * Runs the statistical tests of {@link DRNGTest} on the CTR_DRBG, plus
+ * requests across the native request size and per-thread states.
+ */
+public class CTRDRBGTest extends DRNGTest {
+
+    public CTRDRBGTest() {
+        super("CTRDRBG");
+    }
+
+    public void testCTRDRBG() {
+        Security.addProvider(new DicerosProvider());
+        runTest(new CTRDRBGTest());
+    }
+
+    public static void main(String[] args) {
+        new CTRDRBGTest().testCTRDRBG();
+    }
+
+    @Override
+    public void performTest() throws Exception {
+        super.performTest();
+
+        final SecureRandom random = SecureRandom.getInstance("CTR_DRBG", "DC");
+        byte[] large = new byte[200000];
+        random.nextBytes(large);
+        byte[] tail = new byte[16];
+        System.arraycopy(large, large.length - 16, tail, 0, 16);
+        if (Arrays.areEqual(tail, new byte[16])) {
+            fail("CTR_DRBG did not fill a request larger than 64KB");
+        }
+
+        random.setSeed(new byte[100]);
+        byte[] a = new byte[32];
+        byte[] b = new byte[32];
+        random.nextBytes(a);
+        random.nextBytes(b);
+        if (Arrays.areEqual(a, b)) {
+            fail("CTR_DRBG repeated its output");
+        }
+
+        final byte[] other = new byte[32];
+        Thread thread = new Thread() {
+            @Override
+            public void run() {
+                random.nextBytes(other);
+            }
+        };
+        thread.start();
+        thread.join();
+        if (Arrays.areEqual(a, other) || Arrays.areEqual(b, other)) {
+            fail("CTR_DRBG threads share their output");
+        }
+    }
+}
@@ -33,6 +33,7 @@ import java.io.InputStream;
 import java.io.InputStreamReader;
 import java.io.Reader;
 import java.net.URL;
+import java.nio.ByteBuffer;
 import java.security.SecureRandom;
 import java.security.Security;
 import java.util.ArrayList;
@@ -47,7 +48,11 @@ import java.util.List;
 public class DRNGTest extends BaseBlockCipherTest {
 
     public DRNGTest() {
-        super("DRNG");
+        this("DRNG");
+    }
+
+    protected DRNGTest(String algorithm) {
+        super(algorithm);
     }
 
     public void testDRNG() {
@@ -72,7 +77,7 @@ public class DRNGTest extends BaseBlockCipherTest {
 
     @Override
     public void performTest() throws Exception {
-        SecureRandom random = SecureRandom.getInstance("DRNG", "DC");
+        SecureRandom random = SecureRandom.getInstance(getName(), "DC");
         random.nextDouble();
         byte[] bytes = new byte[65536];
         random.nextBytes(bytes);
@@ -93,6 +98,40 @@ public class DRNGTest extends BaseBlockCipherTest {
         testCumulativeSums(epsilon);
         testRandomExcursions(epsilon);
         testRandomExcursionsVariant(epsilon);
+
+        // the seed comes from RDSEED, not from the jre SecureRandom
+        final int[] seed = bytes2Ints(random.generateSeed(8192));
+        testFrequency(seed);
+        testBlockFrequency(seed, 10);
+        testRuns(seed);
+
+        rangeTest();
+    }
+
+    /**
+     * Fill a slice of a direct buffer, the bytes around it stay untouched.
+     */
+    private void rangeTest() {
+        ByteBuffer buffer = ByteBuffer.allocateDirect(4096);
+        buffer.position(100);
+        buffer.limit(3001);
+        assertTrue("DRNG range fill failed",
+                com.intel.diceros.provider.securerandom.SecureRandom.DRNG.nextBytes(buffer));
+        assertEquals(3001, buffer.position());
+
+        byte[] all = new byte[4096];
+        buffer.clear();
+        buffer.get(all);
+        byte[] before = new byte[100];
+        byte[] after = new byte[4096 - 3001];
+        System.arraycopy(all, 0, before, 0, before.length);
+        System.arraycopy(all, 3001, after, 0, after.length);
+        assertTrue("DRNG filled outside of the range",
+                Arrays.areEqual(before, new byte[before.length])
+                        && Arrays.areEqual(after, new byte[after.length]));
+        final int[] epsilon = new int[(3001 - 100) * 8];
+        System.arraycopy(bytes2Ints(all), 100 * 8, epsilon, 0, epsilon.length);
+        testFrequency(epsilon);
     }
 
     /**